@@ -1835,7 +1835,9 @@ void ApiWrap::requestChannelMembersForAdd(
 }
 
 void ApiWrap::scheduleStickerSetRequest(uint64 setId, uint64 access) {
-	if (!_stickerSetRequests.contains(setId)) {
+	if (Local::loadStickerSet(setId)) {
+		return;
+	} else if (!_stickerSetRequests.contains(setId)) {
 		_stickerSetRequests.insert(setId, qMakePair(access, 0));
 	}
 }
@@ -203,7 +203,10 @@ namespace App {
 	}
 
 	void feedMsgs(const QVector<MTPMessage> &msgs, NewMessageType type) {
-		auto indices = base::flat_map<uint64, int>();
+		// When applying a batch of updates group messages by history,
+		// keeping the message id order inside each of them.
+		const auto grouped = Auth().data().updatesBatchActive();
+		auto indices = base::flat_map<std::pair<PeerId, uint64>, int>();
 		for (int i = 0, l = msgs.size(); i != l; ++i) {
 			const auto &msg = msgs[i];
 			if (msg.type() == mtpc_message) {
@@ -216,7 +219,12 @@ namespace App {
 				}
 			}
 			const auto msgId = IdFromMessage(msg);
-			indices.emplace((uint64(uint32(msgId)) << 32) | uint64(i), i);
+			const auto peerId = grouped ? PeerFromMessage(msg) : PeerId(0);
+			indices.emplace(
+				std::make_pair(
+					peerId,
+					(uint64(uint32(msgId)) << 32) | uint64(i)),
+				i);
 		}
 		for (const auto [position, index] : indices) {
 			Auth().data().addNewMessage(msgs[index], type);
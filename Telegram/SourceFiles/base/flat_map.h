@@ -7,6 +7,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #pragma once
 
 #include <deque>
+#include <vector>
 #include <algorithm>
 #include "base/optional.h"
 
@@ -773,6 +774,480 @@ private:
 
 };
 
+template <
+	typename Key,
+	typename Type,
+	typename Compare = std::less<>>
+class flat_vector_map;
+
+// The element of flat_vector_map is not stored as a pair, so iterators
+// return a pair of references. Bind it by value or by const reference:
+// for (const auto &[key, value] : map) { ... }.
+template <typename Key, typename Value>
+struct flat_vector_map_reference {
+	const Key &first;
+	Value &second;
+};
+
+template <typename Key, typename Value>
+class flat_vector_map_pointer {
+public:
+	using reference = flat_vector_map_reference<Key, Value>;
+
+	flat_vector_map_pointer(reference value) : _value(value) {
+	}
+	const reference *operator->() const {
+		return &_value;
+	}
+
+private:
+	reference _value;
+
+};
+
+template <typename Key, typename Value>
+class flat_vector_map_iterator {
+public:
+	using iterator_category = std::random_access_iterator_tag;
+
+	using value_type = flat_vector_map_reference<Key, Value>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = flat_vector_map_pointer<Key, Value>;
+	using reference = flat_vector_map_reference<Key, Value>;
+
+	flat_vector_map_iterator() = default;
+	flat_vector_map_iterator(const Key *key, Value *value)
+	: _key(key)
+	, _value(value) {
+	}
+	template <
+		typename OtherValue,
+		typename = std::enable_if_t<
+			std::is_convertible_v<OtherValue*, Value*>>>
+	flat_vector_map_iterator(
+		const flat_vector_map_iterator<Key, OtherValue> &other)
+	: _key(other._key)
+	, _value(other._value) {
+	}
+
+	reference operator*() const {
+		return { *_key, *_value };
+	}
+	pointer operator->() const {
+		return **this;
+	}
+	flat_vector_map_iterator &operator++() {
+		++_key;
+		++_value;
+		return *this;
+	}
+	flat_vector_map_iterator operator++(int) {
+		return { _key++, _value++ };
+	}
+	flat_vector_map_iterator &operator--() {
+		--_key;
+		--_value;
+		return *this;
+	}
+	flat_vector_map_iterator operator--(int) {
+		return { _key--, _value-- };
+	}
+	flat_vector_map_iterator &operator+=(difference_type offset) {
+		_key += offset;
+		_value += offset;
+		return *this;
+	}
+	flat_vector_map_iterator operator+(difference_type offset) const {
+		return { _key + offset, _value + offset };
+	}
+	flat_vector_map_iterator &operator-=(difference_type offset) {
+		_key -= offset;
+		_value -= offset;
+		return *this;
+	}
+	flat_vector_map_iterator operator-(difference_type offset) const {
+		return { _key - offset, _value - offset };
+	}
+	template <typename OtherValue>
+	difference_type operator-(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key - right._key;
+	}
+	reference operator[](difference_type offset) const {
+		return *(*this + offset);
+	}
+
+	template <typename OtherValue>
+	bool operator==(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key == right._key;
+	}
+	template <typename OtherValue>
+	bool operator!=(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key != right._key;
+	}
+	template <typename OtherValue>
+	bool operator<(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key < right._key;
+	}
+	template <typename OtherValue>
+	bool operator>(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key > right._key;
+	}
+	template <typename OtherValue>
+	bool operator<=(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key <= right._key;
+	}
+	template <typename OtherValue>
+	bool operator>=(
+			const flat_vector_map_iterator<Key, OtherValue> &right) const {
+		return _key >= right._key;
+	}
+
+	friend flat_vector_map_iterator operator+(
+			difference_type offset,
+			const flat_vector_map_iterator &right) {
+		return right + offset;
+	}
+
+private:
+	const Key *_key = nullptr;
+	Value *_value = nullptr;
+
+	template <
+		typename OtherKey,
+		typename OtherType,
+		typename OtherCompare>
+	friend class flat_vector_map;
+
+	template <typename OtherKey, typename OtherValue>
+	friend class flat_vector_map_iterator;
+
+};
+
+// Same as flat_map, but the keys and the values are kept in two separate
+// std::vector-s (structure of arrays).
+//
+// Binary search touches only the contiguous keys and the map may be
+// built in bulk with from_sorted() / merge(), but insertion at the front
+// is linear, so this is for the maps that are mostly read.
+template <typename Key, typename Type, typename Compare>
+class flat_vector_map {
+	static_assert(
+		!std::is_same_v<Type, bool>,
+		"std::vector<bool> has no contiguous storage.");
+
+	using keys_t = std::vector<Key>;
+	using values_t = std::vector<Type>;
+
+public:
+	using key_type = Key;
+	using mapped_type = Type;
+	using size_type = typename keys_t::size_type;
+	using difference_type = typename keys_t::difference_type;
+	using iterator = flat_vector_map_iterator<Key, Type>;
+	using const_iterator = flat_vector_map_iterator<Key, const Type>;
+	using value_type = typename iterator::value_type;
+	using reference = typename iterator::reference;
+	using const_reference = typename const_iterator::reference;
+
+	flat_vector_map() = default;
+
+	template <
+		typename Iterator,
+		typename = typename std::iterator_traits<Iterator>::iterator_category>
+	flat_vector_map(Iterator first, Iterator last) {
+		merge(first, last);
+	}
+
+	flat_vector_map(std::initializer_list<std::pair<Key, Type>> iter)
+	: flat_vector_map(iter.begin(), iter.end()) {
+	}
+
+	// The keys must be already sorted and unique,
+	// values[i] is the value for keys[i].
+	[[nodiscard]] static flat_vector_map from_sorted(
+			keys_t &&keys,
+			values_t &&values) {
+		auto result = flat_vector_map();
+		result._data.keys = std::move(keys);
+		result._data.values = std::move(values);
+		return result;
+	}
+
+	size_type size() const {
+		return keys().size();
+	}
+	bool empty() const {
+		return keys().empty();
+	}
+	void clear() {
+		_data.keys.clear();
+		_data.values.clear();
+	}
+	void reserve(size_type size) {
+		_data.keys.reserve(size);
+		_data.values.reserve(size);
+	}
+
+	iterator begin() {
+		return at(0);
+	}
+	iterator end() {
+		return at(size());
+	}
+	const_iterator begin() const {
+		return at(0);
+	}
+	const_iterator end() const {
+		return at(size());
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator cend() const {
+		return end();
+	}
+
+	reference front() {
+		return *begin();
+	}
+	const_reference front() const {
+		return *begin();
+	}
+	reference back() {
+		return *(end() - 1);
+	}
+	const_reference back() const {
+		return *(end() - 1);
+	}
+
+	// Sorted contiguous storage, may be used for bulk operations.
+	const keys_t &keys() const {
+		return _data.keys;
+	}
+	const values_t &values() const {
+		return _data.values;
+	}
+
+	std::pair<iterator, bool> insert(const std::pair<Key, Type> &value) {
+		return try_emplace(value.first, value.second);
+	}
+	std::pair<iterator, bool> insert(std::pair<Key, Type> &&value) {
+		return try_emplace(
+			std::move(value.first),
+			std::move(value.second));
+	}
+	template <typename OtherKey = Key, typename... Args>
+	std::pair<iterator, bool> emplace(OtherKey &&key, Args&&... args) {
+		return try_emplace(
+			std::forward<OtherKey>(key),
+			std::forward<Args>(args)...);
+	}
+	template <typename OtherKey = Key, typename... Args>
+	std::pair<iterator, bool> try_emplace(OtherKey &&key, Args&&... args) {
+		const auto index = lowerBoundIndex(key);
+		if (index < size() && !compare()(key, keys()[index])) {
+			return { at(index), false };
+		}
+		_data.keys.insert(
+			_data.keys.begin() + index,
+			Key(std::forward<OtherKey>(key)));
+		_data.values.insert(
+			_data.values.begin() + index,
+			Type(std::forward<Args>(args)...));
+		return { at(index), true };
+	}
+
+	Type &operator[](const Key &key) {
+		return try_emplace(key).first->second;
+	}
+
+	bool remove(const Key &key) {
+		const auto where = find(key);
+		if (where == end()) {
+			return false;
+		}
+		erase(where);
+		return true;
+	}
+
+	iterator erase(const_iterator where) {
+		return erase(where, where + 1);
+	}
+	iterator erase(const_iterator from, const_iterator till) {
+		const auto index = indexOf(from);
+		const auto count = (till - from);
+		_data.keys.erase(
+			_data.keys.begin() + index,
+			_data.keys.begin() + index + count);
+		_data.values.erase(
+			_data.values.begin() + index,
+			_data.values.begin() + index + count);
+		return at(index);
+	}
+	int erase(const Key &key) {
+		return remove(key) ? 1 : 0;
+	}
+
+	iterator lower_bound(const Key &key) {
+		return at(lowerBoundIndex(key));
+	}
+	const_iterator lower_bound(const Key &key) const {
+		return at(lowerBoundIndex(key));
+	}
+	template <
+		typename OtherKey,
+		typename = typename Compare::is_transparent>
+	iterator lower_bound(const OtherKey &key) {
+		return at(lowerBoundIndex(key));
+	}
+	template <
+		typename OtherKey,
+		typename = typename Compare::is_transparent>
+	const_iterator lower_bound(const OtherKey &key) const {
+		return at(lowerBoundIndex(key));
+	}
+
+	iterator find(const Key &key) {
+		return at(findIndex(key));
+	}
+	const_iterator find(const Key &key) const {
+		return at(findIndex(key));
+	}
+	template <
+		typename OtherKey,
+		typename = typename Compare::is_transparent>
+	iterator find(const OtherKey &key) {
+		return at(findIndex(key));
+	}
+	template <
+		typename OtherKey,
+		typename = typename Compare::is_transparent>
+	const_iterator find(const OtherKey &key) const {
+		return at(findIndex(key));
+	}
+
+	bool contains(const Key &key) const {
+		return findIndex(key) != size();
+	}
+	template <
+		typename OtherKey,
+		typename = typename Compare::is_transparent>
+	bool contains(const OtherKey &key) const {
+		return findIndex(key) != size();
+	}
+
+	std::optional<Type> take(const Key &key) {
+		const auto where = find(key);
+		if (where == end()) {
+			return std::nullopt;
+		}
+		auto result = std::move(where->second);
+		erase(where);
+		return result;
+	}
+
+	// Sorts only the new pairs and merges them in linear time.
+	// The values of the keys that are already in the map are kept.
+	template <
+		typename Iterator,
+		typename = typename std::iterator_traits<Iterator>::iterator_category>
+	void merge(Iterator first, Iterator last) {
+		auto added = std::vector<std::pair<Key, Type>>(first, last);
+		if (added.empty()) {
+			return;
+		}
+		const auto less = [&](const auto &a, const auto &b) {
+			return compare()(a.first, b.first);
+		};
+		std::stable_sort(added.begin(), added.end(), less);
+		added.erase(
+			std::unique(
+				added.begin(),
+				added.end(),
+				[&](const auto &a, const auto &b) { return !less(a, b); }),
+			added.end());
+
+		auto mergedKeys = keys_t();
+		auto mergedValues = values_t();
+		mergedKeys.reserve(size() + added.size());
+		mergedValues.reserve(size() + added.size());
+		auto index = size_type(0);
+		const auto push = [&](Key &&key, Type &&value) {
+			mergedKeys.push_back(std::move(key));
+			mergedValues.push_back(std::move(value));
+		};
+		for (auto &[key, value] : added) {
+			while (index != size() && !compare()(key, keys()[index])) {
+				if (!compare()(keys()[index], key)) {
+					key = std::move(_data.keys[index]);
+					value = std::move(_data.values[index++]);
+					break;
+				}
+				push(
+					std::move(_data.keys[index]),
+					std::move(_data.values[index]));
+				++index;
+			}
+			push(std::move(key), std::move(value));
+		}
+		for (; index != size(); ++index) {
+			push(
+				std::move(_data.keys[index]),
+				std::move(_data.values[index]));
+		}
+		_data.keys = std::move(mergedKeys);
+		_data.values = std::move(mergedValues);
+	}
+
+	void merge(std::initializer_list<std::pair<Key, Type>> list) {
+		merge(list.begin(), list.end());
+	}
+
+private:
+	struct Data : Compare {
+		keys_t keys;
+		values_t values;
+	};
+
+	Data _data;
+	const Compare &compare() const noexcept {
+		return _data;
+	}
+
+	iterator at(size_type index) {
+		return { keys().data() + index, _data.values.data() + index };
+	}
+	const_iterator at(size_type index) const {
+		return { keys().data() + index, values().data() + index };
+	}
+	size_type indexOf(const_iterator where) const {
+		return size_type(where._key - keys().data());
+	}
+
+	template <typename OtherKey>
+	size_type lowerBoundIndex(const OtherKey &key) const {
+		return size_type(std::lower_bound(
+			keys().begin(),
+			keys().end(),
+			key,
+			compare()) - keys().begin());
+	}
+	template <typename OtherKey>
+	size_type findIndex(const OtherKey &key) const {
+		const auto index = lowerBoundIndex(key);
+		return (index == size() || compare()(key, keys()[index]))
+			? size()
+			: index;
+	}
+
+};
+
 } // namespace base
 
 // Structured bindings support.
@@ -7,7 +7,9 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "catch.hpp"
 
 #include "base/flat_map.h"
+#include "base/tests_benchmark.h"
 #include <string>
+#include <random>
 
 struct int_wrap {
 	int value;
@@ -118,3 +120,130 @@ TEST_CASE("flat_maps structured bindings", "[flat_map]") {
 		}
 	}
 }
+
+TEST_CASE("flat_vector_maps should keep items sorted by key", "[flat_map]") {
+	base::flat_vector_map<int, string> v;
+	v.emplace(0, "a");
+	v.emplace(5, "b");
+	v.emplace(4, "d");
+	v.emplace(2, "e");
+
+	REQUIRE(v.size() == 4);
+	REQUIRE(std::is_sorted(v.keys().begin(), v.keys().end()));
+
+	SECTION("adding item puts it in the right position") {
+		REQUIRE(v.emplace(3, "c").second);
+		REQUIRE(!v.emplace(3, "x").second);
+		REQUIRE(v.size() == 5);
+		REQUIRE(v.find(3)->second == "c");
+		REQUIRE(v.keys() == std::vector<int>{ 0, 2, 3, 4, 5 });
+		REQUIRE(v.values() == std::vector<string>{ "a", "e", "c", "d", "b" });
+	}
+
+	SECTION("values are changed through iterators") {
+		v.find(4)->second = "x";
+		v[7] = "y";
+		REQUIRE(v[4] == "x");
+		REQUIRE(v.back().second == "y");
+		for (const auto &[key, value] : v) {
+			REQUIRE(v.find(key)->second == value);
+		}
+	}
+
+	SECTION("removing items") {
+		REQUIRE(v.take(5) == "b");
+		REQUIRE(!v.take(5).has_value());
+		REQUIRE(v.remove(0));
+		const auto next = v.erase(v.begin());
+		REQUIRE(next == v.find(4));
+		REQUIRE(v.keys() == std::vector<int>{ 4 });
+	}
+
+	SECTION("merge keeps existing values") {
+		v.merge({ { 4, "x" }, { 1, "f" }, { 9, "g" }, { 1, "y" } });
+		REQUIRE(v.keys() == std::vector<int>{ 0, 1, 2, 4, 5, 9 });
+		REQUIRE(v.values()
+			== std::vector<string>{ "a", "f", "e", "d", "b", "g" });
+	}
+
+	SECTION("iterators are random access") {
+		const auto first = v.begin();
+		const auto last = v.cend() - 1;
+		REQUIRE(first < last);
+		REQUIRE(last > first);
+		REQUIRE(first <= first);
+		REQUIRE(last >= first);
+		REQUIRE(!(first > last));
+		REQUIRE(3 + first == last);
+		REQUIRE(first[2].first == 4);
+		REQUIRE(std::lower_bound(
+			v.begin(),
+			v.end(),
+			4,
+			[](const auto &pair, int key) { return pair.first < key; })
+			== v.find(4));
+	}
+
+	SECTION("bulk build from sorted keys") {
+		const auto u = base::flat_vector_map<int, string>::from_sorted(
+			{ 1, 3, 8 },
+			{ "a", "b", "c" });
+		REQUIRE(u.size() == 3);
+		REQUIRE(u.find(3) == u.begin() + 1);
+		REQUIRE(u.find(3)->second == "b");
+		REQUIRE(u.find(4) == u.end());
+	}
+}
+
+TEST_CASE("flat_vector_maps heterogeneous lookup", "[flat_map]") {
+	base::flat_vector_map<string, int> v = {
+		{ "b", 2 },
+		{ "a", 1 },
+		{ "b", 3 },
+	};
+	REQUIRE(v.size() == 2);
+	REQUIRE(v.find("b")->second == 2);
+	REQUIRE(v.contains("a"));
+	REQUIRE(!v.contains("c"));
+	REQUIRE(v.lower_bound("aa") == v.find("b"));
+}
+
+namespace {
+
+constexpr auto kBenchmarkCount = 100'000;
+constexpr auto kBenchmarkLookups = 1'000'000;
+
+template <typename Pair>
+vector<Pair> RandomPairs(int count) {
+	auto generator = std::mt19937(1234);
+	auto result = vector<Pair>();
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		const auto key = int(generator());
+		result.emplace_back(key, key / 2);
+	}
+	return result;
+}
+
+template <typename Map, typename Pair>
+void Benchmark(const char *name) {
+	base::test::BenchmarkContainer<Map>(
+		name,
+		RandomPairs<Pair>(kBenchmarkCount),
+		kBenchmarkLookups,
+		[](const Map &map, const Pair &pair) {
+			const auto i = map.find(pair.first);
+			return (i != map.end()) && (i->second == pair.second);
+		});
+}
+
+} // namespace
+
+TEST_CASE("flat_map and flat_vector_map", "[.][benchmark]") {
+	Benchmark<
+		base::flat_map<int, int>,
+		base::flat_multi_map_pair_type<int, int>>("flat_map");
+	Benchmark<
+		base::flat_vector_map<int, int>,
+		pair<int, int>>("flat_vector_map");
+}
@@ -7,6 +7,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #pragma once
 
 #include <deque>
+#include <vector>
 #include <algorithm>
 
 namespace base {
@@ -716,4 +717,240 @@ private:
 
 };
 
+// Same as flat_set, but the values are kept in a single std::vector.
+//
+// Lookups don't jump between deque chunks and the values may be built
+// in bulk with from_sorted() / merge(), but insertion at the front is
+// linear, so this is for the sets that are mostly read.
+template <typename Type, typename Compare = std::less<>>
+class flat_vector_set {
+	using impl_t = std::vector<Type>;
+
+public:
+	using value_type = Type;
+	using size_type = typename impl_t::size_type;
+	using difference_type = typename impl_t::difference_type;
+	using pointer = const Type*;
+	using reference = const Type&;
+
+	using iterator = typename impl_t::const_iterator;
+	using const_iterator = typename impl_t::const_iterator;
+	using reverse_iterator = typename impl_t::const_reverse_iterator;
+	using const_reverse_iterator = typename impl_t::const_reverse_iterator;
+
+	flat_vector_set() = default;
+
+	template <
+		typename Iterator,
+		typename = typename std::iterator_traits<Iterator>::iterator_category>
+	flat_vector_set(Iterator first, Iterator last)
+	: _data(first, last) {
+		finalize();
+	}
+
+	flat_vector_set(std::initializer_list<Type> iter)
+	: flat_vector_set(iter.begin(), iter.end()) {
+	}
+
+	// The values must be already sorted and unique.
+	[[nodiscard]] static flat_vector_set from_sorted(impl_t &&values) {
+		auto result = flat_vector_set();
+		result.impl() = std::move(values);
+		return result;
+	}
+
+	size_type size() const {
+		return impl().size();
+	}
+	bool empty() const {
+		return impl().empty();
+	}
+	void clear() {
+		impl().clear();
+	}
+	void reserve(size_type size) {
+		impl().reserve(size);
+	}
+
+	const_iterator begin() const {
+		return impl().begin();
+	}
+	const_iterator end() const {
+		return impl().end();
+	}
+	const_iterator cbegin() const {
+		return impl().cbegin();
+	}
+	const_iterator cend() const {
+		return impl().cend();
+	}
+	const_reverse_iterator rbegin() const {
+		return impl().rbegin();
+	}
+	const_reverse_iterator rend() const {
+		return impl().rend();
+	}
+	const_reverse_iterator crbegin() const {
+		return impl().crbegin();
+	}
+	const_reverse_iterator crend() const {
+		return impl().crend();
+	}
+
+	reference front() const {
+		return impl().front();
+	}
+	reference back() const {
+		return impl().back();
+	}
+
+	// Sorted contiguous storage, may be used for bulk operations.
+	const impl_t &values() const {
+		return impl();
+	}
+
+	std::pair<iterator, bool> insert(const Type &value) {
+		if (empty() || compare()(back(), value)) {
+			impl().push_back(value);
+			return { end() - 1, true };
+		}
+		const auto where = lower_bound(value);
+		if (compare()(value, *where)) {
+			return { impl().insert(where, value), true };
+		}
+		return { where, false };
+	}
+	std::pair<iterator, bool> insert(Type &&value) {
+		if (empty() || compare()(back(), value)) {
+			impl().push_back(std::move(value));
+			return { end() - 1, true };
+		}
+		const auto where = lower_bound(value);
+		if (compare()(value, *where)) {
+			return { impl().insert(where, std::move(value)), true };
+		}
+		return { where, false };
+	}
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args&&... args) {
+		return insert(Type(std::forward<Args>(args)...));
+	}
+
+	bool remove(const Type &value) {
+		const auto where = find(value);
+		if (where == end()) {
+			return false;
+		}
+		impl().erase(where);
+		return true;
+	}
+
+	iterator erase(const_iterator where) {
+		return impl().erase(where);
+	}
+	iterator erase(const_iterator from, const_iterator till) {
+		return impl().erase(from, till);
+	}
+	int erase(const Type &value) {
+		return remove(value) ? 1 : 0;
+	}
+
+	const_iterator lower_bound(const Type &value) const {
+		return std::lower_bound(begin(), end(), value, compare());
+	}
+	template <
+		typename OtherType,
+		typename = typename Compare::is_transparent>
+	const_iterator lower_bound(const OtherType &value) const {
+		return std::lower_bound(begin(), end(), value, compare());
+	}
+
+	const_iterator find(const Type &value) const {
+		const auto where = lower_bound(value);
+		return (where == end() || compare()(value, *where)) ? end() : where;
+	}
+	template <
+		typename OtherType,
+		typename = typename Compare::is_transparent>
+	const_iterator find(const OtherType &value) const {
+		const auto where = lower_bound(value);
+		return (where == end() || compare()(value, *where)) ? end() : where;
+	}
+
+	bool contains(const Type &value) const {
+		return find(value) != end();
+	}
+	template <
+		typename OtherType,
+		typename = typename Compare::is_transparent>
+	bool contains(const OtherType &value) const {
+		return find(value) != end();
+	}
+
+	// Sorts only the new values and merges them in linear time.
+	template <
+		typename Iterator,
+		typename = typename std::iterator_traits<Iterator>::iterator_category>
+	void merge(Iterator first, Iterator last) {
+		const auto was = impl().size();
+		impl().insert(impl().end(), first, last);
+		const auto middle = impl().begin() + was;
+		std::sort(middle, impl().end(), compare());
+		std::inplace_merge(
+			impl().begin(),
+			middle,
+			impl().end(),
+			compare());
+		unique();
+	}
+
+	void merge(const flat_vector_set &other) {
+		if (&other == this) {
+			return;
+		}
+		merge(other.begin(), other.end());
+	}
+
+	void merge(std::initializer_list<Type> list) {
+		merge(list.begin(), list.end());
+	}
+
+private:
+	struct Data : Compare {
+		template <typename ...Args>
+		Data(Args &&...args)
+		: elements(std::forward<Args>(args)...) {
+		}
+
+		impl_t elements;
+	};
+
+	Data _data;
+	const Compare &compare() const noexcept {
+		return _data;
+	}
+	const impl_t &impl() const noexcept {
+		return _data.elements;
+	}
+	impl_t &impl() noexcept {
+		return _data.elements;
+	}
+
+	void finalize() {
+		std::stable_sort(impl().begin(), impl().end(), compare());
+		unique();
+	}
+	void unique() {
+		impl().erase(
+			std::unique(
+				impl().begin(),
+				impl().end(),
+				[&](const Type &a, const Type &b) {
+					return !compare()(a, b);
+				}),
+			impl().end());
+	}
+
+};
+
 } // namespace base
@@ -7,6 +7,9 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "catch.hpp"
 
 #include "base/flat_set.h"
+#include "base/tests_benchmark.h"
+
+#include <random>
 
 struct int_wrap {
 	int value;
@@ -81,3 +84,84 @@ TEST_CASE("flat_sets with custom comparators", "[flat_set]") {
 		checkSorted();
 	}
 }
+
+TEST_CASE("flat_vector_sets should keep items sorted", "[flat_set]") {
+	base::flat_vector_set<int> v = { 5, 0, 4, 2, 4 };
+	REQUIRE(v.size() == 4);
+	REQUIRE(std::is_sorted(v.begin(), v.end()));
+
+	SECTION("adding item puts it in the right position") {
+		REQUIRE(v.insert(3).second);
+		REQUIRE(!v.insert(3).second);
+		REQUIRE(v.size() == 5);
+		REQUIRE(v.contains(3));
+		REQUIRE(std::is_sorted(v.begin(), v.end()));
+	}
+
+	SECTION("removing items") {
+		REQUIRE(v.remove(4));
+		REQUIRE(!v.remove(4));
+		REQUIRE(v.erase(0) == 1);
+		REQUIRE(v.values() == std::vector<int>{ 2, 5 });
+	}
+
+	SECTION("merge keeps items unique") {
+		v.merge({ 7, 1, 2, 7 });
+		REQUIRE(v.values() == std::vector<int>{ 0, 1, 2, 4, 5, 7 });
+	}
+
+	SECTION("merge with itself changes nothing") {
+		v.merge(v);
+		REQUIRE(v.values() == std::vector<int>{ 0, 2, 4, 5 });
+	}
+
+	SECTION("bulk build from sorted values") {
+		const auto u = base::flat_vector_set<int>::from_sorted({ 1, 3, 8 });
+		REQUIRE(u.size() == 3);
+		REQUIRE(u.find(3) == u.begin() + 1);
+		REQUIRE(u.find(4) == u.end());
+	}
+}
+
+TEST_CASE("flat_vector_sets with custom comparators", "[flat_set]") {
+	base::flat_vector_set<int_wrap, int_wrap_comparator> v;
+	v.insert({ 0 });
+	v.insert({ 5 });
+	v.insert({ 4 });
+	v.insert({ 2 });
+
+	REQUIRE(v.find(4) != v.end());
+	REQUIRE(v.contains(2));
+	REQUIRE(!v.contains(3));
+	REQUIRE(v.lower_bound(3)->value == 4);
+}
+
+namespace {
+
+constexpr auto kBenchmarkCount = 100'000;
+constexpr auto kBenchmarkLookups = 1'000'000;
+
+std::vector<int> RandomValues(int count) {
+	auto generator = std::mt19937(1234);
+	auto result = std::vector<int>(count);
+	for (auto &value : result) {
+		value = int(generator());
+	}
+	return result;
+}
+
+template <typename Set>
+void Benchmark(const char *name) {
+	base::test::BenchmarkContainer<Set>(
+		name,
+		RandomValues(kBenchmarkCount),
+		kBenchmarkLookups,
+		[](const Set &set, int value) { return set.contains(value); });
+}
+
+} // namespace
+
+TEST_CASE("flat_set and flat_vector_set", "[.][benchmark]") {
+	Benchmark<base::flat_set<int>>("flat_set");
+	Benchmark<base::flat_vector_set<int>>("flat_vector_set");
+}
@@ -0,0 +1,109 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+#include <optional>
+
+namespace base {
+
+// Unbounded lock-free queue with many producers and a single consumer.
+//
+// push() may be called from any thread, pop() / empty() only from the
+// one thread that owns the consuming side. A push() that has not yet
+// finished may be invisible to pop() for a short moment, so consumers
+// should re-check after being notified instead of spinning.
+template <typename Type>
+class mpsc_queue {
+public:
+	mpsc_queue();
+	mpsc_queue(const mpsc_queue &other) = delete;
+	mpsc_queue &operator=(const mpsc_queue &other) = delete;
+	~mpsc_queue();
+
+	void push(Type &&value);
+	void push(const Type &value);
+
+	[[nodiscard]] std::optional<Type> pop();
+	[[nodiscard]] bool empty() const;
+
+	template <typename Callback>
+	void pop_all(Callback &&callback);
+
+private:
+	struct node {
+		node() = default;
+		explicit node(Type &&value) : value(std::move(value)) {
+		}
+
+		std::atomic<node*> next = nullptr;
+		Type value = Type();
+	};
+
+	void push_node(node *added);
+
+	std::atomic<node*> _head = nullptr;
+	node *_tail = nullptr;
+
+};
+
+template <typename Type>
+mpsc_queue<Type>::mpsc_queue() : _tail(new node()) {
+	_head.store(_tail, std::memory_order_relaxed);
+}
+
+template <typename Type>
+mpsc_queue<Type>::~mpsc_queue() {
+	while (const auto next = _tail->next.load(std::memory_order_acquire)) {
+		delete _tail;
+		_tail = next;
+	}
+	delete _tail;
+}
+
+template <typename Type>
+void mpsc_queue<Type>::push(Type &&value) {
+	push_node(new node(std::move(value)));
+}
+
+template <typename Type>
+void mpsc_queue<Type>::push(const Type &value) {
+	push_node(new node(Type(value)));
+}
+
+template <typename Type>
+void mpsc_queue<Type>::push_node(node *added) {
+	const auto previous = _head.exchange(added, std::memory_order_acq_rel);
+	previous->next.store(added, std::memory_order_release);
+}
+
+template <typename Type>
+std::optional<Type> mpsc_queue<Type>::pop() {
+	const auto next = _tail->next.load(std::memory_order_acquire);
+	if (!next) {
+		return std::nullopt;
+	}
+	auto result = std::make_optional(std::move(next->value));
+	delete _tail;
+	_tail = next;
+	return result;
+}
+
+template <typename Type>
+bool mpsc_queue<Type>::empty() const {
+	return (_tail->next.load(std::memory_order_acquire) == nullptr);
+}
+
+template <typename Type>
+template <typename Callback>
+void mpsc_queue<Type>::pop_all(Callback &&callback) {
+	while (auto value = pop()) {
+		callback(std::move(*value));
+	}
+}
+
+} // namespace base
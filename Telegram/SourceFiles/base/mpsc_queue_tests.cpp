@@ -0,0 +1,153 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/basic_types.h"
+#include "base/mpsc_queue.h"
+#include "base/tests_benchmark.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto kLoopbackItems = 1'000'000;
+
+// The same interface on a std::deque guarded by a mutex,
+// the way the received messages were passed before.
+template <typename T>
+class locked_queue {
+public:
+	void push(T &&value) {
+		std::lock_guard<std::mutex> lock(_mutex);
+		_items.push_back(std::move(value));
+	}
+	std::optional<T> pop() {
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_items.empty()) {
+			return std::nullopt;
+		}
+		auto result = std::move(_items.front());
+		_items.pop_front();
+		return result;
+	}
+
+private:
+	std::mutex _mutex;
+	std::deque<T> _items;
+
+};
+
+// One thread pushes the items while another one pops them,
+// like the connection thread passing the responses to the main thread.
+template <typename Queue>
+void Loopback(Queue &queue) {
+	auto producer = std::thread([&queue] {
+		for (auto i = 0; i != kLoopbackItems; ++i) {
+			queue.push(int(i));
+		}
+	});
+	auto received = 0;
+	auto sum = int64(0);
+	while (received != kLoopbackItems) {
+		if (const auto value = queue.pop()) {
+			sum += *value;
+			++received;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	REQUIRE(sum == int64(kLoopbackItems) * (kLoopbackItems - 1) / 2);
+}
+
+} // namespace
+
+TEST_CASE("mpsc_queue should keep items in push order", "[mpsc_queue]") {
+	base::mpsc_queue<int> queue;
+	REQUIRE(queue.empty());
+	REQUIRE(!queue.pop());
+
+	queue.push(1);
+	queue.push(2);
+	queue.push(3);
+	REQUIRE(!queue.empty());
+	REQUIRE(*queue.pop() == 1);
+	REQUIRE(*queue.pop() == 2);
+
+	queue.push(4);
+	auto rest = std::vector<int>();
+	queue.pop_all([&](int value) {
+		rest.push_back(value);
+	});
+	REQUIRE(rest == (std::vector<int>{ 3, 4 }));
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("mpsc_queue should support move-only items", "[mpsc_queue]") {
+	base::mpsc_queue<std::unique_ptr<int>> queue;
+	queue.push(std::make_unique<int>(5));
+	auto value = queue.pop();
+	REQUIRE(value.has_value());
+	REQUIRE(**value == 5);
+
+	// Items left in the queue are destroyed with it.
+	queue.push(std::make_unique<int>(6));
+}
+
+TEST_CASE("mpsc_queue should not lose items under contention", "[mpsc_queue]") {
+	constexpr auto kProducers = 4;
+	constexpr auto kPerProducer = 100000 / kProducers;
+
+	base::mpsc_queue<std::pair<int, int>> queue;
+	auto producers = std::vector<std::thread>();
+	for (auto i = 0; i != kProducers; ++i) {
+		producers.emplace_back([&queue, i] {
+			for (auto j = 0; j != kPerProducer; ++j) {
+				queue.push({ i, j });
+			}
+		});
+	}
+
+	auto next = std::vector<int>(kProducers, 0);
+	auto received = 0;
+	while (received != kProducers * kPerProducer) {
+		if (const auto value = queue.pop()) {
+			// Items from each single producer arrive in push order.
+			REQUIRE(value->second == next[value->first]);
+			++next[value->first];
+			++received;
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	for (auto &producer : producers) {
+		producer.join();
+	}
+	REQUIRE(queue.empty());
+	for (const auto count : next) {
+		REQUIRE(count == kPerProducer);
+	}
+}
+
+TEST_CASE("mpsc_queue loopback throughput", "[.][benchmark]") {
+	const auto report = [](const char *name, double time) {
+		WARN(name
+			<< ": " << time << " us, "
+			<< (kLoopbackItems / time) << " items per us");
+	};
+	report("mpsc_queue", base::test::Measure([] {
+		auto queue = base::mpsc_queue<int>();
+		Loopback(queue);
+	}));
+	report("locked std::deque", base::test::Measure([] {
+		auto queue = locked_queue<int>();
+		Loopback(queue);
+	}));
+}
@@ -0,0 +1,64 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include "catch.hpp"
+
+#include <chrono>
+#include <vector>
+
+// Helpers for the hidden [benchmark] test cases.
+namespace base {
+namespace test {
+
+// Average wall time of a callback run, in microseconds.
+template <typename Callback>
+double Measure(Callback &&callback, int repeat = 1) {
+	const auto started = std::chrono::steady_clock::now();
+	for (auto i = 0; i != repeat; ++i) {
+		callback();
+	}
+	const auto finished = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(
+		finished - started).count() / repeat;
+}
+
+// Inserts the values one by one, builds the container from all of them
+// at once and looks them up, the found(container, value) must succeed.
+template <typename Container, typename Value, typename Found>
+void BenchmarkContainer(
+		const char *name,
+		const std::vector<Value> &values,
+		int lookups,
+		Found &&found) {
+	auto inserted = Container();
+	const auto insert = Measure([&] {
+		for (const auto &value : values) {
+			inserted.insert(value);
+		}
+	});
+	auto built = Container();
+	const auto build = Measure([&] {
+		built = Container(values.begin(), values.end());
+	});
+	auto count = 0;
+	const auto lookup = Measure([&] {
+		for (auto i = 0; i != lookups; ++i) {
+			count += found(built, values[i % values.size()]) ? 1 : 0;
+		}
+	});
+	REQUIRE(count == lookups);
+	REQUIRE(inserted.size() == built.size());
+
+	WARN(name
+		<< ": insert " << insert
+		<< " us, build " << build
+		<< " us, lookup " << lookup << " us");
+}
+
+} // namespace test
+} // namespace base
@@ -346,6 +346,11 @@ auto LocalStorageBox::summary() const -> Database::TaggedSummary {
 	auto result = _stats.full;
 	result.count += _statsBig.full.count;
 	result.totalSize += _statsBig.full.totalSize;
+	const auto i = _stats.tagged.find(Data::kStickerSetContentsCacheTag);
+	if (i != end(_stats.tagged)) {
+		result.count -= i->second.count;
+		result.totalSize -= i->second.totalSize;
+	}
 	return result;
 }
 
@@ -355,7 +360,12 @@ void LocalStorageBox::clearByTag(uint16 tag) {
 	} else if (tag) {
 		_db->clearByTag(tag);
 	} else {
-		_db->clear();
+		// Installed sticker sets are read from the cache database.
+		for (const auto &[cacheTag, data] : _stats.tagged) {
+			if (cacheTag != Data::kStickerSetContentsCacheTag) {
+				_db->clearByTag(cacheTag);
+			}
+		}
 		_dbBig->clear();
 		Ui::Emoji::ClearIrrelevantCache();
 	}
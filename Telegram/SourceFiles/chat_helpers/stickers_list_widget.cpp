@@ -1833,7 +1833,11 @@ void StickersListWidget::appendSet(
 		AppendSkip skip) {
 	auto &sets = Auth().data().stickerSets();
 	auto it = sets.constFind(setId);
-	if (it == sets.cend() || it->stickers.isEmpty()) {
+	if (it == sets.cend()) {
+		return;
+	} else if (it->stickers.isEmpty()) {
+		// Shown after the contents are read from the local storage.
+		Local::loadStickerSet(setId);
 		return;
 	}
 	if ((skip == AppendSkip::Archived)
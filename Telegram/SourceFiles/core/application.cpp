@@ -17,6 +17,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "core/sandbox.h"
 #include "core/local_url_handlers.h"
 #include "core/launcher.h"
+#include "core/startup_trace.h"
 #include "storage/localstorage.h"
 #include "platform/platform_specific.h"
 #include "mainwindow.h"
@@ -99,7 +100,10 @@ void Application::run() {
 	Global::start();
 	refreshGlobalProxy(); // Depends on Global::started().
 
-	startLocalStorage();
+	{
+		const auto stage = StartupStage("local storage");
+		startLocalStorage();
+	}
 
 	if (Local::oldSettingsVersion() < AppVersion) {
 		psNewVersion();
@@ -132,8 +136,11 @@ void Application::run() {
 	// Create mime database, so it won't be slow later.
 	QMimeDatabase().mimeTypeForName(qsl("text/plain"));
 
-	_window = std::make_unique<MainWindow>();
-	_window->init();
+	{
+		const auto stage = StartupStage("main window");
+		_window = std::make_unique<MainWindow>();
+		_window->init();
+	}
 
 	auto currentGeometry = _window->geometry();
 	_mediaView = std::make_unique<Media::View::OverlayWidget>();
@@ -151,7 +158,10 @@ void Application::run() {
 	startShortcuts();
 	App::initMedia();
 
-	Local::ReadMapState state = Local::readMap(QByteArray());
+	const auto state = [&] {
+		const auto stage = StartupStage("local map");
+		return Local::readMap(QByteArray());
+	}();
 	if (state == Local::ReadMapPassNeeded) {
 		Global::SetLocalPasscode(true);
 		Global::RefLocalPasscodeChanged().notify();
@@ -159,8 +169,12 @@ void Application::run() {
 		DEBUG_LOG(("Application Info: passcode needed..."));
 	} else {
 		DEBUG_LOG(("Application Info: local map read..."));
-		startMtp();
+		{
+			const auto stage = StartupStage("mtproto");
+			startMtp();
+		}
 		DEBUG_LOG(("Application Info: MTP started..."));
+		const auto stage = StartupStage("main window setup");
 		if (AuthSession::Exists()) {
 			_window->setupMain();
 		} else {
@@ -170,6 +184,12 @@ void Application::run() {
 	DEBUG_LOG(("Application Info: showing."));
 	_window->firstShow();
 
+	// The first paint is done in the event loop.
+	crl::on_main(this, [] {
+		FinishStartupTrace();
+		Local::dropPrefetchedFiles();
+	});
+
 	if (!locked() && cStartToSettings()) {
 		_window->showSettings();
 	}
@@ -843,6 +863,7 @@ void Application::lockByPasscode() {
 void Application::unlockPasscode() {
 	clearPasscodeLock();
 	_window->clearPasscodeLock();
+	Local::dropPrefetchedFiles();
 }
 
 void Application::clearPasscodeLock() {
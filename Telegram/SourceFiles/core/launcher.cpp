@@ -385,6 +385,7 @@ void Launcher::processArguments() {
 		{ "-startintray"    , KeyFormat::NoValues },
 		{ "-sendpath"       , KeyFormat::AllLeftValues },
 		{ "-workdir"        , KeyFormat::OneValue },
+		{ "-decodingthreads", KeyFormat::OneValue },
 		{ "--"              , KeyFormat::OneValue },
 	};
 	auto parseResult = QMap<QByteArray, QStringList>();
@@ -434,6 +435,9 @@ void Launcher::processArguments() {
 			gWorkingDir = QString();
 		}
 	}
+	gDecodingThreads = std::max(parseResult.value(
+		"-decodingthreads",
+		{}).join(QString()).toInt(), 0);
 	gStartUrl = parseResult.value("--", {}).join(QString());
 }
 
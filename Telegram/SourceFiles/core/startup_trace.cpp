@@ -0,0 +1,79 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "core/startup_trace.h"
+
+#include <QtCore/QMutex>
+#include <atomic>
+
+namespace Core {
+namespace {
+
+struct Stage {
+	const char *name = nullptr;
+	crl::time started = 0;
+	crl::time finished = 0;
+};
+
+QMutex TraceMutex;
+std::vector<Stage> TraceStages;
+crl::time TraceStarted = 0;
+std::atomic<bool> TraceFinished = false;
+
+} // namespace
+
+StartupStage::StartupStage(const char *name)
+: _name(TraceFinished ? nullptr : name)
+, _started(_name ? crl::now() : 0) {
+}
+
+StartupStage::~StartupStage() {
+	if (_name) {
+		TraceStartupStage(_name, _started);
+	}
+}
+
+void TraceStartupStage(const char *name, crl::time started) {
+	if (TraceFinished) {
+		return;
+	}
+	const auto finished = crl::now();
+
+	QMutexLocker lock(&TraceMutex);
+	if (TraceFinished) {
+		return;
+	}
+	if (!TraceStarted || TraceStarted > started) {
+		TraceStarted = started;
+	}
+	TraceStages.push_back({ name, started, finished });
+}
+
+void FinishStartupTrace() {
+	const auto now = crl::now();
+
+	QMutexLocker lock(&TraceMutex);
+	if (TraceFinished) {
+		return;
+	}
+	TraceFinished = true;
+	const auto stages = base::take(TraceStages);
+	const auto started = TraceStarted ? TraceStarted : now;
+	lock.unlock();
+
+	// Offsets are from the start of the first stage, stages of the
+	// background threads overlap with the main thread ones.
+	for (const auto &stage : stages) {
+		LOG(("Startup Trace: %1 took %2 ms (%3 - %4)"
+			).arg(stage.name
+			).arg(stage.finished - stage.started
+			).arg(stage.started - started
+			).arg(stage.finished - started));
+	}
+	LOG(("Startup Trace: first show after %1 ms").arg(now - started));
+}
+
+} // namespace Core
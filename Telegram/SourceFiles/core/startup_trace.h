@@ -0,0 +1,32 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+
+// Measures one stage of the application start. Stages may be traced
+// from any thread, they are written to the log together when the trace
+// is finished, the stages after that are not measured.
+class StartupStage {
+public:
+	explicit StartupStage(const char *name);
+	StartupStage(const StartupStage &other) = delete;
+	StartupStage &operator=(const StartupStage &other) = delete;
+	~StartupStage();
+
+private:
+	const char *_name = nullptr;
+	crl::time _started = 0;
+
+};
+
+void TraceStartupStage(const char *name, crl::time started);
+
+// Called after the main window is shown for the first time.
+void FinishStartupTrace();
+
+} // namespace Core
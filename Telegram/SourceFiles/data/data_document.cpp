@@ -22,6 +22,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "history/history_item.h"
 #include "window/window_controller.h"
 #include "storage/cache/storage_cache_database.h"
+#include "storage/file_download.h"
 #include "boxes/confirm_box.h"
 #include "ui/image/image.h"
 #include "ui/image/image_source.h"
@@ -33,6 +34,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 namespace {
 
 constexpr auto kMemoryForCache = 32 * 1024 * 1024;
+constexpr auto kGoodThumbnailQuality = 87;
 
 using FilePathResolve = DocumentData::FilePathResolve;
 
@@ -608,6 +610,10 @@ Storage::Cache::Key DocumentData::goodThumbnailCacheKey() const {
 	return Data::DocumentThumbCacheKey(_dc, id);
 }
 
+Storage::Cache::Key DocumentData::waveformCacheKey() const {
+	return Data::DocumentWaveformCacheKey(_dc, id);
+}
+
 Image *DocumentData::goodThumbnail() const {
 	return _goodThumbnail.get();
 }
@@ -645,6 +651,40 @@ void DocumentData::setGoodThumbnailOnUpload(
 			QString(), std::move(bytes), "JPG", std::move(image)));
 }
 
+void DocumentData::setGoodThumbnailFrame(QImage &&frame) {
+	if (frame.isNull()
+		|| _goodThumbnailFrameSaved
+		|| (_goodThumbnail && _goodThumbnail->loaded())
+		|| uploading()) {
+		return;
+	}
+	_goodThumbnailFrameSaved = true;
+	crl::async([=, frame = std::move(frame)] {
+		auto bytes = QByteArray();
+		{
+			auto buffer = QBuffer(&bytes);
+			frame.save(&buffer, "JPG", kGoodThumbnailQuality);
+		}
+		crl::on_main(&session(), [=, bytes = std::move(bytes)]() mutable {
+			const auto length = bytes.size();
+			if (!length || length > Storage::kMaxFileInMemory) {
+				LOG(("App Error: Bad thumbnail data for saving to cache."));
+				return;
+			}
+			owner().cache().putIfEmpty(
+				goodThumbnailCacheKey(),
+				Storage::Cache::Database::TaggedValue(
+					std::move(bytes),
+					Data::kImageCacheTag));
+			if (_goodThumbnail) {
+				refreshGoodThumbnail();
+			} else {
+				validateGoodThumbnail();
+			}
+		});
+	});
+}
+
 bool DocumentData::saveToCache() const {
 	return (type == StickerDocument && size < Storage::kMaxStickerInMemory)
 		|| (isAnimation() && size < Storage::kMaxAnimationInMemory)
@@ -742,6 +782,12 @@ bool DocumentData::loaded(FilePathResolve resolve) const {
 			that->refreshGoodThumbnail();
 			destroyLoader();
 
+			// Count the waveform now instead of when it is first painted.
+			const auto voice = that->voice();
+			if (voice && voice->waveform.isEmpty()) {
+				Local::countVoiceWaveform(that);
+			}
+
 			if (!that->_data.isEmpty() || that->getStickerLarge()) {
 				ActiveCache().up(that);
 			}
@@ -179,7 +179,11 @@ public:
 
 	[[nodiscard]] Image *goodThumbnail() const;
 	[[nodiscard]] Storage::Cache::Key goodThumbnailCacheKey() const;
+	[[nodiscard]] Storage::Cache::Key waveformCacheKey() const;
 	void setGoodThumbnailOnUpload(QImage &&image, QByteArray &&bytes);
+	// Saves an already decoded first frame to the cache, so that the good
+	// thumbnail doesn't need to open the file and decode it once again.
+	void setGoodThumbnailFrame(QImage &&frame);
 	void refreshGoodThumbnail();
 	void replaceGoodThumbnail(std::unique_ptr<Images::Source> &&source);
 
@@ -278,6 +282,7 @@ private:
 	bool _isImage = false;
 	SupportsStreaming _supportsStreaming = SupportsStreaming::Unknown;
 	bool _inappPlaybackFailed = false;
+	bool _goodThumbnailFrameSaved = false;
 
 	mutable FileLoader *_loader = nullptr;
 
@@ -1028,6 +1028,10 @@ rpl::producer<not_null<const HistoryItem*>> Session::itemRepaintRequest() const
 }
 
 void Session::requestViewRepaint(not_null<const ViewElement*> view) {
+	if (_updatesBatchLevel > 0) {
+		_viewsRepaintDelayed.emplace(view);
+		return;
+	}
 	_viewRepaintRequest.fire_copy(view);
 }
 
@@ -1133,6 +1137,54 @@ void Session::sendHistoryChangeNotifications() {
 	}
 }
 
+void Session::startUpdatesBatch() {
+	++_updatesBatchLevel;
+}
+
+void Session::finishUpdatesBatch() {
+	Expects(_updatesBatchLevel > 0);
+
+	if (--_updatesBatchLevel > 0) {
+		return;
+	}
+	// Sort keys of all the changed entries were updated already, so the
+	// positions can't be adjusted one by one, the lists are sorted once.
+	if (const auto changed = base::take(_chatListSortChanged); !changed.empty()) {
+		for (const auto &key : changed) {
+			key.entry()->applyChatListSortPosition();
+		}
+		if (const auto main = App::main()) {
+			main->sortDialogsByPos();
+		}
+	}
+	if (base::take(_unreadCounterUpdatePending)) {
+		Notify::unreadCounterUpdated();
+	}
+	sendHistoryChangeNotifications();
+	for (const auto view : base::take(_viewsRepaintDelayed)) {
+		_viewRepaintRequest.fire_copy(view);
+	}
+	Notify::peerUpdatedSendDelayed();
+}
+
+bool Session::updatesBatchActive() const {
+	return (_updatesBatchLevel > 0);
+}
+
+void Session::notifyUnreadCounterUpdated() {
+	if (_updatesBatchLevel > 0) {
+		_unreadCounterUpdatePending = true;
+		return;
+	}
+	Notify::unreadCounterUpdated();
+}
+
+void Session::registerChatListSortChange(const Dialogs::Key &key) {
+	Expects(_updatesBatchLevel > 0);
+
+	_chatListSortChanged.emplace(key);
+}
+
 void Session::removeMegagroupParticipant(
 		not_null<ChannelData*> channel,
 		not_null<UserData*> user) {
@@ -1567,7 +1619,7 @@ void Session::unreadIncrement(int count, bool muted) {
 	}
 	if (_session->settings().countUnreadMessages()) {
 		if (!muted || _session->settings().includeMutedCounter()) {
-			Notify::unreadCounterUpdated();
+			notifyUnreadCounterUpdated();
 		}
 	}
 }
@@ -1584,7 +1636,7 @@ void Session::unreadMuteChanged(int count, bool muted) {
 		const auto changed = !_session->settings().includeMutedCounter()
 			|| (wasAll != nowAll);
 		if (changed) {
-			Notify::unreadCounterUpdated();
+			notifyUnreadCounterUpdated();
 		}
 	}
 }
@@ -1606,7 +1658,7 @@ void Session::unreadEntriesChanged(
 		const auto withoutMutedChanged = !withMuted
 			&& (withUnreadDelta != mutedWithUnreadDelta);
 		if (withMutedChanged || withoutMutedChanged) {
-			Notify::unreadCounterUpdated();
+			notifyUnreadCounterUpdated();
 		}
 	}
 }
@@ -2773,6 +2825,8 @@ void Session::registerItemView(not_null<ViewElement*> view) {
 }
 
 void Session::unregisterItemView(not_null<ViewElement*> view) {
+	_viewsRepaintDelayed.remove(view);
+
 	const auto i = _views.find(view->data());
 	if (i != end(_views)) {
 		auto &list = i->second;
@@ -183,6 +183,15 @@ public:
 	[[nodiscard]] rpl::producer<not_null<History*>> historyChanged() const;
 	void sendHistoryChangeNotifications();
 
+	// While a batch of updates (like getDifference) is being applied
+	// chat list reorders, unread counter updates and view repaints are
+	// collected and done once.
+	void startUpdatesBatch();
+	void finishUpdatesBatch();
+	[[nodiscard]] bool updatesBatchActive() const;
+	void registerChatListSortChange(const Dialogs::Key &key);
+	void notifyUnreadCounterUpdated();
+
 	using MegagroupParticipant = std::tuple<
 		not_null<ChannelData*>,
 		not_null<UserData*>>;
@@ -703,6 +712,10 @@ private:
 	rpl::event_stream<not_null<const History*>> _historyUnloaded;
 	rpl::event_stream<not_null<const History*>> _historyCleared;
 	base::flat_set<not_null<History*>> _historiesChanged;
+	int _updatesBatchLevel = 0;
+	base::flat_set<Dialogs::Key> _chatListSortChanged;
+	bool _unreadCounterUpdatePending = false;
+	base::flat_set<not_null<const ViewElement*>> _viewsRepaintDelayed;
 	rpl::event_stream<not_null<History*>> _historyChanged;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantRemoved;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantAdded;
@@ -20,6 +20,8 @@ constexpr auto kDocumentCacheTag = 0x0000000000000100ULL;
 constexpr auto kDocumentCacheMask = 0x00000000000000FFULL;
 constexpr auto kDocumentThumbCacheTag = 0x0000000000000200ULL;
 constexpr auto kDocumentThumbCacheMask = 0x00000000000000FFULL;
+constexpr auto kDocumentWaveformCacheTag = 0x0000000000000300ULL;
+constexpr auto kDocumentWaveformCacheMask = 0x00000000000000FFULL;
 constexpr auto kStorageCacheTag = 0x0000010000000000ULL;
 constexpr auto kStorageCacheMask = 0x000000FFFFFFFFFFULL;
 constexpr auto kWebDocumentCacheTag = 0x0000020000000000ULL;
@@ -28,6 +30,7 @@ constexpr auto kUrlCacheTag = 0x0000030000000000ULL;
 constexpr auto kUrlCacheMask = 0x000000FFFFFFFFFFULL;
 constexpr auto kGeoPointCacheTag = 0x0000040000000000ULL;
 constexpr auto kGeoPointCacheMask = 0x000000FFFFFFFFFFULL;
+constexpr auto kStickerSetCacheTag = 0x0000050000000000ULL;
 
 } // namespace
 
@@ -60,6 +63,14 @@ Storage::Cache::Key DocumentThumbCacheKey(int32 dcId, uint64 id) {
 	};
 }
 
+Storage::Cache::Key DocumentWaveformCacheKey(int32 dcId, uint64 id) {
+	const auto part = (uint64(dcId) & Data::kDocumentWaveformCacheMask);
+	return Storage::Cache::Key{
+		Data::kDocumentWaveformCacheTag | part,
+		id
+	};
+}
+
 Storage::Cache::Key StorageCacheKey(const StorageImageLocation &location) {
 	const auto dcId = uint64(location.dc()) & 0xFFULL;
 	return Storage::Cache::Key{
@@ -113,6 +124,10 @@ Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location) {
 	};
 }
 
+Storage::Cache::Key StickerSetCacheKey(uint64 setId) {
+	return Storage::Cache::Key{ Data::kStickerSetCacheTag, setId };
+}
+
 ReplyPreview::ReplyPreview() = default;
 
 ReplyPreview::ReplyPreview(ReplyPreview &&other) = default;
@@ -96,11 +96,26 @@ void Entry::updateChatListSortPosition() {
 		: isPinnedDialog()
 		? PinnedDialogPos(_pinnedIndex)
 		: DialogPosFromDate(adjustChatListTimeId());
+	if (Auth().data().updatesBatchActive()) {
+		Auth().data().registerChatListSortChange(_key);
+		return;
+	}
 	if (needUpdateInChatList()) {
 		setChatListExistence(true);
 	}
 }
 
+void Entry::applyChatListSortPosition() {
+	const auto addToImportant = toImportant()
+		&& !inChatList(Dialogs::Mode::Important);
+	if (inChatList(Dialogs::Mode::All) && !addToImportant) {
+		// The lists are sorted once after all the batched changes.
+		updateChatListEntry();
+	} else if (needUpdateInChatList()) {
+		setChatListExistence(true);
+	}
+}
+
 void Entry::updateChatListExistence() {
 	setChatListExistence(shouldBeInChatList());
 }
@@ -135,7 +150,7 @@ const RowsByLetter &Entry::chatListLinks(Mode list) const {
 }
 
 Row *Entry::mainChatListLink(Mode list) const {
-	auto it = chatListLinks(list).find(0);
+	auto it = chatListLinks(list).find(QChar(0));
 	Assert(it != chatListLinks(list).cend());
 	return it->second;
 }
@@ -14,7 +14,8 @@ namespace Dialogs {
 
 class Row;
 class IndexedList;
-using RowsByLetter = base::flat_map<QChar, not_null<Row*>>;
+// A few rows per entry, looked up on every chat list position change.
+using RowsByLetter = base::flat_vector_map<QChar, not_null<Row*>>;
 
 enum class SortMode {
 	Date = 0x00,
@@ -89,6 +90,10 @@ public:
 		return _sortKeyInChatList;
 	}
 	void updateChatListSortPosition();
+
+	// Adds the entry to the chat lists after an updates batch, the rows
+	// that are already there are moved by sorting the whole lists.
+	void applyChatListSortPosition();
 	void setChatListTimeId(TimeId date);
 	virtual void updateChatListExistence();
 	bool needUpdateInChatList() const;
@@ -22,7 +22,7 @@ IndexedList::IndexedList(SortMode sortMode)
 RowsByLetter IndexedList::addToEnd(Key key) {
 	RowsByLetter result;
 	if (!_list.contains(key)) {
-		result.emplace(0, _list.addToEnd(key));
+		result.emplace(QChar(0), _list.addToEnd(key));
 		for (const auto ch : key.entry()->chatListFirstLetters()) {
 			auto j = _index.find(ch);
 			if (j == _index.cend()) {
@@ -70,6 +70,14 @@ void IndexedList::adjustByPos(const RowsByLetter &links) {
 	}
 }
 
+void IndexedList::sortByPos() {
+	_list.sortByPos();
+	for (const auto &[ch, list] : _index) {
+		list->sortByPos();
+	}
+	performFilter();
+}
+
 void IndexedList::moveToTop(Key key) {
 	if (_list.moveToTop(key)) {
 		for (const auto ch : key.entry()->chatListFirstLetters()) {
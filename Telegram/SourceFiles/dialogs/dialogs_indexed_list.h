@@ -22,6 +22,10 @@ public:
 	RowsByLetter addToEnd(Key key);
 	Row *addByName(Key key);
 	void adjustByPos(const RowsByLetter &links);
+
+	// Puts all the rows back in order after their sort keys were changed
+	// without adjusting positions, like in a batch of updates.
+	void sortByPos();
 	void moveToTop(Key key);
 
 	// row must belong to this indexed list all().
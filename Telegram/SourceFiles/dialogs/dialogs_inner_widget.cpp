@@ -1322,6 +1322,15 @@ void DialogsInner::createDialog(Dialogs::Key key) {
 	}
 }
 
+void DialogsInner::sortDialogsByPos() {
+	_dialogs->sortByPos();
+	if (_dialogsImportant) {
+		_dialogsImportant->sortByPos();
+	}
+	refresh();
+	update();
+}
+
 void DialogsInner::removeDialog(Dialogs::Key key) {
 	if (key == _menuRow.key && _menu) {
 		InvokeQueued(this, [=] { _menu = nullptr; });
@@ -53,6 +53,7 @@ public:
 
 	void createDialog(Dialogs::Key key);
 	void removeDialog(Dialogs::Key key);
+	void sortDialogsByPos();
 	void repaintDialogRow(Dialogs::Mode list, not_null<Dialogs::Row*> row);
 	void repaintDialogRow(Dialogs::RowDescriptor row);
 
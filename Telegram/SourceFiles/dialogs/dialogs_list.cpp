@@ -174,6 +174,32 @@ void List::adjustByPos(Row *row) {
 	}
 }
 
+void List::sortByPos() {
+	if (_sortMode != SortMode::Date || _count < 2) return;
+
+	auto rows = std::vector<Row*>();
+	rows.reserve(_count);
+	for (auto row = _begin; row != _end; row = row->_next) {
+		rows.push_back(row);
+	}
+	std::stable_sort(rows.begin(), rows.end(), [](Row *a, Row *b) {
+		return (a->sortKey() > b->sortKey());
+	});
+	auto prev = (Row*)nullptr;
+	auto pos = 0;
+	for (const auto row : rows) {
+		row->_prev = prev;
+		row->_pos = pos++;
+		if (prev) {
+			prev->_next = row;
+		}
+		prev = row;
+	}
+	prev->_next = _end;
+	_end->_prev = prev;
+	_begin = _current = rows.front();
+}
+
 bool List::moveToTop(Key key) {
 	auto i = _rowByKey.find(key);
 	if (i == _rowByKey.cend()) {
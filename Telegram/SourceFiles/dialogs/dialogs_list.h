@@ -45,6 +45,7 @@ public:
 	Row *addByName(Key key);
 	bool moveToTop(Key key);
 	void adjustByPos(Row *row);
+	void sortByPos();
 	bool del(Key key, Row *replacedBy = nullptr);
 	void remove(Row *row);
 	void clear();
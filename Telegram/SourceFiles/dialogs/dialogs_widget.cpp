@@ -1559,6 +1559,10 @@ void DialogsWidget::removeDialog(Dialogs::Key key) {
 	_inner->removeDialog(key);
 }
 
+void DialogsWidget::sortDialogsByPos() {
+	_inner->sortDialogsByPos();
+}
+
 Dialogs::IndexedList *DialogsWidget::contactsList() {
 	return _inner->contactsList();
 }
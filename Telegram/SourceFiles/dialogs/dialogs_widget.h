@@ -61,6 +61,7 @@ public:
 	void loadPinnedDialogs();
 	void createDialog(Dialogs::Key key);
 	void removeDialog(Dialogs::Key key);
+	void sortDialogsByPos();
 	void repaintDialogRow(Dialogs::Mode list, not_null<Dialogs::Row*> row);
 	void repaintDialogRow(Dialogs::RowDescriptor row);
 
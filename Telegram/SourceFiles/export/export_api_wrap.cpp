@@ -10,9 +10,14 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_file.h"
+#include "export/output/export_output_journal.h"
+#include "export/output/export_output_stats.h"
 #include "mtproto/rpc_sender.h"
 #include "base/value_ordering.h"
 #include "base/bytes.h"
+
+#include <QtCore/QCryptographicHash>
+
 #include <set>
 #include <deque>
 
@@ -22,9 +27,10 @@ namespace {
 constexpr auto kUserpicsSliceLimit = 100;
 constexpr auto kFileChunkSize = 128 * 1024;
 constexpr auto kFileRequestsCount = 2;
-constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFilesInParallel = 4;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
+constexpr auto kMessagesSlicesInParallel = 2;
 constexpr auto kTopPeerSliceLimit = 100;
 constexpr auto kFileMaxSize = 1500 * 1024 * 1024;
 constexpr auto kLocationCacheSize = 100'000;
@@ -36,6 +42,9 @@ struct LocationKey {
 	inline bool operator<(const LocationKey &other) const {
 		return std::tie(type, id) < std::tie(other.type, other.id);
 	}
+	inline bool operator==(const LocationKey &other) const {
+		return std::tie(type, id) == std::tie(other.type, other.id);
+	}
 };
 
 std::tuple<const uint64 &, const uint64 &> value_ordering_helper(const LocationKey &value) {
@@ -66,6 +75,13 @@ LocationKey ComputeLocationKey(const Data::FileLocation &value) {
 	return result;
 }
 
+QByteArray ComputeJournalKey(const Data::FileLocation &value) {
+	const auto key = ComputeLocationKey(value);
+	return QByteArray::number(key.type, 16)
+		+ '_'
+		+ QByteArray::number(key.id, 16);
+}
+
 Settings::Type SettingsFromDialogsType(Data::DialogInfo::Type type) {
 	using DialogType = Data::DialogInfo::Type;
 	switch (type) {
@@ -137,7 +153,7 @@ struct ApiWrap::UserpicsProcess {
 	std::optional<Data::UserpicsSlice> slice;
 	uint64 maxId = 0;
 	bool lastSlice = false;
-	int fileIndex = 0;
+	base::flat_set<int> filesLoading;
 };
 
 struct ApiWrap::OtherDataProcess {
@@ -150,9 +166,10 @@ struct ApiWrap::FileProcess {
 
 	Output::File file;
 	QString relativePath;
+	QCryptographicHash hash{ QCryptographicHash::Sha256 };
 
 	Fn<bool(FileProgress)> progress;
-	FnMut<void(const QString &relativePath)> done;
+	std::vector<FnMut<void(const QString &relativePath)>> done;
 
 	Data::FileLocation location;
 	int offset = 0;
@@ -166,6 +183,7 @@ struct ApiWrap::FileProcess {
 };
 
 struct ApiWrap::FileProgress {
+	QString path;
 	int ready = 0;
 	int total = 0;
 };
@@ -192,6 +210,13 @@ struct ApiWrap::DialogsProcess : ChatsProcess {
 	MTPInputPeer offsetPeer = MTP_inputPeerEmpty();
 };
 
+struct ApiWrap::ChatSlice {
+	int id = 0;
+	Data::MessagesSlice data;
+	base::flat_multi_set<int> filesLoading;
+	bool filesQueued = false;
+};
+
 struct ApiWrap::ChatProcess {
 	Data::DialogInfo info;
 
@@ -206,9 +231,14 @@ struct ApiWrap::ChatProcess {
 	int32 largestIdPlusOne = 1;
 
 	Data::ParseMediaContext context;
-	std::optional<Data::MessagesSlice> slice;
+
+	// The next slice is requested and its files start loading while
+	// the files of the current one are not loaded yet.
+	std::deque<ChatSlice> slices;
+	int lastSliceId = 0;
+	bool requesting = false;
 	bool lastSlice = false;
-	int fileIndex = 0;
+	bool stopped = false;
 };
 
 
@@ -350,7 +380,10 @@ auto ApiWrap::splitRequest(int index, Request &&request) {
 		std::forward<Request>(request)));
 }
 
-auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
+auto ApiWrap::fileRequest(
+		uint64 id,
+		const Data::FileLocation &location,
+		int offset) {
 	Expects(location.dcId != 0
 		|| location.data.type() == mtpc_inputTakeoutFileLocation);
 	Expects(_takeoutId.has_value());
@@ -364,12 +397,12 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 	)).fail([=](RPCError &&result) {
 		if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
 			&& _otherDataProcess != nullptr) {
-			filePartDone(0, MTP_upload_file(MTP_storage_filePartial(),
+			filePartDone(id, 0, MTP_upload_file(MTP_storage_filePartial(),
 				MTP_int(0),
 				MTP_bytes(QByteArray())));
 		} else if (result.type() == qstr("LOCATION_INVALID")
 			|| result.type() == qstr("VERSION_INVALID")) {
-			filePartUnavailable();
+			filePartUnavailable(id);
 		} else {
 			error(std::move(result));
 		}
@@ -392,12 +425,14 @@ rpl::producer<Output::Result> ApiWrap::ioErrors() const {
 void ApiWrap::startExport(
 		const Settings &settings,
 		Output::Stats *stats,
+		not_null<Output::Journal*> journal,
 		FnMut<void(StartInfo)> done) {
 	Expects(_settings == nullptr);
 	Expects(_startProcess == nullptr);
 
 	_settings = std::make_unique<Settings>(settings);
 	_stats = stats;
+	_journal = journal;
 	_startProcess = std::make_unique<StartProcess>();
 	_startProcess->done = std::move(done);
 
@@ -731,31 +766,28 @@ void ApiWrap::handleUserpicsSlice(const MTPphotos_Photos &result) {
 void ApiWrap::loadUserpicsFiles(Data::UserpicsSlice &&slice) {
 	Expects(_userpicsProcess != nullptr);
 	Expects(!_userpicsProcess->slice.has_value());
+	Expects(_userpicsProcess->filesLoading.empty());
 
 	if (slice.list.empty()) {
 		_userpicsProcess->lastSlice = true;
 	}
 	_userpicsProcess->slice = std::move(slice);
-	_userpicsProcess->fileIndex = 0;
-	loadNextUserpic();
-}
-
-void ApiWrap::loadNextUserpic() {
-	Expects(_userpicsProcess != nullptr);
-	Expects(_userpicsProcess->slice.has_value());
 
-	for (auto &list = _userpicsProcess->slice->list
-		; _userpicsProcess->fileIndex < list.size()
-		; ++_userpicsProcess->fileIndex) {
+	auto &list = _userpicsProcess->slice->list;
+	for (auto index = 0; index != list.size(); ++index) {
 		const auto ready = processFileLoad(
-			list[_userpicsProcess->fileIndex].image.file,
-			[=](FileProgress value) { return loadUserpicProgress(value); },
-			[=](const QString &path) { loadUserpicDone(path); });
+			list[index].image.file,
+			[=](FileProgress value) {
+				return loadUserpicProgress(index, value);
+			},
+			[=](const QString &path) { loadUserpicDone(index, path); });
 		if (!ready) {
-			return;
+			_userpicsProcess->filesLoading.emplace(index);
 		}
 	}
-	finishUserpicsSlice();
+	if (_userpicsProcess->filesLoading.empty()) {
+		finishUserpicsSlice();
+	}
 }
 
 void ApiWrap::finishUserpicsSlice() {
@@ -785,35 +817,37 @@ void ApiWrap::finishUserpicsSlice() {
 	}).send();
 }
 
-bool ApiWrap::loadUserpicProgress(FileProgress progress) {
-	Expects(_fileProcess != nullptr);
+bool ApiWrap::loadUserpicProgress(int index, FileProgress progress) {
 	Expects(_userpicsProcess != nullptr);
 	Expects(_userpicsProcess->slice.has_value());
-	Expects((_userpicsProcess->fileIndex >= 0)
-		&& (_userpicsProcess->fileIndex
-			< _userpicsProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _userpicsProcess->slice->list.size()));
 
+	// Several userpics are loaded at once, show the first unfinished one.
+	const auto &loading = _userpicsProcess->filesLoading;
+	if (!loading.empty() && loading.front() != index) {
+		return true;
+	}
 	return _userpicsProcess->fileProgress(DownloadProgress{
-		_fileProcess->relativePath,
-		_userpicsProcess->fileIndex,
+		progress.path,
+		index,
 		progress.ready,
 		progress.total });
 }
 
-void ApiWrap::loadUserpicDone(const QString &relativePath) {
+void ApiWrap::loadUserpicDone(int index, const QString &relativePath) {
 	Expects(_userpicsProcess != nullptr);
 	Expects(_userpicsProcess->slice.has_value());
-	Expects((_userpicsProcess->fileIndex >= 0)
-		&& (_userpicsProcess->fileIndex
-			< _userpicsProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _userpicsProcess->slice->list.size()));
 
-	const auto index = _userpicsProcess->fileIndex;
 	auto &file = _userpicsProcess->slice->list[index].image.file;
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
-	loadNextUserpic();
+	_userpicsProcess->filesLoading.remove(index);
+	if (_userpicsProcess->filesLoading.empty()) {
+		finishUserpicsSlice();
+	}
 }
 
 void ApiWrap::finishUserpics() {
@@ -1238,13 +1272,16 @@ void ApiWrap::appendChatsSlice(
 
 void ApiWrap::requestMessagesSlice() {
 	Expects(_chatProcess != nullptr);
+	Expects(!_chatProcess->requesting);
+	Expects(!_chatProcess->lastSlice);
 
 	const auto count = _chatProcess->info.messagesCountPerSplit[
 		_chatProcess->localSplitIndex];
 	if (!count) {
-		loadMessagesFiles({});
+		appendMessagesSlice({}, true);
 		return;
 	}
+	_chatProcess->requesting = true;
 	requestChatMessages(
 		_chatProcess->info.splits[_chatProcess->localSplitIndex],
 		_chatProcess->largestIdPlusOne,
@@ -1253,18 +1290,18 @@ void ApiWrap::requestMessagesSlice() {
 		[=](const MTPmessages_Messages &result) {
 		Expects(_chatProcess != nullptr);
 
+		_chatProcess->requesting = false;
 		result.match([&](const MTPDmessages_messagesNotModified &data) {
 			error("Unexpected messagesNotModified received.");
 		}, [&](const auto &data) {
-			if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
-				_chatProcess->lastSlice = true;
-			}
-			loadMessagesFiles(Data::ParseMessagesSlice(
-				_chatProcess->context,
-				data.vmessages,
-				data.vusers,
-				data.vchats,
-				_chatProcess->info.relativePath));
+			appendMessagesSlice(
+				Data::ParseMessagesSlice(
+					_chatProcess->context,
+					data.vmessages,
+					data.vusers,
+					data.vchats,
+					_chatProcess->info.relativePath),
+				MTPDmessages_messages::Is<decltype(data)>());
 		});
 	});
 }
@@ -1333,131 +1370,158 @@ void ApiWrap::requestChatMessages(
 	}
 }
 
-void ApiWrap::loadMessagesFiles(Data::MessagesSlice &&slice) {
+void ApiWrap::appendMessagesSlice(Data::MessagesSlice &&slice, bool last) {
 	Expects(_chatProcess != nullptr);
-	Expects(!_chatProcess->slice.has_value());
 
-	if (slice.list.empty()) {
-		_chatProcess->lastSlice = true;
+	const auto process = _chatProcess.get();
+	if (!slice.list.empty()) {
+		process->largestIdPlusOne = slice.list.back().id + 1;
 	}
-	_chatProcess->slice = std::move(slice);
-	_chatProcess->fileIndex = 0;
-
-	loadNextMessageFile();
+	if (last || slice.list.empty()) {
+		if (++process->localSplitIndex < process->info.splits.size()) {
+			process->largestIdPlusOne = 1;
+		} else {
+			process->lastSlice = true;
+		}
+	}
+	if (!slice.list.empty()) {
+		process->slices.push_back({ ++process->lastSliceId });
+		process->slices.back().data = std::move(slice);
+		loadMessagesFiles(process->slices.back());
+	}
+	processMessagesSlices();
 }
 
-void ApiWrap::loadNextMessageFile() {
+void ApiWrap::loadMessagesFiles(ChatSlice &slice) {
 	Expects(_chatProcess != nullptr);
-	Expects(_chatProcess->slice.has_value());
+	Expects(!slice.filesQueued);
 
-	for (auto &list = _chatProcess->slice->list
-		; _chatProcess->fileIndex < list.size()
-		; ++_chatProcess->fileIndex) {
-		const auto &message = list[_chatProcess->fileIndex];
+	const auto id = slice.id;
+	auto &list = slice.data.list;
+	for (auto index = 0; index != list.size(); ++index) {
+		auto &message = list[index];
 		if (Data::SkipMessageByDate(message, *_settings)) {
 			continue;
 		}
-		const auto fileProgress = [=](FileProgress value) {
-			return loadMessageFileProgress(value);
+		const auto progress = [=](FileProgress value) {
+			return loadMessageFileProgress(id, index, value);
 		};
-		const auto ready = processFileLoad(
-			list[_chatProcess->fileIndex].file(),
-			fileProgress,
-			[=](const QString &path) { loadMessageFileDone(path); },
-			&list[_chatProcess->fileIndex]);
-		if (!ready) {
-			return;
+		const auto fileReady = processFileLoad(
+			message.file(),
+			progress,
+			[=](const QString &path) { loadMessageFileDone(id, index, path); },
+			&message);
+		if (!fileReady) {
+			slice.filesLoading.emplace(index);
 		}
-		const auto thumbProgress = [=](FileProgress value) {
-			return loadMessageThumbProgress(value);
-		};
 		const auto thumbReady = processFileLoad(
-			list[_chatProcess->fileIndex].thumb().file,
-			thumbProgress,
-			[=](const QString &path) { loadMessageThumbDone(path); },
-			&list[_chatProcess->fileIndex]);
+			message.thumb().file,
+			progress,
+			[=](const QString &path) { loadMessageThumbDone(id, index, path); },
+			&message);
 		if (!thumbReady) {
-			return;
+			slice.filesLoading.emplace(index);
 		}
 	}
-	finishMessagesSlice();
+	slice.filesQueued = true;
 }
 
-void ApiWrap::finishMessagesSlice() {
+void ApiWrap::processMessagesSlices() {
 	Expects(_chatProcess != nullptr);
-	Expects(_chatProcess->slice.has_value());
 
-	auto slice = *base::take(_chatProcess->slice);
-	if (!slice.list.empty()) {
-		_chatProcess->largestIdPlusOne = slice.list.back().id + 1;
+	if (_chatProcess->stopped) {
+		return;
+	}
+
+	// Slices go to the writer strictly in the order they were received.
+	auto &slices = _chatProcess->slices;
+	while (!slices.empty()
+		&& slices.front().filesQueued
+		&& slices.front().filesLoading.empty()) {
+		auto slice = std::move(slices.front().data);
+		slices.pop_front();
 		if (!_chatProcess->handleSlice(std::move(slice))) {
+			_chatProcess->stopped = true;
 			return;
 		}
 	}
-	if (_chatProcess->lastSlice
-		&& (++_chatProcess->localSplitIndex
-			< _chatProcess->info.splits.size())) {
-		_chatProcess->lastSlice = false;
-		_chatProcess->largestIdPlusOne = 1;
-	}
 	if (!_chatProcess->lastSlice) {
-		requestMessagesSlice();
-	} else {
+		if (!_chatProcess->requesting
+			&& slices.size() < kMessagesSlicesInParallel) {
+			requestMessagesSlice();
+		}
+	} else if (slices.empty()) {
 		finishMessages();
 	}
 }
 
-bool ApiWrap::loadMessageFileProgress(FileProgress progress) {
-	Expects(_fileProcess != nullptr);
+auto ApiWrap::messagesSlice(int sliceId) -> ChatSlice* {
 	Expects(_chatProcess != nullptr);
-	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
 
+	auto &slices = _chatProcess->slices;
+	const auto i = ranges::find(slices, sliceId, &ChatSlice::id);
+	return (i != end(slices)) ? &*i : nullptr;
+}
+
+bool ApiWrap::loadMessageFileProgress(
+		int sliceId,
+		int index,
+		FileProgress progress) {
+	Expects(_chatProcess != nullptr);
+
+	// Several files are loaded at once, show the first unfinished one.
+	const auto &slices = _chatProcess->slices;
+	if (slices.empty() || slices.front().id != sliceId) {
+		return true;
+	}
+	const auto &loading = slices.front().filesLoading;
+	if (!loading.empty() && loading.front() != index) {
+		return true;
+	}
 	return _chatProcess->fileProgress(DownloadProgress{
-		_fileProcess->relativePath,
-		_chatProcess->fileIndex,
+		progress.path,
+		index,
 		progress.ready,
 		progress.total });
 }
 
-void ApiWrap::loadMessageFileDone(const QString &relativePath) {
-	Expects(_chatProcess != nullptr);
-	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+void ApiWrap::loadMessageFileDone(
+		int sliceId,
+		int index,
+		const QString &relativePath) {
+	const auto slice = messagesSlice(sliceId);
+	Assert(slice != nullptr);
+	Assert((index >= 0) && (index < slice->data.list.size()));
 
-	const auto index = _chatProcess->fileIndex;
-	auto &file = _chatProcess->slice->list[index].file();
+	auto &file = slice->data.list[index].file();
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
-	loadNextMessageFile();
-}
-
-bool ApiWrap::loadMessageThumbProgress(FileProgress progress) {
-	return loadMessageFileProgress(progress);
+	slice->filesLoading.removeOne(index);
+	processMessagesSlices();
 }
 
-void ApiWrap::loadMessageThumbDone(const QString &relativePath) {
-	Expects(_chatProcess != nullptr);
-	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+void ApiWrap::loadMessageThumbDone(
+		int sliceId,
+		int index,
+		const QString &relativePath) {
+	const auto slice = messagesSlice(sliceId);
+	Assert(slice != nullptr);
+	Assert((index >= 0) && (index < slice->data.list.size()));
 
-	const auto index = _chatProcess->fileIndex;
-	auto &file = _chatProcess->slice->list[index].thumb().file;
+	auto &file = slice->data.list[index].thumb().file;
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
-	loadNextMessageFile();
+	slice->filesLoading.removeOne(index);
+	processMessagesSlices();
 }
 
 void ApiWrap::finishMessages() {
 	Expects(_chatProcess != nullptr);
-	Expects(!_chatProcess->slice.has_value());
+	Expects(_chatProcess->slices.empty());
 
 	const auto process = base::take(_chatProcess);
 	process->done();
@@ -1524,11 +1588,22 @@ bool ApiWrap::writePreloadedFile(Data::File &file) {
 	if (const auto path = _fileCache->find(file.location)) {
 		file.relativePath = *path;
 		return true;
+	} else if (const auto path = findJournalFile(file.location)) {
+		file.relativePath = *path;
+		return true;
 	} else if (!file.content.isEmpty()) {
 		const auto process = prepareFileProcess(file);
-		if (const auto result = process->file.writeBlock(file.content)) {
+		auto result = process->file.writeBlock(file.content);
+		if (result) {
+			result = process->file.flush();
+		}
+		if (result) {
 			file.relativePath = process->relativePath;
 			_fileCache->save(file.location, file.relativePath);
+			saveJournalFile(
+				file.location,
+				file.relativePath,
+				process->file.size());
 		} else {
 			ioError(result);
 		}
@@ -1537,37 +1612,134 @@ bool ApiWrap::writePreloadedFile(Data::File &file) {
 	return false;
 }
 
+std::optional<QString> ApiWrap::findJournalFile(
+		const Data::FileLocation &location) {
+	Expects(_journal != nullptr);
+
+	if (!location) {
+		return std::nullopt;
+	}
+	const auto entry = _journal->findFile(ComputeJournalKey(location));
+	if (!entry) {
+		return std::nullopt;
+	}
+	if (_stats) {
+		_stats->incrementFiles();
+		_stats->incrementBytes(entry->size);
+	}
+	_fileCache->save(location, entry->relativePath);
+	return entry->relativePath;
+}
+
+bool ApiWrap::saveJournalFile(
+		const Data::FileLocation &location,
+		const QString &relativePath,
+		int64 size) {
+	Expects(_journal != nullptr);
+
+	if (!location) {
+		return true;
+	}
+	const auto result = _journal->fileDone(
+		ComputeJournalKey(location),
+		relativePath,
+		size);
+	if (!result) {
+		ioError(result);
+		return false;
+	}
+	return true;
+}
+
+std::optional<QString> ApiWrap::deduplicateFile(FileProcess &process) {
+	Expects(_settings != nullptr);
+	Expects(_journal != nullptr);
+
+	// The same photo or document forwarded to several chats is received
+	// with different locations, keep only the first copy of the bytes.
+	const auto size = process.file.size();
+	if (!size) {
+		return process.relativePath;
+	}
+	const auto hash = process.hash.result();
+	const auto existing = _journal->findContent(hash);
+	if (!existing || existing->size != size) {
+		const auto result = _journal->contentDone(
+			hash,
+			process.relativePath,
+			size);
+		if (!result) {
+			ioError(result);
+			return std::nullopt;
+		}
+		return process.relativePath;
+	}
+	process.file.close();
+	if (!QFile::remove(_settings->path + process.relativePath)) {
+		return process.relativePath;
+	}
+	if (_stats) {
+		_stats->removeDuplicate(size);
+	}
+	return existing->relativePath;
+}
+
 void ApiWrap::loadFile(
 		const Data::File &file,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done) {
-	Expects(_fileProcess == nullptr);
 	Expects(file.location.dcId != 0
 		|| file.location.data.type() == mtpc_inputTakeoutFileLocation);
 
-	_fileProcess = prepareFileProcess(file);
-	_fileProcess->progress = std::move(progress);
-	_fileProcess->done = std::move(done);
-
-	if (_fileProcess->progress) {
-		const auto progress = FileProgress{
-			_fileProcess->file.size(),
-			_fileProcess->size
-		};
-		if (!_fileProcess->progress(progress)) {
+	const auto key = ComputeLocationKey(file.location);
+	for (const auto &[id, process] : _fileProcesses) {
+		if (ComputeLocationKey(process->location) == key) {
+			// The same file is attached to several messages in one slice.
+			process->done.push_back(std::move(done));
 			return;
 		}
 	}
 
-	loadFilePart();
+	auto process = prepareFileProcess(file);
+	process->progress = std::move(progress);
+	process->done.push_back(std::move(done));
+
+	const auto id = ++_lastFileProcessId;
+	_fileProcesses.emplace(id, std::move(process));
+	_fileProcessesQueue.push_back(id);
+	startFileProcesses();
 }
 
-auto ApiWrap::prepareFileProcess(const Data::File &file) const
+void ApiWrap::startFileProcesses() {
+	while (_fileProcessesLoading < kFilesInParallel
+		&& !_fileProcessesQueue.empty()) {
+		const auto id = _fileProcessesQueue.front();
+		_fileProcessesQueue.pop_front();
+
+		const auto i = _fileProcesses.find(id);
+		Assert(i != end(_fileProcesses));
+		const auto process = i->second.get();
+		++_fileProcessesLoading;
+		if (process->progress) {
+			const auto progress = FileProgress{
+				process->relativePath,
+				int(process->file.size()),
+				process->size
+			};
+			if (!process->progress(progress)) {
+				return;
+			}
+		}
+		loadFilePart(id);
+	}
+}
+
+auto ApiWrap::prepareFileProcess(const Data::File &file)
 -> std::unique_ptr<FileProcess> {
 	Expects(_settings != nullptr);
+	Expects(_journal != nullptr);
 
-	const auto relativePath = Output::File::PrepareRelativePath(
-		_settings->path,
+	const auto relativePath = _journal->prepareRelativePath(
 		file.suggestedPath);
 	auto result = std::make_unique<FileProcess>(
 		_settings->path + relativePath,
@@ -1578,40 +1750,45 @@ auto ApiWrap::prepareFileProcess(const Data::File &file) const
 	return result;
 }
 
-void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
+void ApiWrap::loadFilePart(uint64 id) {
+	const auto i = _fileProcesses.find(id);
+	if (i == end(_fileProcesses)) {
 		return;
 	}
-
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	fileRequest(
-		_fileProcess->location,
-		_fileProcess->offset
-	).done([=](const MTPupload_File &result) {
-		filePartDone(offset, result);
-	}).send();
-	_fileProcess->offset += kFileChunkSize;
-
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
+	const auto process = i->second.get();
+
+	// Parts of a file with unknown size are requested one by one,
+	// until an empty part is received.
+	const auto canRequestMore = [&] {
+		return (process->requests.size() < kFileRequestsCount)
+			&& ((process->size > 0)
+				? (process->offset < process->size)
+				: process->requests.empty());
+	};
+	while (canRequestMore()) {
+		const auto offset = process->offset;
+		process->requests.push_back({ offset });
+		fileRequest(
+			id,
+			process->location,
+			offset
+		).done([=](const MTPupload_File &result) {
+			filePartDone(id, offset, result);
+		}).send();
+		process->offset += kFileChunkSize;
 	}
 }
 
-void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartDone(
+		uint64 id,
+		int offset,
+		const MTPupload_File &result) {
+	const auto i = _fileProcesses.find(id);
+	if (i == end(_fileProcesses)) {
+		return;
+	}
+	const auto process = i->second.get();
+	Assert(!process->requests.empty());
 
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
 		error("Cdn redirect is not supported.");
@@ -1619,18 +1796,18 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 	}
 	const auto &data = result.c_upload_file();
 	if (data.vbytes.v.isEmpty()) {
-		if (_fileProcess->size > 0) {
+		if (process->size > 0) {
 			error("Empty bytes received in file part.");
 			return;
 		}
-		const auto result = _fileProcess->file.writeBlock({});
+		const auto result = process->file.writeBlock({});
 		if (!result) {
 			ioError(result);
 			return;
 		}
 	} else {
 		using Request = FileProcess::Request;
-		auto &requests = _fileProcess->requests;
+		auto &requests = process->requests;
 		const auto i = ranges::find(
 			requests,
 			offset,
@@ -1639,43 +1816,72 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 
 		i->bytes = data.vbytes.v;
 
-		auto &file = _fileProcess->file;
+		auto &file = process->file;
 		while (!requests.empty() && !requests.front().bytes.isEmpty()) {
 			const auto &bytes = requests.front().bytes;
 			if (const auto result = file.writeBlock(bytes); !result) {
 				ioError(result);
 				return;
 			}
+			process->hash.addData(bytes);
 			requests.pop_front();
 		}
 
-		if (_fileProcess->progress) {
-			_fileProcess->progress(FileProgress{
-				file.size(),
-				_fileProcess->size });
+		if (process->progress) {
+			process->progress(FileProgress{
+				process->relativePath,
+				int(file.size()),
+				process->size });
 		}
 
 		if (!requests.empty()
-			|| !_fileProcess->size
-			|| _fileProcess->size > _fileProcess->offset) {
-			loadFilePart();
+			|| !process->size
+			|| process->size > process->offset) {
+			loadFilePart(id);
 			return;
 		}
 	}
 
-	auto process = base::take(_fileProcess);
-	const auto relativePath = process->relativePath;
-	_fileCache->save(process->location, relativePath);
-	process->done(process->relativePath);
+	if (const auto result = process->file.flush(); !result) {
+		ioError(result);
+		return;
+	}
+	const auto relativePath = deduplicateFile(*process);
+	if (!relativePath) {
+		return;
+	}
+	_fileCache->save(process->location, *relativePath);
+	if (!saveJournalFile(
+			process->location,
+			*relativePath,
+			process->file.size())) {
+		return;
+	}
+	finishFileProcess(id, *relativePath);
 }
 
-void ApiWrap::filePartUnavailable() {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartUnavailable(uint64 id) {
+	if (!_fileProcesses.contains(id)) {
+		return;
+	}
 
 	LOG(("Export Error: File unavailable."));
 
-	base::take(_fileProcess)->done(QString());
+	finishFileProcess(id, QString());
+}
+
+void ApiWrap::finishFileProcess(uint64 id, const QString &relativePath) {
+	const auto i = _fileProcesses.find(id);
+	Assert(i != end(_fileProcesses));
+
+	auto process = std::move(i->second);
+	_fileProcesses.erase(i);
+	--_fileProcessesLoading;
+
+	for (auto &done : process->done) {
+		done(relativePath);
+	}
+	startFileProcesses();
 }
 
 void ApiWrap::error(RPCError &&error) {
@@ -27,6 +27,7 @@ struct Message;
 namespace Output {
 struct Result;
 class Stats;
+class Journal;
 } // namespace Output
 
 struct Settings;
@@ -45,6 +46,7 @@ public:
 	void startExport(
 		const Settings &settings,
 		Output::Stats *stats,
+		not_null<Output::Journal*> journal,
 		FnMut<void(StartInfo)> done);
 
 	void requestDialogsList(
@@ -96,6 +98,7 @@ private:
 	struct ChatsProcess;
 	struct LeftChannelsProcess;
 	struct DialogsProcess;
+	struct ChatSlice;
 	struct ChatProcess;
 
 	void startMainSession(FnMut<void()> done);
@@ -110,9 +113,8 @@ private:
 
 	void handleUserpicsSlice(const MTPphotos_Photos &result);
 	void loadUserpicsFiles(Data::UserpicsSlice &&slice);
-	void loadNextUserpic();
-	bool loadUserpicProgress(FileProgress value);
-	void loadUserpicDone(const QString &relativePath);
+	bool loadUserpicProgress(int index, FileProgress value);
+	void loadUserpicDone(int index, const QString &relativePath);
 	void finishUserpicsSlice();
 	void finishUserpics();
 
@@ -149,13 +151,22 @@ private:
 		int addOffset,
 		int limit,
 		FnMut<void(MTPmessages_Messages&&)> done);
-	void loadMessagesFiles(Data::MessagesSlice &&slice);
-	void loadNextMessageFile();
-	bool loadMessageFileProgress(FileProgress value);
-	void loadMessageFileDone(const QString &relativePath);
-	bool loadMessageThumbProgress(FileProgress value);
-	void loadMessageThumbDone(const QString &relativePath);
-	void finishMessagesSlice();
+	void appendMessagesSlice(Data::MessagesSlice &&slice, bool last);
+	void loadMessagesFiles(ChatSlice &slice);
+	void processMessagesSlices();
+	ChatSlice *messagesSlice(int sliceId);
+	bool loadMessageFileProgress(
+		int sliceId,
+		int index,
+		FileProgress value);
+	void loadMessageFileDone(
+		int sliceId,
+		int index,
+		const QString &relativePath);
+	void loadMessageThumbDone(
+		int sliceId,
+		int index,
+		const QString &relativePath);
 	void finishMessages();
 
 	bool processFileLoad(
@@ -163,16 +174,24 @@ private:
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done,
 		Data::Message *message = nullptr);
-	std::unique_ptr<FileProcess> prepareFileProcess(
-		const Data::File &file) const;
+	std::unique_ptr<FileProcess> prepareFileProcess(const Data::File &file);
 	bool writePreloadedFile(Data::File &file);
+	std::optional<QString> findJournalFile(
+		const Data::FileLocation &location);
+	bool saveJournalFile(
+		const Data::FileLocation &location,
+		const QString &relativePath,
+		int64 size);
+	std::optional<QString> deduplicateFile(FileProcess &process);
 	void loadFile(
 		const Data::File &file,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done);
-	void loadFilePart();
-	void filePartDone(int offset, const MTPupload_File &result);
-	void filePartUnavailable();
+	void startFileProcesses();
+	void loadFilePart(uint64 id);
+	void filePartDone(uint64 id, int offset, const MTPupload_File &result);
+	void filePartUnavailable(uint64 id);
+	void finishFileProcess(uint64 id, const QString &relativePath);
 
 	template <typename Request>
 	class RequestBuilder;
@@ -184,6 +203,7 @@ private:
 	[[nodiscard]] auto splitRequest(int index, Request &&request);
 
 	[[nodiscard]] auto fileRequest(
+		uint64 id,
 		const Data::FileLocation &location,
 		int offset);
 
@@ -194,6 +214,7 @@ private:
 	MTP::ConcurrentSender _mtp;
 	std::optional<uint64> _takeoutId;
 	Output::Stats *_stats = nullptr;
+	Output::Journal *_journal = nullptr;
 
 	std::unique_ptr<Settings> _settings;
 	MTPInputUser _user = MTP_inputUserSelf();
@@ -203,7 +224,10 @@ private:
 	std::unique_ptr<ContactsProcess> _contactsProcess;
 	std::unique_ptr<UserpicsProcess> _userpicsProcess;
 	std::unique_ptr<OtherDataProcess> _otherDataProcess;
-	std::unique_ptr<FileProcess> _fileProcess;
+	base::flat_map<uint64, std::unique_ptr<FileProcess>> _fileProcesses;
+	std::deque<uint64> _fileProcessesQueue;
+	uint64 _lastFileProcessId = 0;
+	int _fileProcessesLoading = 0;
 	std::unique_ptr<LeftChannelsProcess> _leftChannelsProcess;
 	std::unique_ptr<DialogsProcess> _dialogsProcess;
 	std::unique_ptr<ChatProcess> _chatProcess;
@@ -12,21 +12,15 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "export/output/export_output_abstract.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_stats.h"
+#include "export/output/export_output_journal.h"
+#include "export/output/export_output_archive.h"
 
 namespace Export {
 namespace {
 
-const auto kNullStateCallback = [](ProcessingState&) {};
+constexpr auto kSpeedSampleDelay = crl::time(1000);
 
-Settings NormalizeSettings(const Settings &settings) {
-	if (!settings.onlySinglePeer()) {
-		return base::duplicate(settings);
-	}
-	auto result = base::duplicate(settings);
-	result.format = Output::Format::Html;
-	result.types = result.fullChats = Settings::Type::AnyChatsMask;
-	return result;
-}
+const auto kNullStateCallback = [](ProcessingState&) {};
 
 } // namespace
 
@@ -59,6 +53,10 @@ private:
 	void ioError(const QString &path);
 	bool ioCatchError(Output::Result result);
 	void setFinishedState();
+	bool archiveFile(const Data::File &file);
+	bool archiveSlice(const Data::UserpicsSlice &slice);
+	bool archiveSlice(const Data::MessagesSlice &slice);
+	bool finishArchive();
 
 	//void requestPasswordState();
 	//void passwordStateDone(const MTPaccount_Password &password);
@@ -76,11 +74,14 @@ private:
 	void exportOtherData();
 	void exportDialogs();
 	void exportNextDialog();
+	std::optional<int> resumedMessagesCount(
+		const Data::DialogInfo &info) const;
 
 	template <typename Callback = const decltype(kNullStateCallback) &>
 	ProcessingState prepareState(
 		Step step,
 		Callback &&callback = kNullStateCallback) const;
+	void updateSpeed() const;
 	ProcessingState stateInitializing() const;
 	ProcessingState stateDialogsList(int processed) const;
 	ProcessingState statePersonalInfo() const;
@@ -115,6 +116,9 @@ private:
 	rpl::event_stream<State> _stateChanges;
 
 	Output::Stats _stats;
+	mutable crl::time _speedSampleTime = 0;
+	mutable int64 _speedSampleBytes = 0;
+	mutable int64 _bytesPerSecond = 0;
 
 	std::vector<int> _substepsInStep;
 	int _substepsTotal = 0;
@@ -122,6 +126,9 @@ private:
 	mutable Step _lastProcessingStep = Step::Initializing;
 
 	std::unique_ptr<Output::AbstractWriter> _writer;
+	std::unique_ptr<Output::Journal> _journal;
+	std::unique_ptr<Output::Archive> _archive;
+	crl::time _startedAt = 0;
 	std::vector<Step> _steps;
 	int _stepIndex = -1;
 
@@ -236,8 +243,18 @@ void ControllerObject::startExport(
 	_settings = NormalizeSettings(settings);
 	_environment = environment;
 
-	_settings.path = Output::NormalizePath(_settings);
+	_startedAt = crl::now();
+	if (_settings.archive) {
+		const auto path = Output::PrepareArchivePath(_settings);
+		_archive = std::make_unique<Output::Archive>(
+			path,
+			Output::Archive::PrepareStagingFolder(path));
+		_settings.path = _archive->stagingFolder();
+	} else {
+		_settings.path = Output::NormalizePath(_settings);
+	}
 	_writer = Output::CreateWriter(_settings.format);
+	_journal = std::make_unique<Output::Journal>(_settings.path);
 	fillExportSteps();
 	exportNext();
 }
@@ -310,7 +327,9 @@ void ControllerObject::cancelExportFast() {
 
 void ControllerObject::exportNext() {
 	if (++_stepIndex >= _steps.size()) {
-		if (ioCatchError(_writer->finish())) {
+		if (ioCatchError(_writer->finish())
+			|| ioCatchError(_journal->finish())
+			|| !finishArchive()) {
 			return;
 		}
 		_api.finishExport([=] {
@@ -335,9 +354,20 @@ void ControllerObject::exportNext() {
 
 void ControllerObject::initialize() {
 	setState(stateInitializing());
-	_api.startExport(_settings, &_stats, [=](ApiWrap::StartInfo info) {
-		initialized(info);
-	});
+	if (_archive && ioCatchError(_archive->start())) {
+		return;
+	}
+	const auto fingerprint = Output::ResumeFingerprint(_settings);
+	if (ioCatchError(_journal->start(fingerprint))) {
+		return;
+	} else if (_journal->resumed()) {
+		LOG(("Export Info: Resuming export in '%1'.").arg(_settings.path));
+	}
+	_api.startExport(
+		_settings,
+		&_stats,
+		_journal.get(),
+		[=](ApiWrap::StartInfo info) { initialized(info); });
 }
 
 void ControllerObject::initialized(const ApiWrap::StartInfo &info) {
@@ -381,7 +411,8 @@ void ControllerObject::exportUserpics() {
 		setState(stateUserpics(progress));
 		return true;
 	}, [=](Data::UserpicsSlice &&slice) {
-		if (ioCatchError(_writer->writeUserpicsSlice(slice))) {
+		if (ioCatchError(_writer->writeUserpicsSlice(slice))
+			|| !archiveSlice(slice)) {
 			return false;
 		}
 		_userpicsWritten += slice.list.size();
@@ -435,9 +466,20 @@ void ControllerObject::exportDialogs() {
 }
 
 void ControllerObject::exportNextDialog() {
-	const auto index = ++_dialogIndex;
-	const auto info = _dialogsInfo.item(index);
+	auto info = _dialogsInfo.item(++_dialogIndex);
+	while (info) {
+		const auto resumed = resumedMessagesCount(*info);
+		if (!resumed) {
+			break;
+		} else if (ioCatchError(_writer->writeDialogResumed(
+				*info,
+				*resumed))) {
+			return;
+		}
+		info = _dialogsInfo.item(++_dialogIndex);
+	}
 	if (info) {
+		const auto peerId = info->peerId;
 		_api.requestMessages(*info, [=](const Data::DialogInfo &info) {
 			if (ioCatchError(_writer->writeDialogStart(info))) {
 				return false;
@@ -452,14 +494,18 @@ void ControllerObject::exportNextDialog() {
 			setState(stateDialogs(progress));
 			return true;
 		}, [=](Data::MessagesSlice &&result) {
-			if (ioCatchError(_writer->writeDialogSlice(result))) {
+			if (ioCatchError(_writer->writeDialogSlice(result))
+				|| !archiveSlice(result)) {
 				return false;
 			}
 			_messagesWritten += result.list.size();
 			setState(stateDialogs(DownloadProgress()));
 			return true;
 		}, [=] {
-			if (ioCatchError(_writer->writeDialogEnd())) {
+			if (ioCatchError(_writer->writeDialogEnd())
+				|| ioCatchError(_journal->dialogDone(
+					peerId,
+					_writer->dialogMessagesCount()))) {
 				return;
 			}
 			exportNextDialog();
@@ -472,6 +518,15 @@ void ControllerObject::exportNextDialog() {
 	exportNext();
 }
 
+std::optional<int> ControllerObject::resumedMessagesCount(
+		const Data::DialogInfo &info) const {
+	return Output::ResumedMessagesCount(
+		*_journal,
+		_writer.get(),
+		_settings,
+		info.peerId);
+}
+
 template <typename Callback>
 ProcessingState ControllerObject::prepareState(
 		Step step,
@@ -481,15 +536,36 @@ ProcessingState ControllerObject::prepareState(
 		_lastProcessingStep = step;
 	}
 
+	updateSpeed();
+
 	auto result = ProcessingState();
 	callback(result);
 	result.step = step;
 	result.substepsPassed = _substepsPassed;
 	result.substepsNow = substepsInStep(_lastProcessingStep);
 	result.substepsTotal = _substepsTotal;
+	result.bytesPerSecond = _bytesPerSecond;
 	return result;
 }
 
+void ControllerObject::updateSpeed() const {
+	const auto now = crl::now();
+	// Removed duplicates were loaded as well, keep the counter growing.
+	const auto bytes = _stats.bytesCount() + _stats.bytesSavedCount();
+	if (!_speedSampleTime) {
+		_speedSampleTime = now;
+		_speedSampleBytes = bytes;
+		return;
+	}
+	const auto passed = now - _speedSampleTime;
+	if (passed < kSpeedSampleDelay) {
+		return;
+	}
+	_bytesPerSecond = (bytes - _speedSampleBytes) * 1000 / passed;
+	_speedSampleTime = now;
+	_speedSampleBytes = bytes;
+}
+
 ProcessingState ControllerObject::stateInitializing() const {
 	return ProcessingState();
 }
@@ -577,11 +653,47 @@ int ControllerObject::substepsInStep(Step step) const {
 	return _substepsInStep[static_cast<int>(step)];
 }
 
+bool ControllerObject::archiveFile(const Data::File &file) {
+	return !_archive
+		|| file.relativePath.isEmpty()
+		|| !ioCatchError(_archive->move(file.relativePath));
+}
+
+bool ControllerObject::archiveSlice(const Data::UserpicsSlice &slice) {
+	for (const auto &photo : slice.list) {
+		if (!archiveFile(photo.image.file)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ControllerObject::archiveSlice(const Data::MessagesSlice &slice) {
+	for (const auto &message : slice.list) {
+		if (!archiveFile(message.file())
+			|| !archiveFile(message.thumb().file)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ControllerObject::finishArchive() {
+	return !_archive
+		|| (!ioCatchError(_archive->moveAll())
+			&& !ioCatchError(_archive->finish()));
+}
+
 void ControllerObject::setFinishedState() {
+	LOG(("Export Info: Finished in %1 ms, %2 files, %3 bytes."
+		).arg(crl::now() - _startedAt
+		).arg(_stats.filesCount()
+		).arg(_stats.bytesCount()));
 	setState(FinishedState{
-		_writer->mainFilePath(),
+		_archive ? _archive->path() : _writer->mainFilePath(),
 		_stats.filesCount(),
-		_stats.bytesCount() });
+		_stats.bytesCount(),
+		_stats.bytesSavedCount() });
 }
 
 Controller::Controller(const MTPInputPeer &peer) : _wrapped(peer) {
@@ -70,6 +70,8 @@ struct ProcessingState {
 	QString bytesName;
 	int bytesLoaded = 0;
 	int bytesCount = 0;
+
+	int64 bytesPerSecond = 0;
 };
 
 struct ApiErrorState {
@@ -87,6 +89,7 @@ struct FinishedState {
 	QString path;
 	int filesCount = 0;
 	int64 bytesCount = 0;
+	int64 bytesSaved = 0;
 };
 
 using State = base::optional_variant<
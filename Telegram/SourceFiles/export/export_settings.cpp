@@ -46,4 +46,15 @@ bool Settings::validate() const {
 	return true;
 };
 
+Settings NormalizeSettings(const Settings &settings) {
+	if (!settings.onlySinglePeer()) {
+		return base::duplicate(settings);
+	}
+	auto result = base::duplicate(settings);
+	result.format = Output::Format::Html;
+	result.archive = false;
+	result.types = result.fullChats = Settings::Type::AnyChatsMask;
+	return result;
+}
+
 } // namespace Export
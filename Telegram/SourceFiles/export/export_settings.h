@@ -70,7 +70,12 @@ struct Settings {
 
 	QString path;
 	bool forceSubPath = false;
+
+	// An interrupted export folder the user agreed to continue in.
+	QString resumePath;
+
 	Output::Format format = Output::Format();
+	bool archive = false;
 
 	Types types = DefaultTypes();
 	Types fullChats = DefaultFullChats();
@@ -101,6 +106,9 @@ struct Settings {
 
 };
 
+// Single chat exports always use the same format and data types.
+Settings NormalizeSettings(const Settings &settings);
+
 struct Environment {
 	QString internalLinksDomain;
 	QByteArray aboutTelegram;
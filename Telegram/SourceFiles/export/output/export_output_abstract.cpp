@@ -11,6 +11,8 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "export/output/export_output_json.h"
 #include "export/output/export_output_stats.h"
 #include "export/output/export_output_result.h"
+#include "export/output/export_output_journal.h"
+#include "export/output/export_output_archive.h"
 
 #include <QtCore/QDir>
 #include <QtCore/QDate>
@@ -18,10 +20,64 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 namespace Export {
 namespace Output {
 
+namespace {
+
+QString TargetFolder(const Settings &settings) {
+	const auto path = QDir(settings.path).absolutePath();
+	return path.endsWith('/') ? path : (path + '/');
+}
+
+QString SubPathPrefix(const Settings &settings) {
+	return settings.onlySinglePeer() ? "ChatExport_" : "DataExport_";
+}
+
+std::optional<QString> ResumablePath(
+		const QString &path,
+		const Settings &settings) {
+	const auto fingerprint = ResumeFingerprint(settings);
+	if (!settings.forceSubPath && Journal::Resumable(path, fingerprint)) {
+		return path;
+	}
+	const auto list = QDir(path).entryInfoList(
+		{ SubPathPrefix(settings) + '*' },
+		QDir::Dirs | QDir::NoDotAndDotDot,
+		QDir::Time);
+	for (const auto &info : list) {
+		const auto folder = info.absoluteFilePath() + '/';
+		if (Journal::Resumable(folder, fingerprint)) {
+			return folder;
+		}
+	}
+	return std::nullopt;
+}
+
+QString SubPathBase(const Settings &settings) {
+	const auto date = QDate::currentDate();
+	return QString(SubPathPrefix(settings) + "%1_%2_%3"
+	).arg(date.day(), 2, 10, QChar('0')
+	).arg(date.month(), 2, 10, QChar('0')
+	).arg(date.year());
+}
+
+QString AddIndex(const QString &base, int index) {
+	return base + (index ? " (" + QString::number(index) + ')' : QString());
+}
+
+} // namespace
+
+std::optional<QString> FindResumablePath(const Settings &settings) {
+	if (settings.archive) {
+		return std::nullopt;
+	}
+	return ResumablePath(TargetFolder(settings), settings);
+}
+
 QString NormalizePath(const Settings &settings) {
+	if (!settings.resumePath.isEmpty()) {
+		return settings.resumePath;
+	}
 	QDir folder(settings.path);
-	const auto path = folder.absolutePath();
-	auto result = path.endsWith('/') ? path : (path + '/');
+	auto result = TargetFolder(settings);
 	if (!folder.exists() && !settings.forceSubPath) {
 		return result;
 	}
@@ -30,24 +86,42 @@ QString NormalizePath(const Settings &settings) {
 	if (list.isEmpty() && !settings.forceSubPath) {
 		return result;
 	}
-	const auto date = QDate::currentDate();
-	const auto base = QString(settings.onlySinglePeer()
-		? "ChatExport_%1_%2_%3"
-		: "DataExport_%1_%2_%3"
-	).arg(date.day(), 2, 10, QChar('0')
-	).arg(date.month(), 2, 10, QChar('0')
-	).arg(date.year());
-	const auto add = [&](int i) {
-		return base + (i ? " (" + QString::number(i) + ')' : QString());
-	};
+	const auto base = SubPathBase(settings);
 	auto index = 0;
-	while (QDir(result + add(index)).exists()) {
+	while (QDir(result + AddIndex(base, index)).exists()) {
 		++index;
 	}
-	result += add(index) + '/';
+	result += AddIndex(base, index) + '/';
 	return result;
 }
 
+QString PrepareArchivePath(const Settings &settings) {
+	const auto base = TargetFolder(settings) + SubPathBase(settings);
+	const auto extension = Archive::Extension();
+	auto index = 0;
+	while (QFile::exists(AddIndex(base, index) + extension)) {
+		++index;
+	}
+	return AddIndex(base, index) + extension;
+}
+
+QByteArray ResumeFingerprint(const Settings &settings) {
+	auto singlePeer = mtpBuffer();
+	settings.singlePeer.write(singlePeer);
+	return QByteArray::number(static_cast<int>(settings.format))
+		+ '_' + QByteArray::number(static_cast<int>(settings.types.value()))
+		+ '_' + QByteArray::number(
+			static_cast<int>(settings.fullChats.value()))
+		+ '_' + QByteArray::number(
+			static_cast<int>(settings.media.types.value()))
+		+ '_' + QByteArray::number(settings.media.sizeLimit)
+		+ '_' + QByteArray::number(settings.singlePeerFrom)
+		+ '_' + QByteArray::number(settings.singlePeerTill)
+		+ '_' + QByteArray(
+			reinterpret_cast<const char*>(singlePeer.constData()),
+			singlePeer.size() * sizeof(mtpPrime)).toHex();
+}
+
 std::unique_ptr<AbstractWriter> CreateWriter(Format format) {
 	switch (format) {
 	case Format::Html: return std::make_unique<HtmlWriter>();
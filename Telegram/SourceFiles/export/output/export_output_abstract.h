@@ -6,7 +6,10 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/optional.h"
+
 #include <QtCore/QString>
+#include <QtCore/QByteArray>
 
 namespace Export {
 namespace Data {
@@ -26,7 +29,12 @@ struct Environment;
 
 namespace Output {
 
+// An interrupted export with the same settings, the user is asked
+// whether to continue it before it is put to Settings::resumePath.
+std::optional<QString> FindResumablePath(const Settings &settings);
 QString NormalizePath(const Settings &settings);
+QString PrepareArchivePath(const Settings &settings);
+QByteArray ResumeFingerprint(const Settings &settings);
 
 struct Result;
 class Stats;
@@ -74,6 +82,19 @@ public:
 	[[nodiscard]] virtual Result writeDialogEnd() = 0;
 	[[nodiscard]] virtual Result writeDialogsEnd() = 0;
 
+	// Lists a dialog fully written by an interrupted export into the same
+	// folder without writing its messages again. Possible only if the
+	// messages of each dialog are kept in separate files.
+	[[nodiscard]] virtual bool canResumeDialogs() = 0;
+	[[nodiscard]] virtual Result writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) = 0;
+
+	// Messages of the last started dialog that were actually written,
+	// the ones skipped by the date limits are not counted. This is what
+	// the journal records for the dialog to resume it later.
+	[[nodiscard]] virtual int dialogMessagesCount() const = 0;
+
 	[[nodiscard]] virtual Result finish() = 0;
 
 	[[nodiscard]] virtual QString mainFilePath() = 0;
@@ -0,0 +1,269 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "export/output/export_output_archive.h"
+
+#include "export/output/export_output_result.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDir>
+
+#include "zip.h"
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kChunkSize = 1024 * 1024;
+constexpr auto kUtf8NamesFlag = (1 << 11);
+
+// Media files are already compressed, only text is deflated.
+bool Compressible(const QString &relativePath) {
+	const auto dot = relativePath.lastIndexOf('.');
+	if (dot < 0 || relativePath.indexOf('/', dot) >= 0) {
+		return false;
+	}
+	const auto extension = relativePath.mid(dot + 1).toLower();
+	return (extension == qstr("html"))
+		|| (extension == qstr("json"))
+		|| (extension == qstr("txt"))
+		|| (extension == qstr("css"))
+		|| (extension == qstr("js"));
+}
+
+voidpf Open(voidpf opaque, const void *filename, int mode) {
+	const auto file = static_cast<QFile*>(opaque);
+	const auto flags = (mode & ZLIB_FILEFUNC_MODE_CREATE)
+		? (QIODevice::ReadWrite | QIODevice::Truncate)
+		: QIODevice::ReadWrite;
+	return file->open(flags) ? file : nullptr;
+}
+
+uLong Read(voidpf opaque, voidpf stream, void *buf, uLong size) {
+	const auto result = static_cast<QFile*>(stream)->read(
+		static_cast<char*>(buf),
+		size);
+	return (result > 0) ? uLong(result) : 0;
+}
+
+uLong Write(voidpf opaque, voidpf stream, const void *buf, uLong size) {
+	const auto result = static_cast<QFile*>(stream)->write(
+		static_cast<const char*>(buf),
+		size);
+	return (result > 0) ? uLong(result) : 0;
+}
+
+ZPOS64_T Tell(voidpf opaque, voidpf stream) {
+	return static_cast<QFile*>(stream)->pos();
+}
+
+long Seek(voidpf opaque, voidpf stream, ZPOS64_T offset, int origin) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto position = [&]() -> qint64 {
+		switch (origin) {
+		case ZLIB_FILEFUNC_SEEK_SET: return offset;
+		case ZLIB_FILEFUNC_SEEK_CUR: return file->pos() + offset;
+		case ZLIB_FILEFUNC_SEEK_END: return file->size() + offset;
+		}
+		return -1;
+	}();
+	return (position >= 0 && file->seek(position)) ? 0 : -1;
+}
+
+int Close(voidpf opaque, voidpf stream) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto result = file->flush();
+	file->close();
+	return result ? 0 : -1;
+}
+
+int Error(voidpf opaque, voidpf stream) {
+	const auto file = static_cast<QFile*>(stream);
+	return (file->error() != QFileDevice::NoError) ? -1 : 0;
+}
+
+zip_fileinfo PrepareFileInfo() {
+	const auto now = QDateTime::currentDateTime();
+	const auto date = now.date();
+	const auto time = now.time();
+
+	auto result = zip_fileinfo();
+	result.tmz_date.tm_sec = time.second();
+	result.tmz_date.tm_min = time.minute();
+	result.tmz_date.tm_hour = time.hour();
+	result.tmz_date.tm_mday = date.day();
+	result.tmz_date.tm_mon = date.month() - 1;
+	result.tmz_date.tm_year = date.year();
+	return result;
+}
+
+} // namespace
+
+Archive::Archive(const QString &path, const QString &stagingFolder)
+: _path(path)
+, _stagingFolder(stagingFolder)
+, _file(path) {
+	Expects(_stagingFolder.endsWith('/'));
+}
+
+Archive::~Archive() {
+	if (_handle) {
+		zipClose(base::take(_handle), nullptr);
+	}
+	if (!_finished) {
+		// An interrupted archive can't be resumed, don't leave it around.
+		_file.remove();
+		QDir(_stagingFolder).removeRecursively();
+	}
+}
+
+QString Archive::Extension() {
+	return ".zip";
+}
+
+QString Archive::PrepareStagingFolder(const QString &path) {
+	// Same disk as the archive, files are not copied between devices
+	// and a small RAM-backed temp folder is not filled by large exports.
+	const auto info = QFileInfo(path);
+	return info.absolutePath() + "/." + info.completeBaseName() + "_files/";
+}
+
+QString Archive::path() const {
+	return _path;
+}
+
+QString Archive::stagingFolder() const {
+	return _stagingFolder;
+}
+
+Result Archive::start() {
+	Expects(_handle == nullptr);
+
+	// A leftover of a crashed export must not be resumed by the journal.
+	if (!QDir(_stagingFolder).removeRecursively()
+		|| !QDir().mkpath(_stagingFolder)) {
+		return Result(Result::Type::Error, _stagingFolder);
+	}
+	const auto folder = QFileInfo(_path).absoluteDir();
+	if (!folder.exists() && !folder.mkpath(folder.absolutePath())) {
+		return error();
+	}
+
+	auto funcs = zlib_filefunc64_def();
+	funcs.zopen64_file = Open;
+	funcs.zread_file = Read;
+	funcs.zwrite_file = Write;
+	funcs.ztell64_file = Tell;
+	funcs.zseek64_file = Seek;
+	funcs.zclose_file = Close;
+	funcs.zerror_file = Error;
+	funcs.opaque = &_file;
+	_handle = zipOpen2_64(nullptr, APPEND_STATUS_CREATE, nullptr, &funcs);
+	return _handle ? Result::Success() : error();
+}
+
+Result Archive::move(const QString &relativePath) {
+	Expects(_handle != nullptr);
+
+	auto source = QFile(_stagingFolder + relativePath);
+	if (!source.exists()) {
+		return Result::Success();
+	} else if (!source.open(QIODevice::ReadOnly)) {
+		return Result(Result::Type::Error, source.fileName());
+	}
+	if (const auto result = write(relativePath, source); !result) {
+		return result;
+	}
+	source.close();
+	return source.remove()
+		? Result::Success()
+		: Result(Result::Type::Error, source.fileName());
+}
+
+Result Archive::write(const QString &relativePath, QFile &source) {
+	const auto info = PrepareFileInfo();
+	const auto compress = Compressible(relativePath);
+	const auto opened = zipOpenNewFileInZip4_64(
+		_handle,
+		relativePath.toUtf8().constData(),
+		&info,
+		nullptr,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		compress ? Z_DEFLATED : 0,
+		compress ? Z_DEFAULT_COMPRESSION : 0,
+		0,
+		-MAX_WBITS,
+		DEF_MEM_LEVEL,
+		Z_DEFAULT_STRATEGY,
+		nullptr,
+		0,
+		0,
+		kUtf8NamesFlag,
+		(source.size() >= 0xFFFFFFFFLL) ? 1 : 0);
+	if (opened != ZIP_OK) {
+		return error();
+	}
+	_buffer.resize(kChunkSize);
+	while (!source.atEnd()) {
+		const auto read = source.read(_buffer.data(), _buffer.size());
+		if (read < 0) {
+			return Result(Result::Type::Error, source.fileName());
+		} else if (read > 0 && zipWriteInFileInZip(
+				_handle,
+				_buffer.constData(),
+				unsigned(read)) != ZIP_OK) {
+			return error();
+		}
+	}
+	return (zipCloseFileInZip(_handle) == ZIP_OK)
+		? Result::Success()
+		: error();
+}
+
+Result Archive::moveAll() {
+	const auto folder = QDir(_stagingFolder);
+	auto list = QStringList();
+	auto i = QDirIterator(
+		_stagingFolder,
+		QDir::Files | QDir::Hidden,
+		QDirIterator::Subdirectories);
+	while (i.hasNext()) {
+		list.push_back(folder.relativeFilePath(i.next()));
+	}
+
+	// Keep the order stable for the same export contents.
+	list.sort();
+	for (const auto &relativePath : list) {
+		if (const auto result = move(relativePath); !result) {
+			return result;
+		}
+	}
+	return Result::Success();
+}
+
+Result Archive::finish() {
+	Expects(_handle != nullptr);
+
+	const auto closed = (zipClose(base::take(_handle), nullptr) == ZIP_OK);
+	if (!closed) {
+		return error();
+	}
+	_finished = true;
+	QDir(_stagingFolder).removeRecursively();
+	return Result::Success();
+}
+
+Result Archive::error() const {
+	return Result(Result::Type::Error, _path);
+}
+
+} // namespace Output
+} // namespace Export
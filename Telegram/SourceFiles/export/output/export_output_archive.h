@@ -0,0 +1,60 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+
+namespace Export {
+namespace Output {
+
+struct Result;
+
+// A single ZIP file the export is packed into.
+//
+// The export itself is written to a staging folder next to the archive,
+// finished files are moved from there to the archive one by one, so only
+// one entry is open at any moment and memory use doesn't depend on the
+// file sizes. The export journal is kept in the staging folder as well,
+// it is used for deduplication, but an archive is never resumed.
+class Archive {
+public:
+	Archive(const QString &path, const QString &stagingFolder);
+	Archive(const Archive &other) = delete;
+	Archive &operator=(const Archive &other) = delete;
+	~Archive();
+
+	[[nodiscard]] static QString Extension();
+	[[nodiscard]] static QString PrepareStagingFolder(const QString &path);
+
+	[[nodiscard]] QString path() const;
+	[[nodiscard]] QString stagingFolder() const;
+
+	[[nodiscard]] Result start();
+
+	// Does nothing if the file was already moved or doesn't exist.
+	[[nodiscard]] Result move(const QString &relativePath);
+	[[nodiscard]] Result moveAll();
+
+	[[nodiscard]] Result finish();
+
+private:
+	[[nodiscard]] Result write(const QString &relativePath, QFile &source);
+	[[nodiscard]] Result error() const;
+
+	QString _path;
+	QString _stagingFolder;
+	QFile _file;
+	void *_handle = nullptr;
+	QByteArray _buffer;
+	bool _finished = false;
+
+};
+
+} // namespace Output
+} // namespace Export
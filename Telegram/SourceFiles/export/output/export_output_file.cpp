@@ -14,29 +14,70 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 
 #include <gsl/gsl_util>
 
+#ifndef Q_OS_WIN
+#include <sys/uio.h>
+#include <errno.h>
+#endif // !Q_OS_WIN
+
 namespace Export {
 namespace Output {
+namespace {
+
+constexpr auto kBufferSize = 64 * 1024;
+
+} // namespace
 
 File::File(const QString &path, Stats *stats) : _path(path), _stats(stats) {
 }
 
-int File::size() const {
-	return _offset;
+File::~File() {
+	if (!_buffer.isEmpty()) {
+		LOG(("Export Info: Dropping %1 unflushed bytes of '%2'."
+			).arg(_buffer.size()
+			).arg(_path));
+	}
+}
+
+int64 File::size() const {
+	return _offset + _buffer.size();
 }
 
 bool File::empty() const {
-	return !_offset;
+	return !size();
 }
 
 Result File::writeBlock(const QByteArray &block) {
-	const auto result = writeBlockAttempt(block);
+	if (!block.isEmpty() && _buffer.size() + block.size() <= kBufferSize) {
+		if (_stats && !_inStats) {
+			_inStats = true;
+			_stats->incrementFiles();
+		}
+		if (_buffer.capacity() < kBufferSize) {
+			_buffer.reserve(kBufferSize);
+		}
+		_buffer.append(block);
+		return Result::Success();
+	}
+	return write(block);
+}
+
+Result File::flush() {
+	return _buffer.isEmpty() ? Result::Success() : write(QByteArray());
+}
+
+Result File::write(const QByteArray &block) {
+	const auto result = writeAttempt(block);
 	if (!result) {
 		_file.reset();
 	}
 	return result;
 }
 
-Result File::writeBlockAttempt(const QByteArray &block) {
+void File::close() {
+	_file.reset();
+}
+
+Result File::writeAttempt(const QByteArray &block) {
 	if (_stats && !_inStats) {
 		_inStats = true;
 		_stats->incrementFiles();
@@ -44,18 +85,59 @@ Result File::writeBlockAttempt(const QByteArray &block) {
 	if (const auto result = reopen(); !result) {
 		return result;
 	}
-	const auto size = block.size();
+	const auto size = _buffer.size() + block.size();
 	if (!size) {
 		return Result::Success();
+	} else if (!writeWithBuffer(block)) {
+		return error();
+	}
+	_offset += size;
+	if (_stats) {
+		_stats->incrementBytes(size);
 	}
-	if (_file->write(block) == size && _file->flush()) {
-		_offset += size;
-		if (_stats) {
-			_stats->incrementBytes(size);
+
+	// With the capacity reserved resize() keeps the allocated memory.
+	_buffer.resize(0);
+	return Result::Success();
+}
+
+bool File::writeWithBuffer(const QByteArray &block) {
+	Expects(_file.has_value());
+
+#ifdef Q_OS_WIN
+	return (_buffer.isEmpty() || _file->write(_buffer) == _buffer.size())
+		&& (block.isEmpty() || _file->write(block) == block.size());
+#else // Q_OS_WIN
+	const auto handle = _file->handle();
+	iovec parts[] = {
+		{ _buffer.data(), size_t(_buffer.size()) },
+		{ const_cast<char*>(block.constData()), size_t(block.size()) },
+	};
+	auto first = 0;
+	while (first != 2) {
+		if (!parts[first].iov_len) {
+			++first;
+			continue;
+		}
+		const auto written = ::writev(handle, parts + first, 2 - first);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		auto left = size_t(written);
+		while (first != 2 && left >= parts[first].iov_len) {
+			left -= parts[first++].iov_len;
+		}
+		if (left > 0) {
+			parts[first].iov_base = static_cast<char*>(parts[first].iov_base)
+				+ left;
+			parts[first].iov_len -= left;
 		}
-		return Result::Success();
 	}
-	return error();
+	return true;
+#endif // Q_OS_WIN
 }
 
 Result File::reopen() {
@@ -72,14 +154,16 @@ Result File::reopen() {
 	} else if (_offset > 0) {
 		return fatalError();
 	}
-	if (_file->open(QIODevice::Append)) {
+	// Writes go straight to the descriptor, buffering is done here.
+	const auto mode = QIODevice::Append | QIODevice::Unbuffered;
+	if (_file->open(mode)) {
 		return Result::Success();
 	}
 	const auto info = QFileInfo(_path);
 	const auto dir = info.absoluteDir();
 	return (!dir.exists()
 		&& dir.mkpath(dir.absolutePath())
-		&& _file->open(QIODevice::Append))
+		&& _file->open(mode))
 		? Result::Success()
 		: error();
 }
@@ -95,7 +179,15 @@ Result File::fatalError() const {
 QString File::PrepareRelativePath(
 		const QString &folder,
 		const QString &suggested) {
-	if (!QFile::exists(folder + suggested)) {
+	return PrepareRelativePath(suggested, [&](const QString &relativePath) {
+		return QFile::exists(folder + relativePath);
+	});
+}
+
+QString File::PrepareRelativePath(
+		const QString &suggested,
+		Fn<bool(const QString &relativePath)> occupied) {
+	if (!occupied(suggested)) {
 		return suggested;
 	}
 
@@ -113,7 +205,7 @@ QString File::PrepareRelativePath(
 	auto attempt = 0;
 	while (true) {
 		const auto relativePath = relativePart(++attempt);
-		if (!QFile::exists(folder + relativePath)) {
+		if (!occupied(relativePath)) {
 			return relativePath;
 		}
 	}
@@ -131,7 +223,11 @@ Result File::Copy(
 	if (bytes.size() != f.size()) {
 		return Result(Result::Type::FatalError, source);
 	}
-	return File(path, stats).writeBlock(bytes);
+	auto file = File(path, stats);
+	if (const auto result = file.writeBlock(bytes); !result) {
+		return result;
+	}
+	return file.flush();
 }
 
 } // namespace Output
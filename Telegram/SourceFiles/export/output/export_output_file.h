@@ -18,18 +18,34 @@ namespace Output {
 struct Result;
 class Stats;
 
+// Append-only output file.
+//
+// Small blocks are collected in a reusable buffer and are written to disk
+// together with the next large block or on flush(), with a single writev()
+// where it is available. The owner must flush() a finished file to get
+// the write errors, whatever is left in the buffer of a destroyed File
+// belongs to a cancelled export and is dropped.
 class File {
 public:
 	File(const QString &path, Stats *stats);
+	~File();
 
-	[[nodiscard]] int size() const;
+	[[nodiscard]] int64 size() const;
 	[[nodiscard]] bool empty() const;
 
 	[[nodiscard]] Result writeBlock(const QByteArray &block);
+	[[nodiscard]] Result flush();
+
+	// Releases the file handle, next writeBlock() will open it again.
+	// Data that was not flushed yet stays in the buffer.
+	void close();
 
 	[[nodiscard]] static QString PrepareRelativePath(
 		const QString &folder,
 		const QString &suggested);
+	[[nodiscard]] static QString PrepareRelativePath(
+		const QString &suggested,
+		Fn<bool(const QString &relativePath)> occupied);
 
 	[[nodiscard]] static Result Copy(
 		const QString &source,
@@ -38,14 +54,17 @@ public:
 
 private:
 	[[nodiscard]] Result reopen();
-	[[nodiscard]] Result writeBlockAttempt(const QByteArray &block);
+	[[nodiscard]] Result write(const QByteArray &block);
+	[[nodiscard]] Result writeAttempt(const QByteArray &block);
+	[[nodiscard]] bool writeWithBuffer(const QByteArray &block);
 
 	[[nodiscard]] Result error() const;
 	[[nodiscard]] Result fatalError() const;
 
 	QString _path;
-	int _offset = 0;
+	int64 _offset = 0;
 	std::optional<QFile> _file;
+	QByteArray _buffer;
 
 	Stats *_stats = nullptr;
 	bool _inStats = false;
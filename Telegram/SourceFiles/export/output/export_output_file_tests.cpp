@@ -0,0 +1,153 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/basic_types.h"
+#include "export/export_settings.h"
+#include "export/data/export_data_types.h"
+#include "export/output/export_output_abstract.h"
+#include "export/output/export_output_file.h"
+#include "export/output/export_output_result.h"
+#include "export/output/export_output_stats.h"
+#include "base/tests_benchmark.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+using namespace Export::Output;
+using base::test::Measure;
+
+namespace {
+
+constexpr auto kSmallBlock = 100;
+constexpr auto kLargeBlock = 1024 * 1024;
+constexpr auto kBenchmarkMessages = 1'000'000;
+constexpr auto kBenchmarkSlice = 100;
+
+const auto Folder = QDir::tempPath() + "/export_file_tests/";
+
+QByteArray Block(int size, char filler) {
+	return QByteArray(size, filler);
+}
+
+QByteArray ReadAll(const QString &path) {
+	auto file = QFile(path);
+	return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+Export::Data::MessagesSlice BenchmarkSlice(int firstId) {
+	auto result = Export::Data::MessagesSlice();
+	result.list.reserve(kBenchmarkSlice);
+	for (auto i = 0; i != kBenchmarkSlice; ++i) {
+		auto message = Export::Data::Message();
+		message.id = firstId + i;
+		message.date = 1'500'000'000 + message.id;
+		auto part = Export::Data::TextPart();
+		part.text = "Message text number " + QByteArray::number(message.id);
+		message.text.push_back(part);
+		result.list.push_back(std::move(message));
+	}
+	return result;
+}
+
+// Formats kBenchmarkMessages messages of one chat, returns microseconds.
+double FormatMessages(Format format) {
+	QDir(Folder).removeRecursively();
+
+	auto settings = Export::Settings();
+	settings.path = Folder;
+	settings.format = format;
+	auto stats = Stats();
+	const auto writer = CreateWriter(format);
+	auto dialog = Export::Data::DialogInfo();
+	dialog.type = Export::Data::DialogInfo::Type::Personal;
+	dialog.name = "Benchmark";
+	dialog.relativePath = "chats/chat_001/";
+	auto dialogs = Export::Data::DialogsInfo();
+	dialogs.chats.push_back(dialog);
+
+	const auto result = Measure([&] {
+		REQUIRE(writer->start(settings, Export::Environment(), &stats));
+		REQUIRE(writer->writeDialogsStart(dialogs));
+		REQUIRE(writer->writeDialogStart(dialog));
+		for (auto id = 1; id <= kBenchmarkMessages; id += kBenchmarkSlice) {
+			REQUIRE(writer->writeDialogSlice(BenchmarkSlice(id)));
+		}
+		REQUIRE(writer->writeDialogEnd());
+		REQUIRE(writer->writeDialogsEnd());
+		REQUIRE(writer->finish());
+	});
+
+	QDir(Folder).removeRecursively();
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("export file buffering", "[export_file]") {
+	QDir(Folder).removeRecursively();
+	const auto path = Folder + "file.bin";
+
+	SECTION("small blocks are written on flush") {
+		auto file = File(path, nullptr);
+		REQUIRE(file.writeBlock(Block(kSmallBlock, 'a')));
+		REQUIRE(file.writeBlock(Block(kSmallBlock, 'b')));
+		REQUIRE(file.size() == 2 * kSmallBlock);
+		REQUIRE(!QFile::exists(path));
+
+		REQUIRE(file.flush());
+		REQUIRE(ReadAll(path) == Block(kSmallBlock, 'a')
+			+ Block(kSmallBlock, 'b'));
+	}
+
+	SECTION("large block is written together with the buffer") {
+		auto file = File(path, nullptr);
+		REQUIRE(file.writeBlock(Block(kSmallBlock, 'a')));
+		REQUIRE(file.writeBlock(Block(kLargeBlock, 'b')));
+		REQUIRE(ReadAll(path) == Block(kSmallBlock, 'a')
+			+ Block(kLargeBlock, 'b'));
+		REQUIRE(file.size() == kSmallBlock + kLargeBlock);
+	}
+
+	SECTION("empty block creates the file") {
+		auto file = File(path, nullptr);
+		REQUIRE(file.writeBlock(QByteArray()));
+		REQUIRE(QFile::exists(path));
+		REQUIRE(file.empty());
+	}
+
+	SECTION("unflushed buffer is dropped when the file is destroyed") {
+		{
+			auto file = File(path, nullptr);
+			REQUIRE(file.writeBlock(Block(kSmallBlock, 'a')));
+			REQUIRE(file.flush());
+			REQUIRE(file.writeBlock(Block(kSmallBlock, 'b')));
+		}
+		REQUIRE(ReadAll(path) == Block(kSmallBlock, 'a'));
+	}
+
+	SECTION("stats count written bytes") {
+		auto stats = Stats();
+		{
+			auto file = File(path, &stats);
+			REQUIRE(file.writeBlock(Block(kSmallBlock, 'a')));
+			REQUIRE(file.writeBlock(Block(kLargeBlock, 'b')));
+			REQUIRE(file.writeBlock(Block(kSmallBlock, 'c')));
+			REQUIRE(file.flush());
+		}
+		REQUIRE(stats.filesCount() == 1);
+		REQUIRE(stats.bytesCount() == 2 * kSmallBlock + kLargeBlock);
+	}
+
+	QDir(Folder).removeRecursively();
+}
+
+TEST_CASE("export messages formatting", "[.][benchmark]") {
+	WARN("HTML: " << FormatMessages(Format::Html) << " us");
+	WARN("JSON: " << FormatMessages(Format::Json) << " us");
+	WARN("Text: " << FormatMessages(Format::Text) << " us");
+}
@@ -1771,7 +1771,10 @@ Result HtmlWriter::Wrap::close() {
 		while (!_context.empty()) {
 			block.append(_context.popTag());
 		}
-		return _file.writeBlock(block);
+		if (const auto result = _file.writeBlock(block); !result) {
+			return result;
+		}
+		return _file.flush();
 	}
 	return Result::Success();
 }
@@ -2362,21 +2365,17 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 		: 0;
 	auto previous = _lastMessageInfo.get();
 	auto saved = std::optional<MessageInfo>();
-	auto block = QByteArray();
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
 		}
 		const auto newIndex = (_messagesCount / kMessagesInFile);
 		if (oldIndex != newIndex) {
-			if (const auto result = _chat->writeBlock(block); !result) {
-				return result;
-			} else if (const auto next = switchToNextChatFile(newIndex)) {
+			if (const auto next = switchToNextChatFile(newIndex)) {
 				Assert(saved.has_value() || _lastMessageInfo != nullptr);
 				_lastMessageIdsPerFile.push_back(saved
 					? saved->id
 					: _lastMessageInfo->id);
-				block = QByteArray();
 				_lastMessageInfo = nullptr;
 				previous = nullptr;
 				saved = std::nullopt;
@@ -2393,11 +2392,14 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 		}
 		const auto date = message.date;
 		if (DisplayDate(date, previous ? previous->date : 0)) {
-			block.append(_chat->pushServiceMessage(
+			const auto result = _chat->writeBlock(_chat->pushServiceMessage(
 				--_dateMessageId,
 				_dialog,
 				_settings.path,
 				FormatDateText(date)));
+			if (!result) {
+				return result;
+			}
 		}
 		const auto [info, content] = _chat->pushMessage(
 			message,
@@ -2407,7 +2409,9 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 			data.peers,
 			_environment.internalLinksDomain,
 			messageLinkWrapper);
-		block.append(content);
+		if (const auto result = _chat->writeBlock(content); !result) {
+			return result;
+		}
 
 		++_messagesCount;
 		saved = info;
@@ -2416,7 +2420,7 @@ Result HtmlWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 	if (saved) {
 		_lastMessageInfo = std::make_unique<MessageInfo>(*saved);
 	}
-	return block.isEmpty() ? Result::Success() : _chat->writeBlock(block);
+	return Result::Success();
 }
 
 Result HtmlWriter::writeEmptySinglePeer() {
@@ -2449,6 +2453,31 @@ Result HtmlWriter::writeDialogEnd() {
 	} else if (_settings.onlySinglePeer()) {
 		return Result::Success();
 	}
+	return writeDialogListEntry();
+}
+
+bool HtmlWriter::canResumeDialogs() {
+	return true;
+}
+
+Result HtmlWriter::writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) {
+	Expects(_chat == nullptr);
+
+	_messagesCount = messagesCount;
+	_dialog = data;
+	return _settings.onlySinglePeer()
+		? Result::Success()
+		: writeDialogListEntry();
+}
+
+int HtmlWriter::dialogMessagesCount() const {
+	return _messagesCount;
+}
+
+Result HtmlWriter::writeDialogListEntry() {
+	Expects(_chats != nullptr);
 
 	using Type = Data::DialogInfo::Type;
 	const auto TypeString = [](Type type) {
@@ -70,6 +70,12 @@ public:
 	Result writeDialogEnd() override;
 	Result writeDialogsEnd() override;
 
+	bool canResumeDialogs() override;
+	Result writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) override;
+	int dialogMessagesCount() const override;
+
 	Result finish() override;
 
 	QString mainFilePath() override;
@@ -105,6 +111,7 @@ private:
 	[[nodiscard]] Result writeWebSessions(const Data::SessionsList &data);
 
 	[[nodiscard]] Result validateDialogsMode(bool isLeftChannel);
+	[[nodiscard]] Result writeDialogListEntry();
 	[[nodiscard]] Result writeDialogOpening(int index);
 	[[nodiscard]] Result switchToNextChatFile(int index);
 	[[nodiscard]] Result writeEmptySinglePeer();
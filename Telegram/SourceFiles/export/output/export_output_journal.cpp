@@ -0,0 +1,282 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "export/output/export_output_journal.h"
+
+#include "export/output/export_output_abstract.h"
+#include "export/output/export_output_result.h"
+#include "export/output/export_output_file.h"
+#include "export/export_settings.h"
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QDir>
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kSettingsTag = "settings";
+constexpr auto kFileTag = "file";
+constexpr auto kContentTag = "content";
+constexpr auto kDialogTag = "dialog";
+
+QByteArray SettingsLine(const QByteArray &fingerprint) {
+	return kSettingsTag + (' ' + fingerprint);
+}
+
+} // namespace
+
+Journal::Journal(const QString &folder)
+: _folder(folder)
+, _file(folder + FileName()) {
+}
+
+QString Journal::FileName() {
+	return ".export_journal";
+}
+
+bool Journal::Resumable(
+		const QString &folder,
+		const QByteArray &fingerprint) {
+	auto file = QFile(folder + FileName());
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const auto line = SettingsLine(fingerprint) + '\n';
+	return (file.read(line.size()) == line);
+}
+
+Result Journal::start(const QByteArray &fingerprint) {
+	Expects(!_file.isOpen());
+	Expects(!fingerprint.contains('\n'));
+
+	const auto length = read(fingerprint);
+	_resumed = (length > 0);
+	if (!_resumed) {
+		_files.clear();
+		_contents.clear();
+		_paths.clear();
+		_dialogs.clear();
+	}
+	if (_file.exists() && !_file.resize(length)) {
+		return error();
+	}
+	if (!_file.open(QIODevice::Append)) {
+		const auto dir = QFileInfo(_file).absoluteDir();
+		if (dir.exists()
+			|| !dir.mkpath(dir.absolutePath())
+			|| !_file.open(QIODevice::Append)) {
+			return error();
+		}
+	}
+	return _resumed ? Result::Success() : append(SettingsLine(fingerprint));
+}
+
+bool Journal::resumed() const {
+	return _resumed;
+}
+
+int Journal::read(const QByteArray &fingerprint) {
+	if (!_file.open(QIODevice::ReadOnly)) {
+		return 0;
+	}
+	const auto content = _file.readAll();
+	_file.close();
+
+	// A line without the trailing '\n' was interrupted while being written.
+	auto lineStart = 0;
+	auto lineEnd = content.indexOf('\n');
+	if (lineEnd < 0
+		|| content.mid(0, lineEnd) != SettingsLine(fingerprint)) {
+		return 0;
+	}
+	for (lineStart = lineEnd + 1
+		; (lineEnd = content.indexOf('\n', lineStart)) >= 0
+		; lineStart = lineEnd + 1) {
+		if (!readLine(content.mid(lineStart, lineEnd - lineStart))) {
+			break;
+		}
+	}
+	return lineStart;
+}
+
+bool Journal::readLine(const QByteArray &line) {
+	const auto tag = line.mid(0, line.indexOf(' '));
+	if (tag == kFileTag) {
+		return readEntry(line, _files);
+	} else if (tag == kContentTag) {
+		return readEntry(line, _contents);
+	} else if (tag == kDialogTag) {
+		const auto parts = line.split(' ');
+		if (parts.size() != 3) {
+			return false;
+		}
+		auto peerOk = false;
+		auto countOk = false;
+		const auto peerId = parts[1].toULongLong(&peerOk);
+		const auto count = parts[2].toInt(&countOk);
+		if (!peerOk || !countOk) {
+			return false;
+		}
+		_dialogs[peerId] = count;
+		return true;
+	}
+	return false;
+}
+
+bool Journal::readEntry(
+		const QByteArray &line,
+		base::flat_map<QByteArray, FileEntry> &entries) {
+	const auto parts = line.split(' ');
+	if (parts.size() < 4) {
+		return false;
+	}
+	auto ok = false;
+	auto entry = FileEntry();
+	entry.size = parts[2].toLongLong(&ok);
+	if (!ok || parts[1].isEmpty()) {
+		return false;
+	}
+	const auto pathStart = parts[0].size()
+		+ parts[1].size()
+		+ parts[2].size()
+		+ 3;
+	entry.relativePath = QString::fromUtf8(line.mid(pathStart));
+
+	// Files that were removed or changed since then are loaded again.
+	if (validateFile(entry)) {
+		takePath(entry.relativePath);
+		entries[parts[1]] = std::move(entry);
+	}
+	return true;
+}
+
+bool Journal::validateFile(const FileEntry &entry) const {
+	const auto info = QFileInfo(_folder + entry.relativePath);
+	return info.isFile() && (info.size() == entry.size);
+}
+
+auto Journal::findFile(const QByteArray &key) const -> const FileEntry* {
+	const auto i = _files.find(key);
+	return (i != end(_files)) ? &i->second : nullptr;
+}
+
+bool Journal::isPathTaken(const QString &relativePath) const {
+	return _paths.contains(relativePath);
+}
+
+void Journal::takePath(const QString &relativePath) {
+	_paths.emplace(relativePath);
+}
+
+QString Journal::prepareRelativePath(const QString &suggested) {
+	const auto result = File::PrepareRelativePath(
+		suggested,
+		[&](const QString &relativePath) {
+			return isPathTaken(relativePath)
+				|| (!_resumed && QFile::exists(_folder + relativePath));
+		});
+	takePath(result);
+	return result;
+}
+
+Result Journal::fileDone(
+		const QByteArray &key,
+		const QString &relativePath,
+		int64 size) {
+	Expects(!key.isEmpty() && !key.contains(' ') && !key.contains('\n'));
+
+	if (relativePath.contains('\n')) {
+		return Result::Success();
+	}
+	takePath(relativePath);
+	return appendEntry(
+		kFileTag,
+		key,
+		_files[key] = FileEntry{ relativePath, size });
+}
+
+auto Journal::findContent(const QByteArray &hash) const
+-> const FileEntry* {
+	const auto i = _contents.find(hash.toHex());
+	return (i != end(_contents)) ? &i->second : nullptr;
+}
+
+Result Journal::contentDone(
+		const QByteArray &hash,
+		const QString &relativePath,
+		int64 size) {
+	Expects(!hash.isEmpty());
+
+	if (relativePath.contains('\n')) {
+		return Result::Success();
+	}
+	const auto key = hash.toHex();
+	return appendEntry(
+		kContentTag,
+		key,
+		_contents[key] = FileEntry{ relativePath, size });
+}
+
+Result Journal::appendEntry(
+		const char *tag,
+		const QByteArray &key,
+		const FileEntry &entry) {
+	return append(tag
+		+ (' ' + key)
+		+ ' ' + QByteArray::number(entry.size)
+		+ ' ' + entry.relativePath.toUtf8());
+}
+
+std::optional<int> Journal::dialogMessagesCount(uint64 peerId) const {
+	const auto i = _dialogs.find(peerId);
+	return (i != end(_dialogs))
+		? std::make_optional(i->second)
+		: std::nullopt;
+}
+
+Result Journal::dialogDone(uint64 peerId, int messagesCount) {
+	_dialogs[peerId] = messagesCount;
+	return append(kDialogTag
+		+ (' ' + QByteArray::number(peerId))
+		+ ' ' + QByteArray::number(messagesCount));
+}
+
+Result Journal::finish() {
+	_file.close();
+	return (!_file.exists() || _file.remove())
+		? Result::Success()
+		: error();
+}
+
+Result Journal::append(const QByteArray &line) {
+	Expects(_file.isOpen());
+
+	const auto data = line + '\n';
+	return (_file.write(data) == data.size() && _file.flush())
+		? Result::Success()
+		: error();
+}
+
+Result Journal::error() const {
+	return Result(Result::Type::Error, _file.fileName());
+}
+
+std::optional<int> ResumedMessagesCount(
+		const Journal &journal,
+		not_null<AbstractWriter*> writer,
+		const Settings &settings,
+		uint64 peerId) {
+	if (!journal.resumed()
+		|| settings.onlySinglePeer()
+		|| !writer->canResumeDialogs()) {
+		return std::nullopt;
+	}
+	return journal.dialogMessagesCount(peerId);
+}
+
+} // namespace Output
+} // namespace Export
@@ -0,0 +1,109 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/optional.h"
+#include "base/flat_map.h"
+#include "base/flat_set.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+
+namespace Export {
+
+struct Settings;
+
+namespace Output {
+
+struct Result;
+class AbstractWriter;
+
+// Append-only log of the finished parts of an export, kept in the export
+// folder while the export is running. If the export is interrupted the
+// next one with the same settings picks up the folder and the journal
+// and skips everything that was recorded as finished.
+class Journal {
+public:
+	struct FileEntry {
+		QString relativePath;
+		int64 size = 0;
+	};
+
+	explicit Journal(const QString &folder);
+
+	[[nodiscard]] static QString FileName();
+	[[nodiscard]] static bool Resumable(
+		const QString &folder,
+		const QByteArray &fingerprint);
+
+	[[nodiscard]] Result start(const QByteArray &fingerprint);
+	[[nodiscard]] bool resumed() const;
+
+	[[nodiscard]] const FileEntry *findFile(const QByteArray &key) const;
+	[[nodiscard]] bool isPathTaken(const QString &relativePath) const;
+	void takePath(const QString &relativePath);
+
+	// Takes a free path for a new file. When resuming, files not listed
+	// in the journal are leftovers of the interrupted export and may be
+	// overwritten, otherwise existing files are left alone.
+	[[nodiscard]] QString prepareRelativePath(const QString &suggested);
+
+	[[nodiscard]] Result fileDone(
+		const QByteArray &key,
+		const QString &relativePath,
+		int64 size);
+
+	// Files with the same content are kept only once, by the hash of it.
+	[[nodiscard]] const FileEntry *findContent(
+		const QByteArray &hash) const;
+	[[nodiscard]] Result contentDone(
+		const QByteArray &hash,
+		const QString &relativePath,
+		int64 size);
+
+	[[nodiscard]] std::optional<int> dialogMessagesCount(
+		uint64 peerId) const;
+	[[nodiscard]] Result dialogDone(uint64 peerId, int messagesCount);
+
+	[[nodiscard]] Result finish();
+
+private:
+	[[nodiscard]] int read(const QByteArray &fingerprint);
+	[[nodiscard]] bool readLine(const QByteArray &line);
+	[[nodiscard]] bool readEntry(
+		const QByteArray &line,
+		base::flat_map<QByteArray, FileEntry> &entries);
+	[[nodiscard]] Result appendEntry(
+		const char *tag,
+		const QByteArray &key,
+		const FileEntry &entry);
+	[[nodiscard]] bool validateFile(const FileEntry &entry) const;
+	[[nodiscard]] Result append(const QByteArray &line);
+	[[nodiscard]] Result error() const;
+
+	QString _folder;
+	QFile _file;
+	bool _resumed = false;
+
+	base::flat_map<QByteArray, FileEntry> _files;
+	base::flat_map<QByteArray, FileEntry> _contents;
+	base::flat_set<QString> _paths;
+	base::flat_map<uint64, int> _dialogs;
+
+};
+
+// Messages count of a dialog that was fully written by an interrupted
+// export, std::nullopt if the messages of the dialog should be written.
+[[nodiscard]] std::optional<int> ResumedMessagesCount(
+	const Journal &journal,
+	not_null<AbstractWriter*> writer,
+	const Settings &settings,
+	uint64 peerId);
+
+} // namespace Output
+} // namespace Export
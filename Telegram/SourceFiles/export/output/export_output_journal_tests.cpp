@@ -0,0 +1,306 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/basic_types.h"
+#include "export/export_settings.h"
+#include "export/data/export_data_types.h"
+#include "export/output/export_output_abstract.h"
+#include "export/output/export_output_journal.h"
+#include "export/output/export_output_file.h"
+#include "export/output/export_output_result.h"
+#include "export/output/export_output_stats.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+
+#include <random>
+
+using namespace Export::Output;
+
+namespace {
+
+constexpr auto kDialogsCount = 4;
+constexpr auto kFilesInDialog = 5;
+constexpr auto kChunkSize = 64;
+
+const auto Folder = QDir::tempPath() + "/export_journal_tests/";
+const auto ExpectedFolder = QDir::tempPath() + "/export_journal_expected/";
+
+// A stub of the server side of an export: a fixed set of dialogs with a
+// few documents each, the same file name suggested for all of them.
+QByteArray FileKey(int dialog, int file) {
+	return QByteArray::number(dialog) + '_' + QByteArray::number(file);
+}
+
+QByteArray FileContent(int dialog, int file) {
+	auto result = QByteArray();
+	const auto size = (dialog * kFilesInDialog + file + 1) * kChunkSize / 3;
+	for (auto i = 0; i != size; ++i) {
+		result.append(char('a' + ((dialog + file + i) % 26)));
+	}
+	return result;
+}
+
+QString SuggestedPath(int dialog) {
+	return QString("chats/chat_%1/files/file.bin").arg(dialog);
+}
+
+Export::Settings PrepareSettings(const QString &folder) {
+	auto result = Export::Settings();
+	result.path = folder;
+	result.format = Format::Text;
+	return result;
+}
+
+Export::Data::DialogsInfo PrepareDialogs() {
+	auto result = Export::Data::DialogsInfo();
+	for (auto dialog = 0; dialog != kDialogsCount; ++dialog) {
+		auto info = Export::Data::DialogInfo();
+		info.type = Export::Data::DialogInfo::Type::Personal;
+		info.name = "Chat " + QByteArray::number(dialog);
+		info.peerId = dialog + 1;
+		info.relativePath = QString("chats/chat_%1/").arg(dialog);
+		result.chats.push_back(std::move(info));
+	}
+	return result;
+}
+
+struct Resumed {
+	int dialogs = 0;
+	int files = 0;
+};
+
+class ExportRun {
+public:
+	ExportRun(const QString &folder, int stepsLimit, Resumed &resumed);
+
+	// Returns true if the export was finished, false if it was aborted
+	// without any cleanup after 'stepsLimit' file chunks were written.
+	bool run();
+
+private:
+	std::optional<QString> loadFile(int dialog, int index);
+
+	const QString _folder;
+	const Export::Settings _settings;
+	const int _stepsLimit = 0;
+	Resumed &_resumed;
+	Journal _journal;
+	int _steps = 0;
+
+};
+
+ExportRun::ExportRun(const QString &folder, int stepsLimit, Resumed &resumed)
+: _folder(folder)
+, _settings(PrepareSettings(folder))
+, _stepsLimit(stepsLimit)
+, _resumed(resumed)
+, _journal(folder) {
+}
+
+// Writes the dialogs the way ControllerObject does it, with the files
+// loaded the way ApiWrap does it, only without the network requests.
+bool ExportRun::run() {
+	REQUIRE(_journal.start(ResumeFingerprint(_settings)));
+
+	auto stats = Stats();
+	const auto writer = CreateWriter(_settings.format);
+	REQUIRE(writer->start(_settings, Export::Environment(), &stats));
+
+	const auto dialogs = PrepareDialogs();
+	REQUIRE(writer->writeDialogsStart(dialogs));
+	for (auto dialog = 0; dialog != kDialogsCount; ++dialog) {
+		const auto &info = dialogs.chats[dialog];
+		const auto resumed = ResumedMessagesCount(
+			_journal,
+			writer.get(),
+			_settings,
+			info.peerId);
+		if (resumed) {
+			REQUIRE(writer->writeDialogResumed(info, *resumed));
+			++_resumed.dialogs;
+			continue;
+		}
+		REQUIRE(writer->writeDialogStart(info));
+		auto slice = Export::Data::MessagesSlice();
+		for (auto index = 0; index != kFilesInDialog; ++index) {
+			auto document = Export::Data::Document();
+			document.name = "file.bin";
+			document.file.size = FileContent(dialog, index).size();
+			const auto relativePath = loadFile(dialog, index);
+			if (!relativePath) {
+				return false;
+			}
+			document.file.relativePath = *relativePath;
+
+			auto message = Export::Data::Message();
+			message.id = index + 1;
+			message.date = 1'500'000'000 + message.id;
+			message.media.content = std::move(document);
+			slice.list.push_back(std::move(message));
+		}
+		REQUIRE(writer->writeDialogSlice(slice));
+		REQUIRE(writer->writeDialogEnd());
+		REQUIRE(_journal.dialogDone(
+			info.peerId,
+			writer->dialogMessagesCount()));
+	}
+	REQUIRE(writer->writeDialogsEnd());
+	REQUIRE(writer->finish());
+	REQUIRE(_journal.finish());
+	return true;
+}
+
+std::optional<QString> ExportRun::loadFile(int dialog, int index) {
+	const auto key = FileKey(dialog, index);
+	if (const auto entry = _journal.findFile(key)) {
+		++_resumed.files;
+		return entry->relativePath;
+	}
+	const auto relativePath = _journal.prepareRelativePath(
+		SuggestedPath(dialog));
+
+	auto file = File(_folder + relativePath, nullptr);
+	const auto content = FileContent(dialog, index);
+	for (auto i = 0; i < content.size(); i += kChunkSize) {
+		if (_steps++ == _stepsLimit) {
+			return std::nullopt;
+		}
+		REQUIRE(file.writeBlock(content.mid(i, kChunkSize)));
+	}
+	REQUIRE(file.flush());
+	REQUIRE(_journal.fileDone(key, relativePath, file.size()));
+	return relativePath;
+}
+
+bool RunExport(int stepsLimit, Resumed &resumed) {
+	return ExportRun(Folder, stepsLimit, resumed).run();
+}
+
+std::map<QString, QByteArray> ReadFolder(const QString &folder) {
+	auto result = std::map<QString, QByteArray>();
+	const auto root = QDir(folder);
+	auto i = QDirIterator(
+		folder,
+		QDir::Files | QDir::Hidden,
+		QDirIterator::Subdirectories);
+	while (i.hasNext()) {
+		auto file = QFile(i.next());
+		REQUIRE(file.open(QIODevice::ReadOnly));
+		result.emplace(
+			root.relativeFilePath(file.fileName()),
+			file.readAll());
+	}
+	return result;
+}
+
+// The output of an export that was never interrupted.
+const std::map<QString, QByteArray> &Expected() {
+	static const auto result = [] {
+		QDir(ExpectedFolder).removeRecursively();
+		auto resumed = Resumed();
+		REQUIRE(ExportRun(ExpectedFolder, -1, resumed).run());
+		auto files = ReadFolder(ExpectedFolder);
+		QDir(ExpectedFolder).removeRecursively();
+		return files;
+	}();
+	return result;
+}
+
+void CheckExported() {
+	const auto exported = ReadFolder(Folder);
+	REQUIRE(exported.find(Journal::FileName()) == end(exported));
+	REQUIRE(exported.size() == Expected().size());
+	for (const auto &[relativePath, content] : Expected()) {
+		const auto i = exported.find(relativePath);
+		REQUIRE(i != end(exported));
+		REQUIRE(i->second == content);
+	}
+}
+
+} // namespace
+
+TEST_CASE("export journal", "[export_journal]") {
+	QDir(Folder).removeRecursively();
+
+	SECTION("export without interruptions") {
+		auto resumed = Resumed();
+		REQUIRE(RunExport(-1, resumed));
+		CheckExported();
+		REQUIRE(resumed.files == 0);
+		REQUIRE(resumed.dialogs == 0);
+		REQUIRE(Expected().size()
+			== kDialogsCount * (kFilesInDialog + 1) + 2);
+	}
+
+	SECTION("export interrupted at random points") {
+		auto generator = std::mt19937(1234);
+		auto distribution = std::uniform_int_distribution<int>(0, 40);
+		auto resumed = Resumed();
+		auto interruptions = 0;
+		while (!RunExport(distribution(generator), resumed)) {
+			++interruptions;
+		}
+		CheckExported();
+		REQUIRE(interruptions > 0);
+		REQUIRE(resumed.files > 0);
+		REQUIRE(resumed.dialogs > 0);
+	}
+
+	SECTION("partial journal line is ignored") {
+		auto resumed = Resumed();
+		REQUIRE(!RunExport(10, resumed));
+		{
+			auto file = QFile(Folder + Journal::FileName());
+			REQUIRE(file.open(QIODevice::Append));
+			REQUIRE(file.write("file 3_1 100 chats/chat_3/fi") > 0);
+		}
+		REQUIRE(RunExport(-1, resumed));
+		CheckExported();
+	}
+
+	SECTION("file contents are found after resume") {
+		const auto fingerprint = ResumeFingerprint(PrepareSettings(Folder));
+		const auto hash = QByteArray("\x01\x02\xab", 3);
+		const auto path = SuggestedPath(0);
+		{
+			auto journal = Journal(Folder);
+			REQUIRE(journal.start(fingerprint));
+			auto file = File(Folder + path, nullptr);
+			REQUIRE(file.writeBlock(FileContent(0, 0)));
+			REQUIRE(file.flush());
+			REQUIRE(journal.contentDone(hash, path, file.size()));
+		}
+		auto journal = Journal(Folder);
+		REQUIRE(journal.start(fingerprint));
+		REQUIRE(journal.resumed());
+		const auto entry = journal.findContent(hash);
+		REQUIRE(entry != nullptr);
+		REQUIRE(entry->relativePath == path);
+		REQUIRE(entry->size == FileContent(0, 0).size());
+		REQUIRE(journal.isPathTaken(path));
+		REQUIRE(journal.findContent("other") == nullptr);
+		REQUIRE(journal.finish());
+	}
+
+	SECTION("journal with other settings is not resumed") {
+		const auto fingerprint = ResumeFingerprint(PrepareSettings(Folder));
+		auto resumed = Resumed();
+		REQUIRE(!RunExport(10, resumed));
+		REQUIRE(Journal::Resumable(Folder, fingerprint));
+		REQUIRE(!Journal::Resumable(Folder, "other_settings"));
+
+		auto journal = Journal(Folder);
+		REQUIRE(journal.start("other_settings"));
+		REQUIRE(!journal.resumed());
+		REQUIRE(journal.findFile(FileKey(0, 0)) == nullptr);
+	}
+
+	QDir(Folder).removeRecursively();
+}
@@ -1018,6 +1018,7 @@ Result JsonWriter::writeDialogStart(const Data::DialogInfo &data) {
 		+ Data::NumberToString(data.peerId));
 	block.append(prepareObjectItemStart("messages"));
 	block.append(pushNesting(Context::kArray));
+	_messagesCount = 0;
 	return _output->writeBlock(block);
 }
 
@@ -1043,18 +1044,25 @@ Result JsonWriter::validateDialogsMode(bool isLeftChannel) {
 Result JsonWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 	Expects(_output != nullptr);
 
-	auto block = QByteArray();
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
 		}
-		block.append(prepareArrayItemStart() + SerializeMessage(
+		const auto start = _output->writeBlock(prepareArrayItemStart());
+		if (!start) {
+			return start;
+		}
+		const auto result = _output->writeBlock(SerializeMessage(
 			_context,
 			message,
 			data.peers,
 			_environment.internalLinksDomain));
+		if (!result) {
+			return result;
+		}
+		++_messagesCount;
 	}
-	return block.isEmpty() ? Result::Success() : _output->writeBlock(block);
+	return Result::Success();
 }
 
 Result JsonWriter::writeDialogEnd() {
@@ -1068,6 +1076,20 @@ Result JsonWriter::writeDialogsEnd() {
 	return writeChatsEnd();
 }
 
+bool JsonWriter::canResumeDialogs() {
+	return false;
+}
+
+Result JsonWriter::writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) {
+	Unexpected("Messages are written to the main file in JsonWriter.");
+}
+
+int JsonWriter::dialogMessagesCount() const {
+	return _messagesCount;
+}
+
 Result JsonWriter::writeChatsStart(
 		const QByteArray &listName,
 		const QByteArray &about) {
@@ -1093,7 +1115,10 @@ Result JsonWriter::finish() {
 
 	auto block = popNesting();
 	Assert(_context.nesting.empty());
-	return _output->writeBlock(block);
+	if (const auto result = _output->writeBlock(block); !result) {
+		return result;
+	}
+	return _output->flush();
 }
 
 QString JsonWriter::mainFilePath() {
@@ -55,6 +55,12 @@ public:
 	Result writeDialogEnd() override;
 	Result writeDialogsEnd() override;
 
+	bool canResumeDialogs() override;
+	Result writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) override;
+	int dialogMessagesCount() const override;
+
 	Result finish() override;
 
 	QString mainFilePath() override;
@@ -96,6 +102,7 @@ private:
 	Context _context;
 	bool _currentNestingHadItem = false;
 	DialogsMode _dialogsMode = DialogsMode::None;
+	int _messagesCount = 0;
 
 	std::unique_ptr<File> _output;
 
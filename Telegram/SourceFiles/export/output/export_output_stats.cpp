@@ -11,17 +11,24 @@ namespace Output {
 
 Stats::Stats(const Stats &other)
 : _files(other._files.load())
-, _bytes(other._bytes.load()) {
+, _bytes(other._bytes.load())
+, _bytesSaved(other._bytesSaved.load()) {
 }
 
 void Stats::incrementFiles() {
 	++_files;
 }
 
-void Stats::incrementBytes(int count) {
+void Stats::incrementBytes(int64 count) {
 	_bytes += count;
 }
 
+void Stats::removeDuplicate(int64 size) {
+	--_files;
+	_bytes -= size;
+	_bytesSaved += size;
+}
+
 int Stats::filesCount() const {
 	return _files;
 }
@@ -30,5 +37,9 @@ int64 Stats::bytesCount() const {
 	return _bytes;
 }
 
+int64 Stats::bytesSavedCount() const {
+	return _bytesSaved;
+}
+
 } // namespace Output
 } // namespace Export
@@ -17,14 +17,23 @@ public:
 	Stats(const Stats &other);
 
 	void incrementFiles();
-	void incrementBytes(int count);
+	void incrementBytes(int64 count);
+
+	// A written file was removed because the same content was already
+	// exported to another one, its bytes are moved to the saved count.
+	void removeDuplicate(int64 size);
 
 	int filesCount() const;
 	int64 bytesCount() const;
 
+	// Bytes of the files that were not kept because the same content
+	// was already exported to another file.
+	int64 bytesSavedCount() const;
+
 private:
-	std::atomic<int> _files;
-	std::atomic<int64> _bytes;
+	std::atomic<int> _files = 0;
+	std::atomic<int64> _bytes = 0;
+	std::atomic<int64> _bytesSaved = 0;
 
 };
 
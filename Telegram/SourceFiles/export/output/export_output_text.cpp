@@ -553,8 +553,9 @@ Result TextWriter::writeUserpicsSlice(const Data::UserpicsSlice &data) {
 }
 
 Result TextWriter::writeUserpicsEnd() {
-	_userpics = nullptr;
-	return Result::Success();
+	return _userpics
+		? base::take(_userpics)->flush()
+		: Result::Success();
 }
 
 Result TextWriter::writeContactsList(const Data::ContactsList &data) {
@@ -601,6 +602,8 @@ Result TextWriter::writeSavedContacts(const Data::ContactsList &data) {
 		+ JoinList(kLineBreak, list);
 	if (const auto result = file->writeBlock(full); !result) {
 		return result;
+	} else if (const auto flushed = file->flush(); !flushed) {
+		return flushed;
 	}
 
 	const auto header = "Contacts "
@@ -680,6 +683,8 @@ Result TextWriter::writeFrequentContacts(const Data::ContactsList &data) {
 		+ JoinList(kLineBreak, list);
 	if (const auto result = file->writeBlock(full); !result) {
 		return result;
+	} else if (const auto flushed = file->flush(); !flushed) {
+		return flushed;
 	}
 
 	const auto header = "Frequent contacts "
@@ -736,6 +741,8 @@ Result TextWriter::writeSessions(const Data::SessionsList &data) {
 		+ JoinList(kLineBreak, list);
 	if (const auto result = file->writeBlock(full); !result) {
 		return result;
+	} else if (const auto flushed = file->flush(); !flushed) {
+		return flushed;
 	}
 
 	const auto header = "Sessions "
@@ -784,6 +791,8 @@ Result TextWriter::writeWebSessions(const Data::SessionsList &data) {
 		+ JoinList(kLineBreak, list);
 	if (const auto result = file->writeBlock(full); !result) {
 		return result;
+	} else if (const auto flushed = file->flush(); !flushed) {
+		return flushed;
 	}
 
 	const auto header = "Web sessions "
@@ -847,32 +856,60 @@ Result TextWriter::writeDialogSlice(const Data::MessagesSlice &data) {
 	Expects(_chat != nullptr);
 	Expects(!data.list.empty());
 
-	auto list = std::vector<QByteArray>();
-	list.reserve(data.list.size());
 	for (const auto &message : data.list) {
 		if (Data::SkipMessageByDate(message, _settings)) {
 			continue;
+		} else if (!_chat->empty()) {
+			if (const auto result = _chat->writeBlock(kLineBreak); !result) {
+				return result;
+			}
 		}
-		list.push_back(SerializeMessage(
+		const auto result = _chat->writeBlock(SerializeMessage(
 			message,
 			data.peers,
 			_environment.internalLinksDomain));
+		if (!result) {
+			return result;
+		}
 		++_messagesCount;
 	}
-	if (list.empty()) {
-		return Result::Success();
-	}
-	const auto full = _chat->empty()
-		? JoinList(kLineBreak, list)
-		: kLineBreak + JoinList(kLineBreak, list);
-	return _chat->writeBlock(full);
+	return Result::Success();
 }
 
 Result TextWriter::writeDialogEnd() {
 	Expects(_chats != nullptr);
 	Expects(_chat != nullptr);
 
-	_chat = nullptr;
+	if (const auto flushed = base::take(_chat)->flush(); !flushed) {
+		return flushed;
+	}
+	return writeDialogListEntry();
+}
+
+bool TextWriter::canResumeDialogs() {
+	return true;
+}
+
+Result TextWriter::writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) {
+	Expects(_chat == nullptr);
+
+	const auto result = validateDialogsMode(data.isLeftChannel);
+	if (!result) {
+		return result;
+	}
+	_messagesCount = messagesCount;
+	_dialog = data;
+	return writeDialogListEntry();
+}
+
+int TextWriter::dialogMessagesCount() const {
+	return _messagesCount;
+}
+
+Result TextWriter::writeDialogListEntry() {
+	Expects(_chats != nullptr);
 
 	using Type = Data::DialogInfo::Type;
 	const auto TypeString = [](Type type) {
@@ -961,12 +998,15 @@ Result TextWriter::writeChatsStart(
 }
 
 Result TextWriter::writeChatsEnd() {
-	_chats = nullptr;
-	return Result::Success();
+	return _chats
+		? base::take(_chats)->flush()
+		: Result::Success();
 }
 
 Result TextWriter::finish() {
-	return Result::Success();
+	Expects(_summary != nullptr);
+
+	return _summary->flush();
 }
 
 QString TextWriter::mainFilePath() {
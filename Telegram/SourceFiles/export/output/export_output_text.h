@@ -43,6 +43,12 @@ public:
 	Result writeDialogEnd() override;
 	Result writeDialogsEnd() override;
 
+	bool canResumeDialogs() override;
+	Result writeDialogResumed(
+		const Data::DialogInfo &data,
+		int messagesCount) override;
+	int dialogMessagesCount() const override;
+
 	Result finish() override;
 
 	QString mainFilePath() override;
@@ -66,6 +72,7 @@ private:
 	[[nodiscard]] Result writeWebSessions(const Data::SessionsList &data);
 
 	[[nodiscard]] Result validateDialogsMode(bool isLeftChannel);
+	[[nodiscard]] Result writeDialogListEntry();
 	[[nodiscard]] Result writeChatsStart(
 		int count,
 		const QByteArray &listName,
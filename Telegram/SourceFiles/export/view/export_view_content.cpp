@@ -26,11 +26,19 @@ Content ContentFromState(const ProcessingState &state) {
 		result.rows.push_back({ id, label, info, progress });
 	};
 	const auto pushMain = [&](const QString &label) {
-		const auto info = (state.entityCount > 0)
+		const auto count = (state.entityCount > 0)
 			? (QString::number(state.entityIndex + 1)
 				+ " / "
 				+ QString::number(state.entityCount))
 			: QString();
+		const auto speed = (state.bytesPerSecond > 0)
+			? lng_export_speed(
+				lt_size,
+				formatSizeText(state.bytesPerSecond))
+			: QString();
+		const auto info = (count.isEmpty() || speed.isEmpty())
+			? (count + speed)
+			: (count + ", " + speed);
 		if (!state.substepsTotal) {
 			push("main", label, info, 0.);
 			return;
@@ -136,6 +144,15 @@ Content ContentFromState(const FinishedState &state) {
 		lng_export_total_size(lt_size, formatSizeText(state.bytesCount)),
 		QString(),
 		1. });
+	if (state.bytesSaved > 0) {
+		result.rows.push_back({
+			Content::kDoneId,
+			lng_export_saved_size(
+				lt_size,
+				formatSizeText(state.bytesSaved)),
+			QString(),
+			1. });
+	}
 	return result;
 }
 
@@ -8,6 +8,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 
 #include "export/view/export_view_settings.h"
 #include "export/view/export_view_progress.h"
+#include "export/output/export_output_abstract.h"
 #include "ui/widgets/labels.h"
 #include "ui/widgets/separate_panel.h"
 #include "ui/wrap/padding_wrap.h"
@@ -169,8 +170,7 @@ void PanelController::showSettings() {
 
 	settings->startClicks(
 	) | rpl::start_with_next([=]() {
-		showProgress();
-		_process->startExport(*_settings, PrepareEnvironment());
+		startExport();
 	}, settings->lifetime());
 
 	settings->cancelClicks(
@@ -187,6 +187,32 @@ void PanelController::showSettings() {
 	_panel->showInner(std::move(settings));
 }
 
+void PanelController::startExport() {
+	const auto resumable = Output::FindResumablePath(
+		NormalizeSettings(*_settings));
+	if (!resumable) {
+		startExport(QString());
+		return;
+	}
+	const auto path = *resumable;
+	_panel->showBox(
+		Box<ConfirmBox>(
+			lng_export_resume(lt_path, QDir::toNativeSeparators(path)),
+			lang(lng_export_resume_continue),
+			lang(lng_export_resume_restart),
+			[=] { startExport(path); },
+			[=] { startExport(QString()); }),
+		LayerOption::KeepOther,
+		anim::type::normal);
+}
+
+void PanelController::startExport(const QString &resumePath) {
+	LOG(("Export Info: Start, resume path '%1'.").arg(resumePath));
+	_settings->resumePath = resumePath;
+	showProgress();
+	_process->startExport(*_settings, PrepareEnvironment());
+}
+
 void PanelController::showError(const ApiErrorState &error) {
 	LOG(("Export Info: API Error '%1'.").arg(error.data.type()));
 
@@ -56,6 +56,8 @@ private:
 	void createPanel();
 	void updateState(State &&state);
 	void showSettings();
+	void startExport();
+	void startExport(const QString &resumePath);
 	void showProgress();
 	void showError(const ApiErrorState &error);
 	void showError(const OutputErrorState &error);
@@ -236,6 +236,24 @@ void SettingsWidget::setupPathAndFormat(
 	addLocationLabel(container);
 	addFormatOption(lng_export_option_html, Format::Html);
 	addFormatOption(lng_export_option_json, Format::Json);
+	addArchiveOption(container);
+}
+
+void SettingsWidget::addArchiveOption(
+		not_null<Ui::VerticalLayout*> container) {
+	const auto checkbox = container->add(
+		object_ptr<Ui::Checkbox>(
+			container,
+			lang(lng_export_option_archive),
+			readData().archive,
+			st::defaultBoxCheckbox),
+		st::exportSettingPadding);
+	checkbox->checkedChanges(
+	) | rpl::start_with_next([=](bool checked) {
+		changeData([&](Settings &data) {
+			data.archive = checked;
+		});
+	}, checkbox->lifetime());
 }
 
 void SettingsWidget::addLocationLabel(
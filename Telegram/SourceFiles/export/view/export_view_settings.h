@@ -74,6 +74,7 @@ private:
 		LangKey key,
 		MediaType type);
 	void addSizeSlider(not_null<Ui::VerticalLayout*> container);
+	void addArchiveOption(not_null<Ui::VerticalLayout*> container);
 	void addLocationLabel(
 		not_null<Ui::VerticalLayout*> container);
 	void addLimitsLabel(
@@ -812,18 +812,18 @@ void History::addUnreadMentionsSlice(const MTPmessages_Messages &result) {
 	default: Unexpected("type in History::addUnreadMentionsSlice");
 	}
 
-	auto added = false;
+	auto added = std::vector<MsgId>();
 	if (messages) {
 		for (auto &message : *messages) {
 			if (auto item = addToHistory(message)) {
 				if (item->isUnreadMention()) {
-					_unreadMentions.insert(item->id);
-					added = true;
+					added.push_back(item->id);
 				}
 			}
 		}
 	}
-	if (!added) {
+	_unreadMentions.merge(begin(added), end(added));
+	if (added.empty()) {
 		count = _unreadMentions.size();
 	}
 	setUnreadMentionsCount(count);
@@ -1699,7 +1699,7 @@ bool History::changeMute(bool newMute) {
 				entriesWithUnreadDelta,
 				mutedEntriesWithUnreadDelta);
 
-			Notify::unreadCounterUpdated();
+			_owner->notifyUnreadCounterUpdated();
 		}
 		Notify::historyMuteUpdated(this);
 	}
@@ -2584,6 +2584,22 @@ void History::resizeToWidth(int newWidth) {
 	}
 	_flags &= ~(Flag::f_has_pending_resized_items);
 
+	if (resizeAllItems) {
+		auto requests = std::vector<HistoryView::TextLayoutRequest>();
+		for (const auto &block : blocks) {
+			for (const auto &message : block->messages) {
+				if (message->pendingResize()) {
+					continue;
+				}
+				const auto request = message->textLayoutRequest(newWidth);
+				if (request.text) {
+					requests.push_back(request);
+				}
+			}
+		}
+		HistoryView::PrepareTextLayouts(std::move(requests));
+	}
+
 	_width = newWidth;
 	int y = 0;
 	for (const auto &block : blocks) {
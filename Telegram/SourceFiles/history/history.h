@@ -467,7 +467,7 @@ private:
 	std::optional<MsgId> _outboxReadBefore;
 	std::optional<int> _unreadCount;
 	std::optional<int> _unreadMentionsCount;
-	base::flat_set<MsgId> _unreadMentions;
+	base::flat_vector_set<MsgId> _unreadMentions;
 	std::optional<HistoryItem*> _lastMessage;
 
 	// This almost always is equal to _lastMessage. The only difference is
@@ -336,10 +336,13 @@ void HistoryGif::draw(Painter &p, const QRect &r, TextSelection selection, crl::
 		}
 	} else {
 		const auto good = _data->goodThumbnail();
-		if (good && good->loaded()) {
-			p.drawPixmap(rthumb.topLeft(), good->pixSingle({}, _thumbw, _thumbh, usew, painth, roundRadius, roundCorners));
+		const auto goodPix = (good && good->loaded())
+			? good->pixSingleAsync({}, _thumbw, _thumbh, usew, painth, roundRadius, roundCorners)
+			: QPixmap();
+		if (!goodPix.isNull()) {
+			p.drawPixmap(QRect(rthumb.topLeft(), QSize(usew, painth)), goodPix);
 		} else {
-			if (good) {
+			if (good && !good->loaded()) {
 				good->load({});
 			}
 			const auto normal = _data->thumbnail();
@@ -849,6 +852,11 @@ void HistoryGif::clipCallback(Media::Clip::Notification notification) {
 			}
 		}
 		if (!stopped) {
+			if (reader->ready() && !reader->started()) {
+				// The first frame is shown while the reader starts again.
+				_data->setGoodThumbnailFrame(
+					reader->frameOriginalImage());
+			}
 			history()->owner().requestViewResize(_parent);
 		}
 	} break;
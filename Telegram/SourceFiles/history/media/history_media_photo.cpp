@@ -199,8 +199,12 @@ void HistoryPhoto::draw(Painter &p, const QRect &r, TextSelection selection, crl
 			| ((isBubbleBottom() && _caption.isEmpty()) ? (RectPart::BottomLeft | RectPart::BottomRight) : RectPart::None));
 		const auto pix = [&] {
 			if (loaded) {
-				return _data->large()->pixSingle(_realParent->fullId(), _pixw, _pixh, paintw, painth, roundRadius, roundCorners);
-			} else if (_data->thumbnail()->loaded()) {
+				auto large = _data->large()->pixSingleAsync(_realParent->fullId(), _pixw, _pixh, paintw, painth, roundRadius, roundCorners);
+				if (!large.isNull()) {
+					return large;
+				}
+			}
+			if (_data->thumbnail()->loaded()) {
 				return _data->thumbnail()->pixBlurredSingle(_realParent->fullId(), _pixw, _pixh, paintw, painth, roundRadius, roundCorners);
 			} else if (_data->thumbnailSmall()->loaded()) {
 				return _data->thumbnailSmall()->pixBlurredSingle(_realParent->fullId(), _pixw, _pixh, paintw, painth, roundRadius, roundCorners);
@@ -210,7 +214,7 @@ void HistoryPhoto::draw(Painter &p, const QRect &r, TextSelection selection, crl
 				return QPixmap();
 			}
 		}();
-		p.drawPixmap(rthumb.topLeft(), pix);
+		p.drawPixmap(rthumb, pix);
 		if (selected) {
 			App::complexOverlayRect(p, rthumb, roundRadius, roundCorners);
 		}
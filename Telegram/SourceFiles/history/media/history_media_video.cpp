@@ -189,10 +189,13 @@ void HistoryVideo::draw(Painter &p, const QRect &r, TextSelection selection, crl
 	QRect rthumb(rtlrect(paintx, painty, paintw, painth, width()));
 
 	const auto good = _data->goodThumbnail();
-	if (good && good->loaded()) {
-		p.drawPixmap(rthumb.topLeft(), good->pixSingle({}, _thumbw, _thumbh, paintw, painth, roundRadius, roundCorners));
+	const auto goodPix = (good && good->loaded())
+		? good->pixSingleAsync({}, _thumbw, _thumbh, paintw, painth, roundRadius, roundCorners)
+		: QPixmap();
+	if (!goodPix.isNull()) {
+		p.drawPixmap(QRect(rthumb.topLeft(), QSize(paintw, painth)), goodPix);
 	} else {
-		if (good) {
+		if (good && !good->loaded()) {
 			good->load({});
 		}
 		const auto normal = _data->thumbnail();
@@ -25,6 +25,9 @@ namespace {
 // A new message from the same sender is attached to previous within 15 minutes.
 constexpr int kAttachMessageToPreviousSecondsDelta = 900;
 
+// Don't start worker threads for less texts than that for each thread.
+constexpr auto kTextLayoutsPerThread = 128;
+
 bool IsAttachedToPreviousInSavedMessages(
 		not_null<HistoryItem*> previous,
 		not_null<HistoryItem*> item) {
@@ -46,6 +49,36 @@ bool IsAttachedToPreviousInSavedMessages(
 
 } // namespace
 
+void PrepareTextLayouts(std::vector<TextLayoutRequest> &&requests) {
+	const auto count = int(requests.size());
+	const auto threads = std::min(
+		QThread::idealThreadCount(),
+		count / kTextLayoutsPerThread);
+	if (threads < 2) {
+		return;
+	}
+	const auto chunk = (count + threads - 1) / threads;
+	const auto layout = [&](int from) {
+		const auto till = std::min(from + chunk, count);
+		for (auto i = from; i != till; ++i) {
+			const auto &request = requests[i];
+			request.text->countHeight(request.width);
+		}
+	};
+	auto semaphore = crl::semaphore();
+	auto left = std::atomic<int>((count - 1) / chunk);
+	for (auto from = chunk; from < count; from += chunk) {
+		crl::async([&, from] {
+			layout(from);
+			if (--left == 0) {
+				semaphore.release();
+			}
+		});
+	}
+	layout(0);
+	semaphore.acquire();
+}
+
 TextSelection UnshiftItemSelection(
 		TextSelection selection,
 		uint16 byLength) {
@@ -524,6 +557,10 @@ bool Element::hasVisibleText() const {
 	return false;
 }
 
+TextLayoutRequest Element::textLayoutRequest(int newWidth) const {
+	return {};
+}
+
 HistoryBlock *Element::block() {
 	return _block;
 }
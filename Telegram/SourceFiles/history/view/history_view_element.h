@@ -31,6 +31,16 @@ enum class Context : char {
 	ContactPreview
 };
 
+// Text that Element::resizeGetHeight() will lay out for the given width.
+struct TextLayoutRequest {
+	const Text *text = nullptr;
+	int width = 0;
+};
+
+// Lays out the texts on the worker threads, so that the following
+// resizeGetHeight() calls find the line layouts already cached.
+void PrepareTextLayouts(std::vector<TextLayoutRequest> &&requests);
+
 class Element;
 class ElementDelegate {
 public:
@@ -231,6 +241,10 @@ public:
 	virtual TimeId displayedEditDate() const;
 	virtual bool hasVisibleText() const;
 
+	// Returns the text that resizeGetHeight(newWidth) is going to lay out
+	// if it is known without resizing anything, see PrepareTextLayouts().
+	virtual TextLayoutRequest textLayoutRequest(int newWidth) const;
+
 	// Legacy blocks structure.
 	HistoryBlock *block();
 	const HistoryBlock *block() const;
@@ -1175,6 +1175,19 @@ int ListWidget::resizeGetHeight(int newWidth) {
 	update();
 
 	const auto resizeAllItems = (_itemsWidth != newWidth);
+	if (resizeAllItems) {
+		auto requests = std::vector<TextLayoutRequest>();
+		for (const auto &view : _items) {
+			if (view->pendingResize()) {
+				continue;
+			}
+			const auto request = view->textLayoutRequest(newWidth);
+			if (request.text) {
+				requests.push_back(request);
+			}
+		}
+		PrepareTextLayouts(std::move(requests));
+	}
 	auto newHeight = 0;
 	for (auto &view : _items) {
 		view->setY(newHeight);
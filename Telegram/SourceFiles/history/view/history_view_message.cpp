@@ -1750,6 +1750,34 @@ bool Message::hasVisibleText() const {
 	return !media || !media->hideMessageText();
 }
 
+TextLayoutRequest Message::textLayoutRequest(int newWidth) const {
+	const auto media = this->media();
+	if (isHidden()
+		|| newWidth < st::msgMinWidth
+		|| (media && media->isDisplayed())
+		|| !drawBubble()
+		|| !hasVisibleText()) {
+		return {};
+	}
+
+	// This code duplicates resizeContentGetHeight() for text messages.
+	auto contentWidth = newWidth - (st::msgMargin.left() + st::msgMargin.right());
+	if (hasFromPhoto() && displayRightAction()) {
+		contentWidth -= st::msgPhotoSkip;
+	}
+	accumulate_min(contentWidth, maxWidth());
+	accumulate_min(contentWidth, st::msgMaxWidth);
+	if (contentWidth == maxWidth()) {
+		return {};
+	}
+	const auto item = message();
+	const auto textWidth = qMax(contentWidth - st::msgPadding.left() - st::msgPadding.right(), 1);
+	if (textWidth == item->_textWidth) {
+		return {};
+	}
+	return { &item->_text, textWidth };
+}
+
 QSize Message::performCountCurrentSize(int newWidth) {
 	const auto item = message();
 	const auto newHeight = resizeContentGetHeight(newWidth);
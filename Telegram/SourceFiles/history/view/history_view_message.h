@@ -135,6 +135,7 @@ private:
 	QSize performCountOptimalSize() override;
 	QSize performCountCurrentSize(int newWidth) override;
 	bool hasVisibleText() const override;
+	TextLayoutRequest textLayoutRequest(int newWidth) const override;
 
 	bool displayFastShare() const;
 	bool displayGoToOriginal() const;
@@ -913,6 +913,10 @@ void MainWidget::removeDialog(Dialogs::Key key) {
 	_dialogs->removeDialog(key);
 }
 
+void MainWidget::sortDialogsByPos() {
+	_dialogs->sortDialogsByPos();
+}
+
 bool MainWidget::sendMessageFail(const RPCError &error) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
@@ -2974,6 +2978,8 @@ void MainWidget::gotChannelDifference(
 
 void MainWidget::feedChannelDifference(
 		const MTPDupdates_channelDifference &data) {
+	const auto started = crl::now();
+	session().data().startUpdatesBatch();
 	session().data().processUsers(data.vusers);
 	session().data().processChats(data.vchats);
 
@@ -2982,6 +2988,13 @@ void MainWidget::feedChannelDifference(
 	App::feedMsgs(data.vnew_messages, NewMessageUnread);
 	feedUpdateVector(data.vother_updates, true);
 	_handlingChannelDifference = false;
+	session().data().finishUpdatesBatch();
+
+	DEBUG_LOG(("Updates Info: channel difference with %1 messages "
+		"and %2 updates applied in %3 ms."
+		).arg(data.vnew_messages.v.size()
+		).arg(data.vother_updates.v.size()
+		).arg(crl::now() - started));
 }
 
 bool MainWidget::failChannelDifference(ChannelData *channel, const RPCError &error) {
@@ -3122,12 +3135,21 @@ void MainWidget::feedDifference(
 		const MTPVector<MTPChat> &chats,
 		const MTPVector<MTPMessage> &msgs,
 		const MTPVector<MTPUpdate> &other) {
+	const auto started = crl::now();
 	session().checkAutoLock();
+	session().data().startUpdatesBatch();
 	session().data().processUsers(users);
 	session().data().processChats(chats);
 	feedMessageIds(other);
 	App::feedMsgs(msgs, NewMessageUnread);
 	feedUpdateVector(other, true);
+	session().data().finishUpdatesBatch();
+
+	DEBUG_LOG(("Updates Info: difference with %1 messages "
+		"and %2 updates applied in %3 ms."
+		).arg(msgs.v.size()
+		).arg(other.v.size()
+		).arg(crl::now() - started));
 }
 
 bool MainWidget::failDifference(const RPCError &error) {
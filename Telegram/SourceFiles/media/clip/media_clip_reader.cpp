@@ -27,6 +27,14 @@ namespace {
 QVector<QThread*> threads;
 QVector<Manager*> managers;
 
+int ThreadsCount() {
+	static const auto result = std::clamp(
+		QThread::idealThreadCount(),
+		1,
+		int(ClipThreadsCount));
+	return result;
+}
+
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
 	auto needOuterFill = (request.outerw != request.framew) || (request.outerh != request.frameh);
@@ -98,21 +106,21 @@ Reader::Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&cal
 }
 
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	// Paused readers are not counted in the load level, so a manager
+	// carrying only offscreen GIFs is as good as a new thread.
+	auto loadLevel = std::numeric_limits<int32>::max();
+	for (auto i = 0, l = int(managers.size()); i != l; ++i) {
+		const auto level = managers[i]->loadLevel();
+		if (level < loadLevel) {
+			_threadIndex = i;
+			loadLevel = level;
+		}
+	}
+	if (loadLevel > 0 && threads.size() < ThreadsCount()) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
 		threads.back()->start();
-	} else {
-		_threadIndex = int32(rand_value<uint32>() % threads.size());
-		int32 loadLevel = 0x7FFFFFFF;
-		for (int32 i = 0, l = threads.size(); i < l; ++i) {
-			int32 level = managers.at(i)->loadLevel();
-			if (level < loadLevel) {
-				_threadIndex = i;
-				loadLevel = level;
-			}
-		}
 	}
 	managers.at(_threadIndex)->append(this, location, data);
 }
@@ -597,6 +605,15 @@ private:
 
 };
 
+// Area of the frames the reader decodes, zero while it is paused.
+int32 Manager::activeLoad(ReaderPrivate *reader) {
+	return reader->_autoPausedGif
+		? 0
+		: (reader->_width > 0)
+		? (reader->_width * reader->_height)
+		: int32(AverageGifSize);
+}
+
 Manager::Manager(QThread *thread) : _processingInThread(0), _needReProcess(false) {
 	moveToThread(thread);
 	connect(thread, SIGNAL(started()), this, SLOT(process()));
@@ -691,6 +708,7 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 		Assert(previous != nullptr && showing != nullptr && ishowing >= 0 && iprevious >= 0);
 		if (reader->_frames[ishowing].when > 0 && showing->displayed.loadAcquire() <= 0) { // current frame was not shown
 			if (reader->_frames[ishowing].when + WaitBeforeGifPause < ms || (reader->_frames[iprevious].when && previous->displayed.loadAcquire() <= 0)) {
+				_loadLevel.fetchAndAddRelaxed(-activeLoad(reader));
 				reader->_autoPausedGif = true;
 				it.key()->_autoPausedGif.storeRelease(1);
 				result = ProcessResult::Paused;
@@ -722,7 +740,7 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 
 Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessResult result, crl::time ms) {
 	if (!handleProcessResult(reader, result, ms)) {
-		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+		_loadLevel.fetchAndAddRelaxed(-activeLoad(reader));
 		delete reader;
 		return ResultHandleRemove;
 	}
@@ -776,6 +794,7 @@ void Manager::process() {
 					i.value() = ms;
 					if (i.key()->_autoPausedGif && !it.key()->_autoPausedGif.loadAcquire()) {
 						i.key()->_autoPausedGif = false;
+						_loadLevel.fetchAndAddRelaxed(activeLoad(i.key()));
 					}
 					if (it.key()->_videoPauseRequest.loadAcquire()) {
 						i.key()->pauseVideo(ms);
@@ -803,7 +822,10 @@ void Manager::process() {
 				return;
 			}
 			ms = crl::now();
-			if (reader->_videoPausedAtMs) {
+
+			// Offscreen GIFs are parked until they're painted again,
+			// so each pass handles only the readers that are visible.
+			if (reader->_videoPausedAtMs || reader->_autoPausedGif) {
 				i.value() = ms + 86400 * 1000ULL;
 			} else if (reader->_nextFrameWhen && reader->_started) {
 				i.value() = reader->_nextFrameWhen;
@@ -814,7 +836,7 @@ void Manager::process() {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it == _readerPointers.cend()) {
-				_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+				_loadLevel.fetchAndAddRelaxed(-activeLoad(reader));
 				delete reader;
 				i = _readers.erase(i);
 				continue;
@@ -78,6 +78,15 @@ public:
 		}
 		return QPixmap();
 	}
+
+	// Shares the data with the frame, the reader detaches it when it
+	// renders the next frame into the same storage.
+	QImage frameOriginalImage() const {
+		if (const auto frame = frameToShow()) {
+			return frame->original;
+		}
+		return QImage();
+	}
 	bool currentDisplayed() const {
 		auto frame = frameToShow();
 		return frame ? (frame->displayed.loadAcquire() != 0) : true;
@@ -210,6 +219,9 @@ private:
 
 	void clear();
 
+	static int32 activeLoad(ReaderPrivate *reader);
+
+	// Only readers that are not paused contribute to the load level.
 	QAtomicInt _loadLevel;
 	using ReaderPointers = QMap<Reader*, QAtomicInt>;
 	ReaderPointers _readerPointers;
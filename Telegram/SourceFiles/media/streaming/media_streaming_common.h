@@ -55,6 +55,13 @@ struct VideoInformation {
 	int rotation = 0;
 };
 
+struct VideoStatistics {
+	int decodingThreads = 0;
+	int decodedFrames = 0;
+	int droppedFrames = 0;
+	int64 decodeMicroseconds = 0;
+};
+
 struct AudioInformation {
 	TrackState state;
 };
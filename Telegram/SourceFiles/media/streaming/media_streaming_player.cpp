@@ -762,6 +762,10 @@ QImage Player::frame(const FrameRequest &request) const {
 	return _video->frame(request);
 }
 
+VideoStatistics Player::videoStatistics() const {
+	return _video ? _video->statistics() : VideoStatistics();
+}
+
 Media::Player::TrackState Player::prepareLegacyState() const {
 	using namespace Media::Player;
 
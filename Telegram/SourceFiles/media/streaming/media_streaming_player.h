@@ -58,6 +58,7 @@ public:
 	[[nodiscard]] rpl::producer<Update, Error> updates() const;
 
 	[[nodiscard]] QImage frame(const FrameRequest &request) const;
+	[[nodiscard]] VideoStatistics videoStatistics() const;
 	//[[nodiscard]] int videoRotation() const;
 
 	[[nodiscard]] Media::Player::TrackState prepareLegacyState() const;
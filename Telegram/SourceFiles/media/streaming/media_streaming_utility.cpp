@@ -23,6 +23,9 @@ constexpr auto kPixelBytesSize = 4;
 constexpr auto kImageFormat = QImage::Format_ARGB32_Premultiplied;
 constexpr auto kAvioBlockSize = 4096;
 constexpr auto kMaxScaleByAspectRatio = 16;
+constexpr auto kFramePoolMaxCount = 8;
+constexpr auto kFramePoolMaxBytes = 64 * 1024 * 1024;
+constexpr auto kMaxThreadsPerCodec = 16;
 
 void AlignedImageBufferCleanupHandler(void* data) {
 	const auto buffer = static_cast<uchar*>(data);
@@ -41,18 +44,8 @@ void AlignedImageBufferCleanupHandler(void* data) {
 		&& (aspect.den <= aspect.num * kMaxScaleByAspectRatio);
 }
 
-} // namespace
-
-bool GoodStorageForFrame(const QImage &storage, QSize size) {
-	return !storage.isNull()
-		&& (storage.format() == kImageFormat)
-		&& (storage.size() == size)
-		&& storage.isDetached()
-		&& IsAlignedImage(storage);
-}
-
 // Create a QImage of desired size where all the data is properly aligned.
-QImage CreateFrameStorage(QSize size) {
+[[nodiscard]] QImage AllocateFrameStorage(QSize size) {
 	const auto width = size.width();
 	const auto height = size.height();
 	const auto widthAlign = kAlignImageBy / kPixelBytesSize;
@@ -76,6 +69,141 @@ QImage CreateFrameStorage(QSize size) {
 		cleanupData);
 }
 
+// Frame storages are large and all tracks have them in the same format,
+// so instead of freeing them they're kept here for a while.
+class FramePool {
+public:
+	[[nodiscard]] QImage take(QSize size);
+	void put(QImage &&storage);
+
+private:
+	QMutex _mutex;
+	std::deque<QImage> _storages;
+	int64 _bytes = 0;
+
+};
+
+QImage FramePool::take(QSize size) {
+	QMutexLocker lock(&_mutex);
+	const auto i = ranges::find(
+		_storages,
+		size,
+		[](const QImage &storage) { return storage.size(); });
+	if (i == end(_storages)) {
+		return QImage();
+	}
+	auto result = std::move(*i);
+	_storages.erase(i);
+	_bytes -= result.byteCount();
+	return result;
+}
+
+void FramePool::put(QImage &&storage) {
+	auto image = std::move(storage);
+	if (!GoodStorageForFrame(image, image.size())
+		|| image.byteCount() > kFramePoolMaxBytes) {
+		return;
+	}
+	// Free the memory of removed storages outside of the lock.
+	auto removed = std::deque<QImage>();
+	{
+		QMutexLocker lock(&_mutex);
+		_bytes += image.byteCount();
+		_storages.push_back(std::move(image));
+		while (_storages.size() > kFramePoolMaxCount
+			|| _bytes > kFramePoolMaxBytes) {
+			_bytes -= _storages.front().byteCount();
+			removed.push_back(std::move(_storages.front()));
+			_storages.pop_front();
+		}
+	}
+}
+
+// Streamed video codecs share the cores, so that several playing videos
+// don't start a full set of decoder threads each. Inline GIFs are decoded
+// by the clip readers in one thread each and don't use this budget.
+class DecodingThreads {
+public:
+	[[nodiscard]] int acquire();
+	void release(int count);
+
+private:
+	QMutex _mutex;
+	int _used = 0;
+
+};
+
+int DecodingThreads::acquire() {
+	const auto limit = cDecodingThreads()
+		? cDecodingThreads()
+		: QThread::idealThreadCount();
+
+	QMutexLocker lock(&_mutex);
+
+	// Each next codec gets a half of what is left. When less than two
+	// threads are left it decodes in the calling thread without workers.
+	const auto result = std::min((limit - _used) / 2, kMaxThreadsPerCodec);
+	if (result < 2) {
+		return 0;
+	}
+	_used += result;
+	return result;
+}
+
+void DecodingThreads::release(int count) {
+	QMutexLocker lock(&_mutex);
+	_used -= count;
+}
+
+[[nodiscard]] DecodingThreads &Threads() {
+	static auto result = DecodingThreads();
+	return result;
+}
+
+[[nodiscard]] FramePool &Pool() {
+	static auto result = FramePool();
+	return result;
+}
+
+void CopyFrameStorage(const QImage &from, QImage &to) {
+	Expects(from.size() == to.size());
+	Expects(from.format() == to.format());
+
+	const auto lineSize = from.width() * kPixelBytesSize;
+	const auto fromPerLine = from.bytesPerLine();
+	const auto toPerLine = to.bytesPerLine();
+	auto source = from.constBits();
+	auto destination = to.bits();
+	if (fromPerLine == toPerLine) {
+		memcpy(destination, source, fromPerLine * from.height());
+		return;
+	}
+	for (auto y = 0, height = from.height(); y != height; ++y) {
+		memcpy(destination, source, lineSize);
+		source += fromPerLine;
+		destination += toPerLine;
+	}
+}
+
+} // namespace
+
+bool GoodStorageForFrame(const QImage &storage, QSize size) {
+	return !storage.isNull()
+		&& (storage.format() == kImageFormat)
+		&& (storage.size() == size)
+		&& storage.isDetached()
+		&& IsAlignedImage(storage);
+}
+
+QImage CreateFrameStorage(QSize size) {
+	auto result = Pool().take(size);
+	return result.isNull() ? AllocateFrameStorage(size) : result;
+}
+
+void ReleaseFrameStorage(QImage &&storage) {
+	Pool().put(std::move(storage));
+}
+
 IOPointer MakeIOPointer(
 		void *opaque,
 		int(*read)(void *opaque, uint8_t *buffer, int bufferSize),
@@ -168,6 +296,15 @@ CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
 	}
 	av_codec_set_pkt_timebase(context, stream->time_base);
 	av_opt_set_int(context, "refcounted_frames", 1, 0);
+	if (stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+		// Zero thread_count lets FFmpeg choose, one disables threading.
+		const auto threads = Threads().acquire();
+		result.get_deleter().threads = threads;
+		context->thread_count = std::max(threads, 1);
+		if (threads) {
+			context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+		}
+	}
 
 	const auto codec = avcodec_find_decoder(context->codec_id);
 	if (!codec) {
@@ -184,6 +321,9 @@ void CodecDeleter::operator()(AVCodecContext *value) {
 	if (value) {
 		avcodec_free_context(&value);
 	}
+	if (threads) {
+		Threads().release(base::take(threads));
+	}
 }
 
 FramePointer MakeFramePointer() {
@@ -437,6 +577,7 @@ QImage ConvertFrame(
 	}
 
 	if (!GoodStorageForFrame(storage, resize)) {
+		ReleaseFrameStorage(std::move(storage));
 		storage = CreateFrameStorage(resize);
 	}
 	const auto format = AV_PIX_FMT_BGRA;
@@ -498,16 +639,62 @@ QImage PrepareByRequest(
 	Expects(!request.outer.isEmpty());
 
 	if (!GoodStorageForFrame(storage, request.outer)) {
+		ReleaseFrameStorage(std::move(storage));
 		storage = CreateFrameStorage(request.outer);
 	}
-	{
+	if (original.size() == request.outer
+		&& original.format() == storage.format()) {
+		// Usually the frame was already converted to the requested size,
+		// so only the rounding is left and painting can be skipped.
+		CopyFrameStorage(original, storage);
+	} else {
 		Painter p(&storage);
 		PainterHighQualityEnabler hq(p);
 		p.drawImage(QRect(QPoint(), request.outer), original);
 	}
-	// #TODO streaming later full prepare support.
+	if (request.radius != ImageRoundRadius::None
+		&& (request.corners & RectPart::AllCorners) != 0) {
+		const auto ratio = storage.devicePixelRatio();
+		Images::prepareRound(storage, request.radius, request.corners);
+		storage.setDevicePixelRatio(ratio);
+	}
 	return storage;
 }
 
+void ConversionHistogram::add(Clock::time_point started) {
+	const auto microseconds = std::chrono::duration_cast<
+		std::chrono::microseconds>(Clock::now() - started).count();
+	auto index = 0;
+	for (auto limit = 1000; index + 1 != kBucketsCount; limit *= 2) {
+		if (microseconds < limit) {
+			break;
+		}
+		++index;
+	}
+	++_buckets[index];
+	_totalMicroseconds += microseconds;
+	++_count;
+}
+
+bool ConversionHistogram::empty() const {
+	return !_count;
+}
+
+QString ConversionHistogram::toString() const {
+	const auto average = _count
+		? (_totalMicroseconds / (_count * 1000.))
+		: 0.;
+	auto result = QString("%1 frames, average %2 ms"
+		).arg(_count
+		).arg(average, 0, 'f', 2);
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		const auto limit = (1 << i);
+		result += (i + 1 != kBucketsCount)
+			? QString(", <%1 ms: %2").arg(limit).arg(_buckets[i])
+			: QString(", %1+ ms: %2").arg(limit / 2).arg(_buckets[i]);
+	}
+	return result;
+}
+
 } // namespace Streaming
 } // namespace Media
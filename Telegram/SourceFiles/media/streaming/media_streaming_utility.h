@@ -14,6 +14,8 @@ extern "C" {
 #include <libswscale/swscale.h>
 } // extern "C"
 
+#include <chrono>
+
 namespace Media {
 namespace Streaming {
 
@@ -136,6 +138,8 @@ using FormatPointer = std::unique_ptr<AVFormatContext, FormatDeleter>;
 	int64_t(*seek)(void *opaque, int64_t offset, int whence));
 
 struct CodecDeleter {
+	int threads = 0;
+
 	void operator()(AVCodecContext *value);
 };
 using CodecPointer = std::unique_ptr<AVCodecContext, CodecDeleter>;
@@ -180,6 +184,23 @@ struct Stream {
 	SwscalePointer swscale;
 };
 
+// Frame conversion durations in power-of-two millisecond buckets.
+class ConversionHistogram {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	void add(Clock::time_point started);
+	[[nodiscard]] bool empty() const;
+	[[nodiscard]] QString toString() const;
+
+private:
+	static constexpr auto kBucketsCount = 7;
+	std::array<int, kBucketsCount> _buckets = { { 0 } };
+	int64 _totalMicroseconds = 0;
+	int _count = 0;
+
+};
+
 void LogError(QLatin1String method);
 void LogError(QLatin1String method, AvErrorWrap error);
 
@@ -209,6 +230,11 @@ void LogError(QLatin1String method, AvErrorWrap error);
 	const FrameRequest &request);
 [[nodiscard]] bool GoodStorageForFrame(const QImage &storage, QSize size);
 [[nodiscard]] QImage CreateFrameStorage(QSize size);
+
+// Returns a storage to the pool shared by all video tracks, so that the
+// next track (or the next size change) doesn't allocate a new one.
+void ReleaseFrameStorage(QImage &&storage);
+
 [[nodiscard]] QImage ConvertFrame(
 	Stream &stream,
 	AVFrame *frame,
@@ -32,6 +32,7 @@ public:
 		const AudioMsgId &audioId,
 		FnMut<void(const Information &)> ready,
 		Fn<void(Error)> error);
+	~VideoTrackObject();
 
 	void process(Packet &&packet);
 
@@ -104,6 +105,8 @@ private:
 	// For initial frame skipping for an exact seek.
 	FramePointer _initialSkippingFrame;
 
+	ConversionHistogram _conversionTimes;
+
 };
 
 VideoTrackObject::VideoTrackObject(
@@ -127,6 +130,13 @@ VideoTrackObject::VideoTrackObject(
 	Expects(_error != nullptr);
 }
 
+VideoTrackObject::~VideoTrackObject() {
+	if (!_conversionTimes.empty()) {
+		DEBUG_LOG(("Streaming Info: Video frames conversion, %1."
+			).arg(_conversionTimes.toString()));
+	}
+}
+
 rpl::producer<> VideoTrackObject::checkNextFrame() const {
 	return interrupted()
 		? (rpl::complete<>() | rpl::type_erased())
@@ -232,6 +242,7 @@ auto VideoTrackObject::readEnoughFrames(crl::time trackTime)
 				|| !VideoTrack::IsStale(frame, trackTime)) {
 				return std::nullopt;
 			}
+			_shared->frameDropped();
 		}
 	}, [&](Shared::PrepareNextCheck delay) -> ReadEnoughState {
 		return delay;
@@ -264,6 +275,7 @@ crl::time VideoTrackObject::computeDuration() const {
 }
 
 auto VideoTrackObject::readFrame(not_null<Frame*> frame) -> FrameResult {
+	const auto started = std::chrono::steady_clock::now();
 	if (const auto error = ReadNextFrame(_stream)) {
 		if (error.code() == AVERROR_EOF) {
 			if (!_options.loop) {
@@ -289,6 +301,9 @@ auto VideoTrackObject::readFrame(not_null<Frame*> frame) -> FrameResult {
 		fail(Error::InvalidData);
 		return FrameResult::Error;
 	}
+	_shared->frameDecoded(std::chrono::duration_cast<
+		std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - started).count());
 	std::swap(frame->decoded, _stream.frame);
 	frame->position = position;
 	frame->displayed = kTimeUnknown;
@@ -303,6 +318,7 @@ void VideoTrackObject::presentFrameIfNeeded() {
 	const auto rasterize = [&](not_null<Frame*> frame) {
 		Expects(frame->position != kFinishedPosition);
 
+		const auto started = ConversionHistogram::Clock::now();
 		frame->request = _request;
 		frame->original = ConvertFrame(
 			_stream,
@@ -316,6 +332,7 @@ void VideoTrackObject::presentFrameIfNeeded() {
 		}
 
 		VideoTrack::PrepareFrameByRequest(frame);
+		_conversionTimes.add(started);
 
 		Ensures(VideoTrack::IsRasterized(frame));
 	};
@@ -516,6 +533,13 @@ void VideoTrackObject::fail(Error error) {
 	_error(error);
 }
 
+VideoTrack::Shared::~Shared() {
+	for (auto &frame : _frames) {
+		ReleaseFrameStorage(std::move(frame.original));
+		ReleaseFrameStorage(std::move(frame.prepared));
+	}
+}
+
 void VideoTrack::Shared::init(QImage &&cover, crl::time position) {
 	Expects(!initialized());
 
@@ -569,6 +593,7 @@ auto VideoTrack::Shared::prepareState(
 		} else if (IsStale(frame, trackTime)) {
 			std::swap(*frame, *next);
 			next->displayed = kDisplaySkipped;
+			frameDropped();
 			return next;
 		} else {
 			return PrepareNextCheck(frame->position - trackTime + 1);
@@ -722,6 +747,27 @@ not_null<VideoTrack::Frame*> VideoTrack::Shared::frameForPaint() {
 	return result;
 }
 
+void VideoTrack::Shared::frameDecoded(int64 microseconds) {
+	_decodedFrames.fetch_add(1, std::memory_order_relaxed);
+	_decodeMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+}
+
+void VideoTrack::Shared::frameDropped() {
+	_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+int VideoTrack::Shared::decodedFrames() const {
+	return _decodedFrames.load(std::memory_order_relaxed);
+}
+
+int VideoTrack::Shared::droppedFrames() const {
+	return _droppedFrames.load(std::memory_order_relaxed);
+}
+
+int64 VideoTrack::Shared::decodeMicroseconds() const {
+	return _decodeMicroseconds.load(std::memory_order_relaxed);
+}
+
 VideoTrack::VideoTrack(
 	const PlaybackOptions &options,
 	Stream &&stream,
@@ -731,6 +777,7 @@ VideoTrack::VideoTrack(
 : _streamIndex(stream.index)
 , _streamTimeBase(stream.timeBase)
 , _streamDuration(stream.duration)
+, _streamDecodingThreads(stream.codec ? stream.codec->thread_count : 0)
 //, _streamRotation(stream.rotation)
 //, _streamAspect(stream.aspect)
 , _shared(std::make_unique<Shared>())
@@ -854,6 +901,15 @@ rpl::producer<> VideoTrack::waitingForData() const {
 	});
 }
 
+VideoStatistics VideoTrack::statistics() const {
+	auto result = VideoStatistics();
+	result.decodingThreads = _streamDecodingThreads;
+	result.decodedFrames = _shared->decodedFrames();
+	result.droppedFrames = _shared->droppedFrames();
+	result.decodeMicroseconds = _shared->decodeMicroseconds();
+	return result;
+}
+
 VideoTrack::~VideoTrack() {
 	_wrapped.with([shared = std::move(_shared)](Implementation &unwrapped) {
 		unwrapped.interrupt();
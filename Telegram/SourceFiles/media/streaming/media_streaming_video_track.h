@@ -51,6 +51,9 @@ public:
 	[[nodiscard]] rpl::producer<> checkNextFrame() const;
 	[[nodiscard]] rpl::producer<> waitingForData() const;
 
+	// Thread-safe.
+	[[nodiscard]] VideoStatistics statistics() const;
+
 	// Called from the main thread.
 	~VideoTrack();
 
@@ -80,6 +83,9 @@ private:
 			crl::time nextCheckDelay = 0;
 		};
 
+		// Frame storages are returned to the shared pool.
+		~Shared();
+
 		// Called from the wrapped object queue.
 		void init(QImage &&cover, crl::time position);
 		[[nodiscard]] bool initialized() const;
@@ -103,6 +109,15 @@ private:
 		[[nodiscard]] crl::time nextFrameDisplayTime() const;
 		[[nodiscard]] not_null<Frame*> frameForPaint();
 
+		// Called from the wrapped object queue.
+		void frameDecoded(int64 microseconds);
+		void frameDropped();
+
+		// Thread-safe.
+		[[nodiscard]] int decodedFrames() const;
+		[[nodiscard]] int droppedFrames() const;
+		[[nodiscard]] int64 decodeMicroseconds() const;
+
 	private:
 		[[nodiscard]] not_null<Frame*> getFrame(int index);
 		[[nodiscard]] not_null<const Frame*> getFrame(int index) const;
@@ -114,6 +129,10 @@ private:
 		static constexpr auto kFramesCount = 4;
 		std::array<Frame, kFramesCount> _frames;
 
+		std::atomic<int> _decodedFrames = 0;
+		std::atomic<int> _droppedFrames = 0;
+		std::atomic<int64> _decodeMicroseconds = 0;
+
 	};
 
 	static QImage PrepareFrameByRequest(
@@ -128,6 +147,7 @@ private:
 	const int _streamIndex = 0;
 	const AVRational _streamTimeBase;
 	const crl::time _streamDuration = 0;
+	const int _streamDecodingThreads = 0;
 	//const int _streamRotation = 0;
 	//AVRational _streamAspect = kNormalAspect;
 	std::unique_ptr<Shared> _shared;
@@ -11,7 +11,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "mtproto/rpc_sender.h"
 #include "mtproto/dc_options.h"
 #include "mtproto/connection_abstract.h"
-#include "zlib.h"
+#include "mtproto/gzip_packed.h"
 #include "core/application.h"
 #include "core/launcher.h"
 #include "lang/lang_keys.h"
@@ -422,6 +422,7 @@ ConnectionPrivate::ConnectionPrivate(
 , _waitForBetterTimer(thread, [=] { waitBetterFailed(); })
 , _waitForReceived(kMinReceiveTimeout)
 , _waitForConnected(kMinConnectedTimeout)
+, _gzipRatio(kInitialGzipRatio)
 , _pingSender(thread, [=] { sendPingByTimer(); })
 , sessionData(data) {
 	Expects(_shiftedDcId != 0);
@@ -620,10 +621,7 @@ void ConnectionPrivate::resetSession() { // recreate all msg_id and msg_seqno
 
 	ackRequestData.clear();
 	resendRequestData.clear();
-	{
-		QWriteLocker locker5(sessionData->stateRequestMutex());
-		sessionData->stateRequestMap().clear();
-	}
+	sessionData->takeStateRequests();
 
 	emit sessionResetDone();
 }
@@ -790,15 +788,11 @@ void ConnectionPrivate::tryToSend() {
 	if (!prependOnly) {
 		QVector<MTPlong> stateReq;
 		{
-			QWriteLocker locker(sessionData->stateRequestMutex());
-			auto &ids = sessionData->stateRequestMap();
-			if (!ids.isEmpty()) {
-				stateReq.reserve(ids.size());
-				for (auto i = ids.cbegin(), e = ids.cend(); i != e; ++i) {
-					stateReq.push_back(MTP_long(i.key()));
-				}
+			const auto ids = sessionData->takeStateRequests();
+			stateReq.reserve(ids.size());
+			for (const auto msgId : ids) {
+				stateReq.push_back(MTP_long(msgId));
 			}
-			ids.clear();
 		}
 		if (!stateReq.isEmpty()) {
 			stateRequest = SecureRequest::Serialize(MTPMsgsStateReq(
@@ -1569,16 +1563,8 @@ void ConnectionPrivate::handleReceived() {
 			emit sendAnythingAsync(kAckSendWaiting);
 		}
 
-		bool emitSignal = false;
-		{
-			QReadLocker locker(sessionData->haveReceivedMutex());
-			emitSignal = !sessionData->haveReceivedResponses().isEmpty() || !sessionData->haveReceivedUpdates().isEmpty();
-			if (emitSignal) {
-				DEBUG_LOG(("MTP Info: emitting needToReceive() - need to parse in another thread, %1 responses, %2 updates.").arg(sessionData->haveReceivedResponses().size()).arg(sessionData->haveReceivedUpdates().size()));
-			}
-		}
-
-		if (emitSignal) {
+		if (const auto pending = sessionData->receivedPendingCount()) {
+			DEBUG_LOG(("MTP Info: emitting needToReceive() - need to parse in another thread, %1 messages.").arg(pending));
 			emit needToReceive();
 		}
 
@@ -2065,8 +2051,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		auto requestId = wasSent(reqMsgId.v);
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
 			// Save rpc_result for processing in the main thread.
-			QWriteLocker locker(sessionData->haveReceivedMutex());
-			sessionData->haveReceivedResponses().insert(requestId, response);
+			sessionData->pushReceivedResponse(requestId, std::move(response));
 		} else {
 			DEBUG_LOG(("RPC Info: requestId not found for msgId %1").arg(reqMsgId.v));
 		}
@@ -2107,8 +2092,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		if (from > start) memcpy(update.data(), start, (from - start) * sizeof(mtpPrime));
 
 		// Notify main process about new session - need to get difference.
-		QWriteLocker locker(sessionData->haveReceivedMutex());
-		sessionData->haveReceivedUpdates().push_back(SerializedMessage(update));
+		sessionData->pushReceivedUpdate(std::move(update));
 	} return HandleResult::Success;
 
 	case mtpc_ping: {
@@ -2164,8 +2148,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		if (end > from) memcpy(update.data(), from, (end - from) * sizeof(mtpPrime));
 
 		// Notify main process about the new updates.
-		QWriteLocker locker(sessionData->haveReceivedMutex());
-		sessionData->haveReceivedUpdates().push_back(SerializedMessage(update));
+		sessionData->pushReceivedUpdate(std::move(update));
 
 		if (cons != mtpc_updatesTooLong
 			&& cons != mtpc_updateShortMessage
@@ -2184,52 +2167,29 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 	return HandleResult::Success;
 }
 
-mtpBuffer ConnectionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) const {
-	MTPstring packed;
-	packed.read(from, end); // read packed string as serialized mtp string type
-	uint32 packedLen = packed.v.size(), unpackedChunk = packedLen, unpackedLen = 0;
-
-	mtpBuffer result; // * 4 because of mtpPrime type
-	result.resize(0);
-	z_stream stream;
-	stream.zalloc = 0;
-	stream.zfree = 0;
-	stream.opaque = 0;
-	stream.avail_in = 0;
-	stream.next_in = 0;
-	int res = inflateInit2(&stream, 16 + MAX_WBITS);
-	if (res != Z_OK) {
-		LOG(("RPC Error: could not init zlib stream, code: %1").arg(res));
-		return result;
-	}
-	stream.avail_in = packedLen;
-	stream.next_in = reinterpret_cast<Bytef*>(packed.v.data());
-
-	stream.avail_out = 0;
-	while (!stream.avail_out) {
-		result.resize(result.size() + unpackedChunk);
-		stream.avail_out = unpackedChunk * sizeof(mtpPrime);
-		stream.next_out = (Bytef*)&result[result.size() - unpackedChunk];
-		int res = inflate(&stream, Z_NO_FLUSH);
-		if (res != Z_OK && res != Z_STREAM_END) {
-			inflateEnd(&stream);
-			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(res));
-			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.v.constData(), packedLen).str()));
-			return mtpBuffer();
-		}
-	}
-	if (stream.avail_out & 0x03) {
-		uint32 badSize = result.size() * sizeof(mtpPrime) - stream.avail_out;
-		LOG(("RPC Error: bad length of unpacked data %1").arg(badSize));
-		DEBUG_LOG(("RPC Error: bad unpacked data %1").arg(Logs::mb(result.data(), badSize).str()));
-		return mtpBuffer();
-	}
-	result.resize(result.size() - (stream.avail_out >> 2));
-	inflateEnd(&stream);
-	if (!result.size()) {
-		LOG(("RPC Error: bad length of unpacked data 0"));
-	}
-	return result;
+mtpBuffer ConnectionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) {
+	auto result = UngzipPacked(from, end, _gzipRatio);
+	switch (result.error) {
+	case UngzipError::None: return std::move(result.data);
+	case UngzipError::Insufficient: throw mtpErrorInsufficient();
+	case UngzipError::Init:
+		LOG(("RPC Error: could not init zlib stream, code: %1").arg(result.value));
+		break;
+	case UngzipError::Unpack:
+		LOG(("RPC Error: could not unpack gziped data, code: %1").arg(result.value));
+		DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(from, uint32(end - from) * sizeof(mtpPrime)).str()));
+		break;
+	case UngzipError::TooLarge:
+		LOG(("RPC Error: too large unpacked data"));
+		break;
+	case UngzipError::BadLength:
+		LOG(("RPC Error: bad length of unpacked data %1").arg(result.value));
+		if (result.value > 0) {
+			DEBUG_LOG(("RPC Error: bad unpacked data %1").arg(Logs::mb(result.data.constData(), uint32(result.value)).str()));
+		}
+		break;
+	}
+	return mtpBuffer();
 }
 
 bool ConnectionPrivate::requestsFixTimeSalt(const QVector<MTPlong> &ids, int32 serverTime, uint64 serverSalt) {
@@ -195,7 +195,7 @@ private:
 		ResetSession,
 	};
 	HandleResult handleOneReceived(const mtpPrime *from, const mtpPrime *end, uint64 msgId, int32 serverTime, uint64 serverSalt, bool badTime);
-	mtpBuffer ungzip(const mtpPrime *from, const mtpPrime *end) const;
+	mtpBuffer ungzip(const mtpPrime *from, const mtpPrime *end);
 	void handleMsgsStates(const QVector<MTPlong> &ids, const QByteArray &states, QVector<MTPlong> &acked);
 
 	void clearMessages();
@@ -256,6 +256,8 @@ private:
 
 	QVector<MTPlong> ackRequestData, resendRequestData;
 
+	double _gzipRatio = 0.;
+
 	mtpPingId _pingId = 0;
 	mtpPingId _pingIdToSend = 0;
 	crl::time _pingSendAt = 0;
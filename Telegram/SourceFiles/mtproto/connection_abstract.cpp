@@ -13,6 +13,29 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 
 namespace MTP {
 namespace internal {
+namespace {
+
+// Don't keep huge buffers (like file parts) alive between sends.
+constexpr auto kMaxReusedPacketInts = 64 * 1024;
+
+thread_local mtpBuffer ReusedPacketBuffer;
+
+} // namespace
+
+mtpBuffer AcquirePacketBuffer(int reserveInts) {
+	auto result = base::take(ReusedPacketBuffer);
+	result.resize(0);
+	result.reserve(reserveInts);
+	return result;
+}
+
+void ReleasePacketBuffer(mtpBuffer &&buffer) {
+	if (buffer.capacity() <= kMaxReusedPacketInts
+		&& buffer.capacity() > ReusedPacketBuffer.capacity()
+		&& buffer.isDetached()) {
+		ReusedPacketBuffer = std::move(buffer);
+	}
+}
 
 ConnectionPointer::ConnectionPointer() = default;
 
@@ -78,7 +101,6 @@ mtpBuffer AbstractConnection::prepareSecurePacket(
 		uint64 keyId,
 		MTPint128 msgKey,
 		uint32 size) const {
-	auto result = mtpBuffer();
 	constexpr auto kTcpPrefixInts = 2;
 	constexpr auto kAuthKeyIdPosition = kTcpPrefixInts;
 	constexpr auto kAuthKeyIdInts = 2;
@@ -89,7 +111,7 @@ mtpBuffer AbstractConnection::prepareSecurePacket(
 		+ kAuthKeyIdInts
 		+ kMessageKeyInts;
 	constexpr auto kTcpPostfixInts = 4;
-	result.reserve(kPrefixInts + size + kTcpPostfixInts);
+	auto result = AcquirePacketBuffer(kPrefixInts + size + kTcpPostfixInts);
 	result.resize(kPrefixInts);
 	*reinterpret_cast<uint64*>(&result[kAuthKeyIdPosition]) = keyId;
 	*reinterpret_cast<MTPint128*>(&result[kMessageKeyPosition]) = msgKey;
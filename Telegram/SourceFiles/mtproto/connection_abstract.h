@@ -16,6 +16,11 @@ struct ConnectionOptions;
 
 class AbstractConnection;
 
+// Packet buffers are recycled inside the connection thread: the one that
+// was sent last is reused for the next packet instead of reallocating.
+[[nodiscard]] mtpBuffer AcquirePacketBuffer(int reserveInts);
+void ReleasePacketBuffer(mtpBuffer &&buffer);
+
 class ConnectionPointer {
 public:
 	ConnectionPointer();
@@ -142,7 +147,6 @@ mtpBuffer AbstractConnection::prepareNotSecurePacket(const Request &request) con
 		? uint32(rand_value<uchar>() & 0x3F)
 		: 0;
 
-	auto result = mtpBuffer();
 	constexpr auto kTcpPrefixInts = 2;
 	constexpr auto kAuthKeyIdInts = 2;
 	constexpr auto kMessageIdInts = 2;
@@ -153,7 +157,8 @@ mtpBuffer AbstractConnection::prepareNotSecurePacket(const Request &request) con
 		+ kMessageLengthInts;
 	constexpr auto kTcpPostfixInts = 4;
 
-	result.reserve(kPrefixInts + intsSize + intsPadding + kTcpPostfixInts);
+	auto result = AcquirePacketBuffer(
+		kPrefixInts + intsSize + intsPadding + kTcpPostfixInts);
 	result.resize(kPrefixInts);
 
 	const auto messageId = &result[kTcpPrefixInts + kAuthKeyIdInts];
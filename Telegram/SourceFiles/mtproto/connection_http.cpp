@@ -43,6 +43,7 @@ void HttpConnection::sendData(mtpBuffer &&buffer) {
 
 	TCP_LOG(("HTTP Info: sending %1 len request").arg(requestSize));
 	_requests.insert(_manager.post(request, QByteArray((const char*)(&buffer[2]), requestSize)));
+	ReleasePacketBuffer(std::move(buffer));
 }
 
 void HttpConnection::disconnectFromServer() {
@@ -561,6 +561,7 @@ void TcpConnection::sendBuffer(mtpBuffer &&buffer) {
 	_socket.write(
 		reinterpret_cast<const char*>(bytes.data()),
 		bytes.size());
+	ReleasePacketBuffer(std::move(buffer));
 }
 
 
@@ -11,6 +11,9 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 namespace MTP {
 namespace {
 
+// Enough for any padding added by CountPaddingAmountInInts().
+constexpr auto kMaxPaddingInts = 3 + 4 + (0x0F << 2);
+
 uint32 CountPaddingAmountInInts(uint32 requestSize, bool extended) {
 #ifdef TDESKTOP_MTPROTO_OLD
 	return ((8 + requestSize) & 0x03)
@@ -44,8 +47,10 @@ SecureRequest::SecureRequest(const details::SecureRequestCreateTag &tag)
 SecureRequest SecureRequest::Prepare(uint32 size, uint32 reserveSize) {
 	const auto finalSize = std::max(size, reserveSize);
 
+	// Reserve the padding as well, so that addPadding() before sending
+	// the request won't need to reallocate the buffer.
 	auto result = SecureRequest(details::SecureRequestCreateTag{});
-	result->reserve(kMessageBodyPosition + finalSize);
+	result->reserve(kMessageBodyPosition + finalSize + kMaxPaddingInts);
 	result->resize(kMessageBodyPosition);
 	result->back() = (size << 2);
 	return result;
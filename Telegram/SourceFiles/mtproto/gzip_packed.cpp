@@ -0,0 +1,110 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "mtproto/gzip_packed.h"
+
+#include "zlib.h"
+
+namespace MTP {
+namespace internal {
+namespace {
+
+constexpr auto kIntSize = static_cast<int>(sizeof(mtpPrime));
+constexpr auto kGzipRatioMargin = 0.25;
+
+// gzip_packed responses were always unpacked while QVector could hold
+// them, so they are not limited by the message length, only by that size.
+constexpr auto kMaxUnpackedInts = (std::numeric_limits<int>::max() - 64)
+	/ kIntSize;
+
+UngzipResult Failed(UngzipError error, int64 value = 0) {
+	auto result = UngzipResult();
+	result.error = error;
+	result.value = value;
+	return result;
+}
+
+} // namespace
+
+UngzipResult UngzipPacked(
+		const mtpPrime *from,
+		const mtpPrime *end,
+		double &ratio) {
+	// Read the packed bytes header in place, without copying the payload.
+	if (from + 1 > end) {
+		return Failed(UngzipError::Insufficient);
+	}
+	const auto buffer = reinterpret_cast<const uchar*>(from);
+	const auto longLength = (buffer[0] == 254);
+	const auto packedLen = longLength
+		? (uint32(buffer[1])
+			| (uint32(buffer[2]) << 8)
+			| (uint32(buffer[3]) << 16))
+		: uint32(buffer[0]);
+	const auto headerLen = (longLength ? 4 : 1);
+	const auto packed = buffer + headerLen;
+	if (from + ((packedLen + headerLen + 3) >> 2) > end) {
+		return Failed(UngzipError::Insufficient);
+	}
+
+	z_stream stream;
+	stream.zalloc = nullptr;
+	stream.zfree = nullptr;
+	stream.opaque = nullptr;
+	stream.avail_in = 0;
+	stream.next_in = nullptr;
+	auto res = inflateInit2(&stream, 16 + MAX_WBITS);
+	if (res != Z_OK) {
+		return Failed(UngzipError::Init, res);
+	}
+	stream.avail_in = packedLen;
+	stream.next_in = const_cast<Bytef*>(packed);
+
+	// Guess the unpacked size from the ratio of the previous responses,
+	// so that usually the whole result is inflated without reallocations.
+	const auto guessRatio = ratio + kGzipRatioMargin;
+	const auto guessed = int64(packedLen * guessRatio) / kIntSize + 1;
+	auto result = UngzipResult();
+	auto &data = result.data;
+	data.resize(std::min(guessed, int64(kMaxUnpackedInts)));
+	auto unpackedLen = 0;
+	while (true) {
+		stream.avail_out = (data.size() - unpackedLen) * sizeof(mtpPrime);
+		stream.next_out = reinterpret_cast<Bytef*>(data.data() + unpackedLen);
+		res = inflate(&stream, Z_NO_FLUSH);
+		unpackedLen = data.size() - (stream.avail_out / sizeof(mtpPrime));
+		if (res == Z_STREAM_END) {
+			break;
+		} else if ((res != Z_OK && res != Z_BUF_ERROR) || stream.avail_out) {
+			inflateEnd(&stream);
+			return Failed(UngzipError::Unpack, res);
+		} else if (data.size() >= kMaxUnpackedInts) {
+			inflateEnd(&stream);
+			return Failed(UngzipError::TooLarge);
+		}
+		data.resize(std::min(
+			int64(data.size()) * 2,
+			int64(kMaxUnpackedInts)));
+	}
+	inflateEnd(&stream);
+	if (stream.avail_out & 0x03) {
+		// The unpacked bytes are kept in the result to be logged.
+		result.error = UngzipError::BadLength;
+		result.value = int64(data.size()) * kIntSize - stream.avail_out;
+		return result;
+	}
+	data.resize(unpackedLen);
+	if (data.isEmpty()) {
+		return Failed(UngzipError::BadLength);
+	} else if (packedLen > 0) {
+		const auto measured = (double(unpackedLen) * kIntSize) / packedLen;
+		ratio = (ratio * 3 + measured) / 4;
+	}
+	return result;
+}
+
+} // namespace internal
+} // namespace MTP
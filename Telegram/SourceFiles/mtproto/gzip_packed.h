@@ -0,0 +1,44 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+namespace MTP {
+namespace internal {
+
+// Unpacked / packed size of gzip_packed payloads before any is received.
+constexpr auto kInitialGzipRatio = 4.;
+
+enum class UngzipError {
+	None,
+	Insufficient,
+	Init,
+	Unpack,
+	TooLarge,
+	BadLength,
+};
+
+struct UngzipResult {
+	mtpBuffer data;
+	UngzipError error = UngzipError::None;
+
+	// zlib result code for Init and Unpack,
+	// unpacked bytes count for BadLength, with the bytes kept in data.
+	int64 value = 0;
+};
+
+// Unpacks the TL bytes of a gzip_packed object, starting at 'from'.
+// The result size is guessed from the 'ratio' of the previous payloads,
+// which is updated by the measured ratio of this one.
+UngzipResult UngzipPacked(
+	const mtpPrime *from,
+	const mtpPrime *end,
+	double &ratio);
+
+} // namespace internal
+} // namespace MTP
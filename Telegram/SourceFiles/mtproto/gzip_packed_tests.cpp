@@ -0,0 +1,162 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "mtproto/gzip_packed.h"
+#include "base/tests_benchmark.h"
+
+#include "zlib.h"
+
+#include <cmath>
+
+using namespace MTP::internal;
+using base::test::Measure;
+
+namespace {
+
+constexpr auto kRepeat = 20;
+
+// Something like a messages.getHistory response: serialized records
+// with ids, dates and short texts, compressed about as well as they are.
+mtpBuffer Response(int records) {
+	auto result = mtpBuffer();
+	result.reserve(records * 8);
+	for (auto i = 0; i != records; ++i) {
+		result.push_back(0x44f9b43d);
+		result.push_back(i + 1);
+		result.push_back(1'500'000'000 + i * 37);
+		result.push_back(i % 13);
+		result.push_back(0x74656874 + (i % 7));
+		result.push_back(0x20747865 + (i % 5));
+		result.push_back(int32(uint32(i) * 2654435761U));
+		result.push_back(0);
+	}
+	return result;
+}
+
+QByteArray Gzip(const mtpBuffer &data) {
+	z_stream stream;
+	stream.zalloc = nullptr;
+	stream.zfree = nullptr;
+	stream.opaque = nullptr;
+	REQUIRE(deflateInit2(
+		&stream,
+		Z_DEFAULT_COMPRESSION,
+		Z_DEFLATED,
+		16 + MAX_WBITS,
+		8,
+		Z_DEFAULT_STRATEGY) == Z_OK);
+	const auto size = data.size() * sizeof(mtpPrime);
+	auto result = QByteArray(deflateBound(&stream, size), Qt::Uninitialized);
+	stream.avail_in = size;
+	stream.next_in = reinterpret_cast<Bytef*>(
+		const_cast<mtpPrime*>(data.constData()));
+	stream.avail_out = result.size();
+	stream.next_out = reinterpret_cast<Bytef*>(result.data());
+	REQUIRE(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+	result.resize(result.size() - stream.avail_out);
+	deflateEnd(&stream);
+	return result;
+}
+
+// The gzip_packed object without its type id, as TL bytes.
+mtpBuffer Packed(const QByteArray &bytes) {
+	auto serialized = QByteArray();
+	if (bytes.size() < 254) {
+		serialized.append(char(bytes.size()));
+	} else {
+		serialized.append(char(254));
+		serialized.append(char(bytes.size() & 0xFF));
+		serialized.append(char((bytes.size() >> 8) & 0xFF));
+		serialized.append(char((bytes.size() >> 16) & 0xFF));
+	}
+	serialized.append(bytes);
+	while (serialized.size() % sizeof(mtpPrime)) {
+		serialized.append(char(0));
+	}
+	auto result = mtpBuffer(serialized.size() / sizeof(mtpPrime));
+	memcpy(result.data(), serialized.constData(), serialized.size());
+	return result;
+}
+
+UngzipResult Ungzip(const mtpBuffer &packed, double &ratio) {
+	return UngzipPacked(
+		packed.constData(),
+		packed.constData() + packed.size(),
+		ratio);
+}
+
+} // namespace
+
+TEST_CASE("gzip_packed unpacking", "[gzip_packed]") {
+	SECTION("short bytes are unpacked") {
+		const auto data = Response(2);
+		const auto packed = Packed(Gzip(data));
+		auto ratio = kInitialGzipRatio;
+		const auto result = Ungzip(packed, ratio);
+		REQUIRE(result.error == UngzipError::None);
+		REQUIRE(result.data == data);
+	}
+
+	SECTION("long bytes are unpacked and the ratio is learned") {
+		const auto data = Response(10000);
+		const auto gzipped = Gzip(data);
+		REQUIRE(gzipped.size() >= 254);
+		const auto packed = Packed(gzipped);
+		auto ratio = kInitialGzipRatio;
+		for (auto i = 0; i != 10; ++i) {
+			const auto result = Ungzip(packed, ratio);
+			REQUIRE(result.error == UngzipError::None);
+			REQUIRE(result.data == data);
+		}
+		const auto measured = double(data.size() * sizeof(mtpPrime))
+			/ gzipped.size();
+		REQUIRE(std::abs(ratio - measured) < measured / 10);
+	}
+
+	SECTION("result grows when the guess is too small") {
+		const auto data = Response(10000);
+		auto ratio = 0.;
+		const auto result = Ungzip(Packed(Gzip(data)), ratio);
+		REQUIRE(result.error == UngzipError::None);
+		REQUIRE(result.data == data);
+	}
+
+	SECTION("truncated bytes are insufficient") {
+		auto packed = Packed(Gzip(Response(100)));
+		packed.resize(packed.size() / 2);
+		auto ratio = kInitialGzipRatio;
+		REQUIRE(Ungzip(packed, ratio).error == UngzipError::Insufficient);
+		REQUIRE(ratio == kInitialGzipRatio);
+	}
+
+	SECTION("bad gzip data is not unpacked") {
+		auto ratio = kInitialGzipRatio;
+		const auto result = Ungzip(Packed(QByteArray(64, 'x')), ratio);
+		REQUIRE(result.error == UngzipError::Unpack);
+		REQUIRE(result.data.isEmpty());
+	}
+}
+
+TEST_CASE("gzip_packed unpacking speed", "[.][benchmark]") {
+	for (const auto records : { 16, 1024, 65536 }) {
+		const auto packed = Packed(Gzip(Response(records)));
+		auto learned = kInitialGzipRatio;
+		const auto warm = Measure([&] {
+			REQUIRE(Ungzip(packed, learned).error == UngzipError::None);
+		}, kRepeat);
+		const auto cold = Measure([&] {
+			auto ratio = 0.;
+			REQUIRE(Ungzip(packed, ratio).error == UngzipError::None);
+		}, kRepeat);
+		WARN(records
+			<< " records, "
+			<< packed.size() * sizeof(mtpPrime)
+			<< " bytes: learned ratio " << warm
+			<< " us, no guess " << cold << " us");
+	}
+}
@@ -99,8 +99,14 @@ public:
 		RPCResponseHandler &&callbacks);
 	SecureRequest getRequest(mtpRequestId requestId);
 	void clearCallbacksDelayed(std::vector<RPCCallbackClear> &&ids);
-	void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end);
+	void clearCallbacks(const std::vector<RPCCallbackClear> &ids);
+	void execCallback(
+		mtpRequestId requestId,
+		const mtpPrime *from,
+		const mtpPrime *end,
+		base::unique_any &&parsed);
 	bool hasCallbacks(mtpRequestId requestId);
+	RPCDoneHandlerPtr doneHandler(mtpRequestId requestId);
 	void globalCallback(const mtpPrime *from, const mtpPrime *end);
 
 	void onStateChange(ShiftedDcId shiftedDcId, int32 state);
@@ -166,7 +172,6 @@ private:
 	void clearCallbacks(
 		mtpRequestId requestId,
 		int32 errorCode = RPCError::NoError);
-	void clearCallbacks(const std::vector<RPCCallbackClear> &ids);
 
 	void checkDelayedRequests();
 
@@ -1034,7 +1039,8 @@ void Instance::Private::clearCallbacks(
 void Instance::Private::execCallback(
 		mtpRequestId requestId,
 		const mtpPrime *from,
-		const mtpPrime *end) {
+		const mtpPrime *end,
+		base::unique_any &&parsed) {
 	RPCResponseHandler h;
 	{
 		QMutexLocker locker(&_parserMapLock);
@@ -1068,7 +1074,10 @@ void Instance::Private::execCallback(
 				error.read(from, end);
 				handleError(error);
 			} else {
-				if (h.onDone) {
+				if (!h.onDone) {
+				} else if (parsed.has_value()) {
+					h.onDone->doneParsed(requestId, std::move(parsed));
+				} else {
 					(*h.onDone)(requestId, from, end);
 				}
 				unregisterRequest(requestId);
@@ -1090,6 +1099,12 @@ bool Instance::Private::hasCallbacks(mtpRequestId requestId) {
 	return (it != _parserMap.cend());
 }
 
+RPCDoneHandlerPtr Instance::Private::doneHandler(mtpRequestId requestId) {
+	QMutexLocker locker(&_parserMapLock);
+	auto it = _parserMap.find(requestId);
+	return (it != _parserMap.cend()) ? it->second.onDone : nullptr;
+}
+
 void Instance::Private::globalCallback(const mtpPrime *from, const mtpPrime *end) {
 	if (_globalHandler.onDone) {
 		(*_globalHandler.onDone)(0, from, end); // some updates were received
@@ -1711,14 +1726,28 @@ void Instance::clearCallbacksDelayed(std::vector<RPCCallbackClear> &&ids) {
 	_private->clearCallbacksDelayed(std::move(ids));
 }
 
-void Instance::execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) {
-	_private->execCallback(requestId, from, end);
+void Instance::clearCallbacks(std::vector<RPCCallbackClear> &&ids) {
+	if (!ids.empty()) {
+		_private->clearCallbacks(ids);
+	}
+}
+
+void Instance::execCallback(
+		mtpRequestId requestId,
+		const mtpPrime *from,
+		const mtpPrime *end,
+		base::unique_any &&parsed) {
+	_private->execCallback(requestId, from, end, std::move(parsed));
 }
 
 bool Instance::hasCallbacks(mtpRequestId requestId) {
 	return _private->hasCallbacks(requestId);
 }
 
+RPCDoneHandlerPtr Instance::doneHandler(mtpRequestId requestId) {
+	return _private->doneHandler(requestId);
+}
+
 void Instance::globalCallback(const mtpPrime *from, const mtpPrime *end) {
 	_private->globalCallback(from, end);
 }
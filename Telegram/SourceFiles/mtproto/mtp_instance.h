@@ -163,9 +163,15 @@ public:
 	void onSessionReset(ShiftedDcId shiftedDcId);
 
 	void clearCallbacksDelayed(std::vector<RPCCallbackClear> &&ids);
+	void clearCallbacks(std::vector<RPCCallbackClear> &&ids);
 
-	void execCallback(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end);
+	void execCallback(
+		mtpRequestId requestId,
+		const mtpPrime *from,
+		const mtpPrime *end,
+		base::unique_any &&parsed = base::unique_any());
 	bool hasCallbacks(mtpRequestId requestId);
+	RPCDoneHandlerPtr doneHandler(mtpRequestId requestId);
 	void globalCallback(const mtpPrime *from, const mtpPrime *end);
 
 	// return true if need to clean request data
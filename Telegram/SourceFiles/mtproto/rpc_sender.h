@@ -7,6 +7,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #pragma once
 
 #include "base/flat_set.h"
+#include "base/unique_any.h"
 #include "core/utils.h"
 #include <rpl/details/callable.h>
 
@@ -67,6 +68,19 @@ inline bool isDefaultHandledError(const RPCError &error) {
 class RPCAbstractDoneHandler { // abstract done
 public:
 	virtual void operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) = 0;
+
+	// Handlers of typed responses may parse them in advance in a
+	// background thread (must not touch anything but the data) and get
+	// the result in the main thread instead of the serialized data.
+	virtual bool canParseInAdvance() const {
+		return false;
+	}
+	virtual base::unique_any parseInAdvance(const mtpPrime *from, const mtpPrime *end) const {
+		return base::unique_any();
+	}
+	virtual void doneParsed(mtpRequestId requestId, base::unique_any &&parsed) {
+	}
+
 	virtual ~RPCAbstractDoneHandler() {
 	}
 
@@ -384,6 +398,20 @@ public:
 			(static_cast<TReceiver*>(_owner)->*_onDone)(std::move(response));
 		}
 	}
+	bool canParseInAdvance() const override {
+		return true;
+	}
+	base::unique_any parseInAdvance(const mtpPrime *from, const mtpPrime *end) const override {
+		auto response = TResponse();
+		response.read(from, end);
+		return std::move(response);
+	}
+	void doneParsed(mtpRequestId requestId, base::unique_any &&parsed) override {
+		if (_owner) {
+			auto &response = *base::any_cast<TResponse>(&parsed);
+			(static_cast<TReceiver*>(_owner)->*_onDone)(std::move(response));
+		}
+	}
 
 private:
 	CallbackType _onDone;
@@ -404,6 +432,20 @@ public:
 			(static_cast<TReceiver*>(_owner)->*_onDone)(std::move(response), requestId);
 		}
 	}
+	bool canParseInAdvance() const override {
+		return true;
+	}
+	base::unique_any parseInAdvance(const mtpPrime *from, const mtpPrime *end) const override {
+		auto response = TResponse();
+		response.read(from, end);
+		return std::move(response);
+	}
+	void doneParsed(mtpRequestId requestId, base::unique_any &&parsed) override {
+		if (_owner) {
+			auto &response = *base::any_cast<TResponse>(&parsed);
+			(static_cast<TReceiver*>(_owner)->*_onDone)(std::move(response), requestId);
+		}
+	}
 
 private:
 	CallbackType _onDone;
@@ -64,6 +64,26 @@ class Sender {
 				}
 			}
 
+			bool canParseInAdvance() const override {
+				return true;
+			}
+
+			base::unique_any parseInAdvance(const mtpPrime *from, const mtpPrime *end) const override {
+				auto result = Response();
+				result.read(from, end);
+				return std::move(result);
+			}
+
+			void doneParsed(mtpRequestId requestId, base::unique_any &&parsed) override {
+				auto handler = std::move(_handler);
+				_sender->senderRequestHandled(requestId);
+
+				if (handler) {
+					auto &result = *base::any_cast<Response>(&parsed);
+					Policy::handle(std::move(handler), requestId, std::move(result));
+				}
+			}
+
 		private:
 			not_null<Sender*> _sender;
 			Callback _handler;
@@ -29,6 +29,10 @@ constexpr auto kResendThreshold = 1;
 // Container lives 10 minutes in haveSent map.
 constexpr auto kContainerLives = 600;
 
+// Responses of this size and larger (getDifference, getHistory,
+// getStickerSet, etc) are parsed in a background thread.
+constexpr auto kParseInAdvanceMinInts = 16 * 1024;
+
 QString LogIds(const QVector<uint64> &ids) {
 	if (!ids.size()) return "[]";
 	auto idsStr = QString("[%1").arg(*ids.cbegin());
@@ -88,29 +92,51 @@ void SessionData::notifyConnectionInited(const ConnectionOptions &options) {
 	}
 }
 
+void SessionData::pushReceivedResponse(
+		mtpRequestId requestId,
+		SerializedMessage &&response) {
+	auto parsed = _owner->parseInAdvance(requestId, response);
+
+	// Count the message before it can be popped, so that the counter
+	// never goes below zero while it is read in receivedPendingCount().
+	_receivedPending.fetch_add(1, std::memory_order_release);
+	_received.push({ requestId, std::move(response), std::move(parsed) });
+}
+
+void SessionData::pushReceivedUpdate(SerializedMessage &&update) {
+	_receivedPending.fetch_add(1, std::memory_order_release);
+	_received.push({ mtpRequestId(0), std::move(update), nullptr });
+}
+
+std::optional<ReceivedMessage> SessionData::popReceived() {
+	auto result = _received.pop();
+	if (result) {
+		_receivedPending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+	return result;
+}
+
+base::flat_set<mtpMsgId> SessionData::takeStateRequests() {
+	auto result = base::flat_set<mtpMsgId>();
+	_stateRequests.pop_all([&](mtpMsgId msgId) {
+		result.emplace(msgId);
+	});
+	return result;
+}
+
 void SessionData::clear(Instance *instance) {
 	auto clearCallbacks = std::vector<RPCCallbackClear>();
 	{
-		QReadLocker locker1(haveSentMutex()), locker2(toResendMutex()), locker3(haveReceivedMutex()), locker4(wereAckedMutex());
-		auto receivedResponsesEnd = _receivedResponses.cend();
-		clearCallbacks.reserve(_haveSent.size() + _wereAcked.size());
+		QReadLocker locker1(haveSentMutex()), locker2(toResendMutex()), locker3(wereAckedMutex());
+		clearCallbacks.reserve(_haveSent.size() + _toResend.size() + _wereAcked.size());
 		for (auto i = _haveSent.cbegin(), e = _haveSent.cend(); i != e; ++i) {
-			auto requestId = i.value()->requestId;
-			if (!_receivedResponses.contains(requestId)) {
-				clearCallbacks.push_back(requestId);
-			}
+			clearCallbacks.push_back(i.value()->requestId);
 		}
 		for (auto i = _toResend.cbegin(), e = _toResend.cend(); i != e; ++i) {
-			auto requestId = i.value();
-			if (!_receivedResponses.contains(requestId)) {
-				clearCallbacks.push_back(requestId);
-			}
+			clearCallbacks.push_back(i.value());
 		}
 		for (auto i = _wereAcked.cbegin(), e = _wereAcked.cend(); i != e; ++i) {
-			auto requestId = i.value();
-			if (!_receivedResponses.contains(requestId)) {
-				clearCallbacks.push_back(requestId);
-			}
+			clearCallbacks.push_back(i.value());
 		}
 	}
 	{
@@ -129,11 +155,27 @@ void SessionData::clear(Instance *instance) {
 		QWriteLocker locker(receivedIdsMutex());
 		_receivedIds.clear();
 	}
-	instance->clearCallbacksDelayed(std::move(clearCallbacks));
+	if (clearCallbacks.empty()) {
+		return;
+	}
+
+	// Received responses are owned by the main thread, so we skip the
+	// requests that already have a response there before clearing.
+	// If the session is destroyed before that its responses are gone,
+	// so all the callbacks are cleared with their errors reported.
+	const auto session = QPointer<Session>(_owner.get());
+	crl::on_main(instance, [=, list = std::move(clearCallbacks)]() mutable {
+		if (session) {
+			session->clearCallbacksSkippingReceived(std::move(list));
+		} else {
+			instance->clearCallbacks(std::move(list));
+		}
+	});
 }
 
 Session::Session(not_null<Instance*> instance, ShiftedDcId shiftedDcId) : QObject()
 , _instance(instance)
+, _weak(base::make_weak(this))
 , data(this)
 , dcWithShift(shiftedDcId)
 , sender([=] { needToResumeAndSend(); }) {
@@ -337,11 +379,8 @@ void Session::checkRequestsByTimer() {
 
 	if (stateRequestIds.size()) {
 		DEBUG_LOG(("MTP Info: requesting state of msgs: %1").arg(LogIds(stateRequestIds)));
-		{
-			QWriteLocker locker(data.stateRequestMutex());
-			for (uint32 i = 0, l = stateRequestIds.size(); i < l; ++i) {
-				data.stateRequestMap().insert(stateRequestIds[i], true);
-			}
+		for (const auto msgId : stateRequestIds) {
+			data.pushStateRequest(msgId);
 		}
 		sendAnything(kCheckResendWaiting);
 	}
@@ -599,36 +638,101 @@ void Session::tryToReceive() {
 		auto requestId = mtpRequestId(0);
 		auto isUpdate = false;
 		auto message = SerializedMessage();
-		{
-			QWriteLocker locker(data.haveReceivedMutex());
-			auto &responses = data.haveReceivedResponses();
-			auto response = responses.begin();
-			if (response == responses.cend()) {
-				auto &updates = data.haveReceivedUpdates();
-				auto update = updates.begin();
-				if (update == updates.cend()) {
+		auto parsed = base::unique_any();
+		if (_receivedResponses.isEmpty() && _receivedUpdates.empty()) {
+			collectReceived();
+		}
+		const auto response = _receivedResponses.begin();
+		if (response == _receivedResponses.end()) {
+			if (_receivedUpdates.empty()) {
+				return;
+			}
+			message = std::move(_receivedUpdates.front());
+			isUpdate = true;
+			_receivedUpdates.pop_front();
+		} else {
+			if (const auto &inAdvance = response.value().parsed) {
+				if (!inAdvance->ready.load(std::memory_order_acquire)) {
+					// Keep the order, we'll be back when it is parsed.
 					return;
-				} else {
-					message = std::move(*update);
-					isUpdate = true;
-					updates.pop_front();
 				}
-			} else {
-				requestId = response.key();
-				message = std::move(response.value());
-				responses.erase(response);
+				parsed = std::move(inAdvance->value);
 			}
+			requestId = response.key();
+			message = std::move(response.value().message);
+			_receivedResponses.erase(response);
 		}
 		if (isUpdate) {
 			if (dcWithShift == BareDcId(dcWithShift)) { // call globalCallback only in main session
 				_instance->globalCallback(message.constData(), message.constData() + message.size());
 			}
+		} else if (message.size() >= kParseInAdvanceMinInts) {
+			const auto inAdvance = parsed.has_value();
+			const auto started = crl::now();
+			_instance->execCallback(requestId, message.constData(), message.constData() + message.size(), std::move(parsed));
+			DEBUG_LOG(("RPC Info: large response %1 (%2 ints, %3) handled in %4 ms"
+				).arg(requestId
+				).arg(message.size()
+				).arg(inAdvance ? "parsed in advance" : "parsed in place"
+				).arg(crl::now() - started));
 		} else {
 			_instance->execCallback(requestId, message.constData(), message.constData() + message.size());
 		}
 	}
 }
 
+std::shared_ptr<ParsedResponse> Session::parseInAdvance(
+		mtpRequestId requestId,
+		const SerializedMessage &response) {
+	if (response.size() < kParseInAdvanceMinInts
+		|| response[0] == mtpc_rpc_error) {
+		return nullptr;
+	}
+	// Untyped handlers read the serialized response in the main thread.
+	auto handler = _instance->doneHandler(requestId);
+	if (!handler || !handler->canParseInAdvance()) {
+		return nullptr;
+	}
+	auto result = std::make_shared<ParsedResponse>();
+	crl::async([=, weak = _weak, data = response, handler = std::move(handler)]() mutable {
+		try {
+			result->value = handler->parseInAdvance(
+				data.constData(),
+				data.constData() + data.size());
+		} catch (Exception &) {
+			// It will be parsed once again and reported in the main thread.
+		}
+		result->ready.store(true, std::memory_order_release);
+
+		// Pass the handler as well, it should be destroyed in main thread.
+		crl::on_main(weak, [=, handler = std::move(handler)] {
+			weak->tryToReceive();
+		});
+	});
+	return result;
+}
+
+void Session::collectReceived() {
+	while (auto received = data.popReceived()) {
+		if (received->requestId) {
+			_receivedResponses.insert(
+				received->requestId,
+				std::move(*received));
+		} else {
+			_receivedUpdates.push_back(std::move(received->message));
+		}
+	}
+}
+
+void Session::clearCallbacksSkippingReceived(
+		std::vector<RPCCallbackClear> &&ids) {
+	collectReceived();
+	ids.erase(ranges::remove_if(ids, [&](const RPCCallbackClear &request) {
+		return _receivedResponses.contains(request.requestId);
+	}), end(ids));
+	_instance->clearCallbacks(std::move(ids));
+}
+
 Session::~Session() {
 	Assert(_connection == nullptr);
 }
@@ -7,6 +7,9 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #pragma once
 
 #include "base/timer.h"
+#include "base/mpsc_queue.h"
+#include "base/flat_set.h"
+#include "base/weak_ptr.h"
 #include "mtproto/rpc_sender.h"
 
 namespace MTP {
@@ -97,6 +100,19 @@ private:
 
 using SerializedMessage = mtpBuffer;
 
+// Large responses are parsed in a background thread before they are
+// handled in the main thread, see Session::parseInAdvance.
+struct ParsedResponse {
+	std::atomic<bool> ready = false;
+	base::unique_any value;
+};
+
+struct ReceivedMessage {
+	mtpRequestId requestId = 0; // 0 for updates
+	SerializedMessage message;
+	std::shared_ptr<ParsedResponse> parsed;
+};
+
 inline bool ResponseNeedsAck(const SerializedMessage &response) {
 	if (response.size() < 8) {
 		return false;
@@ -206,12 +222,6 @@ public:
 	not_null<QReadWriteLock*> receivedIdsMutex() const {
 		return &_receivedIdsLock;
 	}
-	not_null<QReadWriteLock*> haveReceivedMutex() const {
-		return &_haveReceivedLock;
-	}
-	not_null<QReadWriteLock*> stateRequestMutex() const {
-		return &_stateRequestLock;
-	}
 
 	PreRequestMap &toSendMap() {
 		return _toSend;
@@ -243,24 +253,24 @@ public:
 	const RequestIdsMap &wereAckedMap() const {
 		return _wereAcked;
 	}
-	QMap<mtpRequestId, SerializedMessage> &haveReceivedResponses() {
-		return _receivedResponses;
-	}
-	const QMap<mtpRequestId, SerializedMessage> &haveReceivedResponses() const {
-		return _receivedResponses;
-	}
-	QList<SerializedMessage> &haveReceivedUpdates() {
-		return _receivedUpdates;
-	}
-	const QList<SerializedMessage> &haveReceivedUpdates() const {
-		return _receivedUpdates;
-	}
-	QMap<mtpMsgId, bool> &stateRequestMap() {
-		return _stateRequest;
+
+	// Called from the connection thread, consumed in Session::tryToReceive.
+	void pushReceivedResponse(
+		mtpRequestId requestId,
+		SerializedMessage &&response);
+	void pushReceivedUpdate(SerializedMessage &&update);
+	int receivedPendingCount() const {
+		const auto result = _receivedPending.load(std::memory_order_acquire);
+		Assert(result >= 0);
+		return result;
 	}
-	const QMap<mtpMsgId, bool> &stateRequestMap() const {
-		return _stateRequest;
+	std::optional<ReceivedMessage> popReceived();
+
+	// Called from the main thread, consumed in the connection thread.
+	void pushStateRequest(mtpMsgId msgId) {
+		_stateRequests.push(msgId);
 	}
+	base::flat_set<mtpMsgId> takeStateRequests();
 
 	not_null<Session*> owner() {
 		return _owner;
@@ -296,10 +306,10 @@ private:
 	RequestIdsMap _toResend; // map of msg_id -> request_id, that request_id -> request lies in toSend and is waiting to be resent
 	ReceivedMsgIds _receivedIds; // set of received msg_id's, for checking new msg_ids
 	RequestIdsMap _wereAcked; // map of msg_id -> request_id, this msg_ids already were acked or do not need ack
-	QMap<mtpMsgId, bool> _stateRequest; // set of msg_id's, whose state should be requested
+	base::mpsc_queue<mtpMsgId> _stateRequests; // msg_id's, whose state should be requested
 
-	QMap<mtpRequestId, SerializedMessage> _receivedResponses; // map of request_id -> response that should be processed in the main thread
-	QList<SerializedMessage> _receivedUpdates; // list of updates that should be processed in the main thread
+	base::mpsc_queue<ReceivedMessage> _received; // responses and updates that should be processed in the main thread
+	std::atomic<int> _receivedPending = 0;
 
 	// mutexes
 	mutable QReadWriteLock _lock;
@@ -308,12 +318,10 @@ private:
 	mutable QReadWriteLock _toResendLock;
 	mutable QReadWriteLock _receivedIdsLock;
 	mutable QReadWriteLock _wereAckedLock;
-	mutable QReadWriteLock _haveReceivedLock;
-	mutable QReadWriteLock _stateRequestLock;
 
 };
 
-class Session : public QObject {
+class Session : public QObject, public base::has_weak_ptr {
 	Q_OBJECT
 
 public:
@@ -347,6 +355,15 @@ public:
 		crl::time msCanWait = 0,
 		bool newRequest = true);
 
+	// Called in the main thread by SessionData::clear.
+	void clearCallbacksSkippingReceived(
+		std::vector<RPCCallbackClear> &&ids);
+
+	// Called from the connection thread.
+	std::shared_ptr<ParsedResponse> parseInAdvance(
+		mtpRequestId requestId,
+		const SerializedMessage &response);
+
 	~Session();
 
 signals:
@@ -376,17 +393,25 @@ public slots:
 
 private:
 	void createDcData();
+	void collectReceived();
 
 	bool rpcErrorOccured(mtpRequestId requestId, const RPCFailHandlerPtr &onFail, const RPCError &err);
 
 	not_null<Instance*> _instance;
 	std::unique_ptr<Connection> _connection;
 
+	// Created in the main thread, copied by the background parsing.
+	const base::weak_ptr<Session> _weak;
+
 	bool _killed = false;
 	bool _needToReceive = false;
 
 	SessionData data;
 
+	// Owned by the main thread, filled from SessionData::popReceived.
+	QMap<mtpRequestId, ReceivedMessage> _receivedResponses;
+	std::deque<SerializedMessage> _receivedUpdates;
+
 	ShiftedDcId dcWithShift = 0;
 	std::shared_ptr<Dcenter> dc;
 
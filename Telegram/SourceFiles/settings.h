@@ -39,6 +39,7 @@ DeclareSetting(bool, StartMinimized);
 DeclareSetting(bool, StartInTray);
 DeclareSetting(bool, SendToMenu);
 DeclareSetting(bool, UseExternalVideoPlayer);
+DeclareSetting(int, DecodingThreads);
 enum LaunchMode {
 	LaunchModeNormal = 0,
 	LaunchModeAutoStart,
@@ -419,7 +419,9 @@ void DatabaseObject::collectTimeStale(
 	_minimalEntryTime = 0;
 	_entriesWithMinimalTimeCount = 0;
 	for (const auto &[key, entry] : _map) {
-		if (entry.useTime <= before) {
+		if (_settings.persistentTags.contains(entry.tag)) {
+			continue;
+		} else if (entry.useTime <= before) {
 			stale.emplace(key);
 			staleTotalSize += entry.size;
 		} else if (!_minimalEntryTime
@@ -458,7 +460,8 @@ void DatabaseObject::collectSizeStale(
 
 	for (const auto &bucket : _map) {
 		const auto &entry = bucket.second;
-		if (stale.contains(bucket.first)) {
+		if (stale.contains(bucket.first)
+			|| _settings.persistentTags.contains(entry.tag)) {
 			continue;
 		}
 		const auto add = (oldestTotalSize < removeSize)
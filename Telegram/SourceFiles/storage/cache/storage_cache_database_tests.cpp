@@ -699,6 +699,28 @@ TEST_CASE("cache db limits", "[storage_cache_database]") {
 		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
 		Close(db);
 	}
+	SECTION("db limits skip persistent tags") {
+		auto settings = Settings;
+		settings.trackEstimatedTime = true;
+		settings.totalSizeLimit = 17 * 2 + 1;
+		settings.totalTimeLimit = 3;
+		settings.persistentTags = { 1 };
+		Database db(name, settings);
+
+		db.clear(nullptr);
+		db.open(base::duplicate(key), nullptr);
+		db.put(Key{ 0, 1 }, Database::TaggedValue(Test1(), 1), nullptr);
+		db.put(Key{ 1, 0 }, Database::TaggedValue(Test2(), 2), nullptr);
+		AdvanceTime(2);
+		db.put(Key{ 1, 1 }, Database::TaggedValue(Test1(), 2), nullptr);
+		db.put(Key{ 2, 0 }, Database::TaggedValue(Test2(), 2), nullptr);
+		AdvanceTime(4);
+		REQUIRE(Get(db, Key{ 1, 0 }).isEmpty());
+		REQUIRE(Get(db, Key{ 1, 1 }).isEmpty());
+		REQUIRE(Get(db, Key{ 2, 0 }).isEmpty());
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		Close(db);
+	}
 }
 
 TEST_CASE("large db", "[storage_cache_database]") {
@@ -8,6 +8,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 
 #include "base/basic_types.h"
 #include "base/flat_map.h"
+#include "base/flat_set.h"
 #include "base/optional.h"
 #include <crl/crl_time.h>
 #include <QtCore/QString>
@@ -80,6 +81,9 @@ struct Settings {
 	crl::time pruneTimeout = 5 * crl::time(1000);
 	crl::time maxPruneCheckTimeout = 3600 * crl::time(1000);
 
+	// Values with these tags are never removed by the limits above.
+	base::flat_set<uint8> persistentTags;
+
 	bool clearOnWrongKey = false;
 };
 
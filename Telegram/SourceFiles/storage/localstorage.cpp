@@ -19,6 +19,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "ui/emoji_config.h"
 #include "export/export_settings.h"
 #include "core/crash_reports.h"
+#include "core/startup_trace.h"
 #include "core/update_checker.h"
 #include "observer_peer.h"
 #include "mainwidget.h"
@@ -33,8 +34,12 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 #include "window/window_controller.h"
 #include "base/flags.h"
 #include "data/data_session.h"
+#include "data/data_document.h"
+#include "storage/cache/storage_cache_database.h"
 #include "history/history.h"
 
+#include <QtCore/QWaitCondition>
+
 #ifndef BETTERGRAM_UPDATES
 #define BETTERGRAM_UPDATES (1)
 #endif
@@ -64,7 +69,8 @@ constexpr auto kSinglePeerTypeSelf = qint32(4);
 constexpr auto kSinglePeerTypeEmpty = qint32(0);
 
 constexpr auto kStickersVersionTag = quint32(-1);
-constexpr auto kStickersSerializeVersion = 1;
+constexpr auto kStickersSerializeVersion = 2;
+constexpr auto kStickerSetContentsVersion = 1;
 constexpr auto kMaxSavedStickerSetsCount = 1000;
 
 using Database = Storage::Cache::Database;
@@ -90,6 +96,10 @@ bool _started = false;
 internal::Manager *_manager = nullptr;
 TaskQueue *_localLoader = nullptr;
 
+// Waveforms are counted in a separate queue, so that chats with many
+// voice messages don't delay the files that are prepared for sending.
+TaskQueue *_waveformLoader = nullptr;
+
 bool _working() {
 	return _manager && !_basePath.isEmpty();
 }
@@ -105,7 +115,231 @@ enum class FileOption {
 using FileOptions = base::flags<FileOption>;
 inline constexpr auto is_flag_type(FileOption) { return true; };
 
+// Reads and decrypts the files listed in the map on the background
+// threads while the main thread is busy with the startup, the result
+// is taken by readEncryptedFile() instead of reading the file again.
+class FilePrefetcher {
+public:
+	struct Prefetched {
+		int32 version = 0;
+		QByteArray data;
+		QString outdated;
+	};
+
+	// The path is without the '0' / '1' suffix.
+	void start(
+		const char *stage,
+		const QString &path,
+		bool safe,
+		const MTP::AuthKeyPtr &key);
+
+	// Waits for the file if it is still being read, returns std::nullopt
+	// if the file was not prefetched or could not be read in background.
+	[[nodiscard]] std::optional<Prefetched> take(
+		const QString &path,
+		const MTP::AuthKeyPtr &key);
+
+	// The file was changed, the prefetched content can't be used.
+	void forget(const QString &path);
+
+	// Drops all the files, including the ones that were not taken.
+	void clear();
+
+private:
+	struct Entry {
+		uint64 id = 0;
+		MTP::AuthKeyPtr key;
+		std::optional<Prefetched> result;
+		bool ready = false;
+	};
+
+	static std::optional<Prefetched> Read(
+		const QString &path,
+		bool safe,
+		const MTP::AuthKeyPtr &key);
+
+	mutable QMutex _mutex;
+	QWaitCondition _ready;
+	base::flat_map<QString, Entry> _entries;
+	uint64 _lastId = 0;
+
+};
+
+FilePrefetcher _prefetcher;
+
+// Writes the prepared files in a background thread, one at a time and in
+// the order they were requested, so that a file is always written before
+// the map that references it. A file that is written again while its
+// previous content still waits at the end of the queue is coalesced.
+class FileWriter {
+public:
+	// The path is without the '0' / '1' suffix.
+	void write(const QString &path, bool safe, QByteArray &&content);
+	void remove(const QString &path, bool safe);
+
+	// Returns the latest pending content or a null array if the file
+	// will be removed, std::nullopt if nothing is pending for the path.
+	[[nodiscard]] std::optional<QByteArray> pending(
+		const QString &path) const;
+
+	// Waits until all the pending files are written.
+	void finish();
+
+private:
+	struct Entry {
+		QString path;
+		QByteArray content;
+		bool safe = false;
+		bool remove = false;
+		bool writing = false;
+	};
+
+	void push(Entry &&entry);
+	void process();
+	static void Perform(const Entry &entry);
+
+	mutable QMutex _mutex;
+	QWaitCondition _finished;
+	std::deque<Entry> _queue;
+	bool _running = false;
+
+};
+
+FileWriter _writer;
+
+void FileWriter::write(
+		const QString &path,
+		bool safe,
+		QByteArray &&content) {
+	_prefetcher.forget(path);
+	push({ path, std::move(content), safe });
+}
+
+void FileWriter::remove(const QString &path, bool safe) {
+	_prefetcher.forget(path);
+	push({ path, QByteArray(), safe, true });
+}
+
+void FileWriter::push(Entry &&entry) {
+	QMutexLocker lock(&_mutex);
+	if (!_queue.empty()
+		&& _queue.back().path == entry.path
+		&& !_queue.back().writing) {
+		_queue.back() = std::move(entry);
+		return;
+	}
+	_queue.push_back(std::move(entry));
+	if (!_running) {
+		_running = true;
+		crl::async([=] { process(); });
+	}
+}
+
+std::optional<QByteArray> FileWriter::pending(const QString &path) const {
+	QMutexLocker lock(&_mutex);
+	for (auto i = _queue.rbegin(), e = _queue.rend(); i != e; ++i) {
+		if (i->path == path) {
+			return i->remove ? QByteArray() : i->content;
+		}
+	}
+	return std::nullopt;
+}
+
+void FileWriter::finish() {
+	QMutexLocker lock(&_mutex);
+	while (_running) {
+		_finished.wait(&_mutex);
+	}
+}
+
+void FileWriter::process() {
+	QMutexLocker lock(&_mutex);
+	while (!_queue.empty()) {
+		auto &entry = _queue.front();
+		entry.writing = true;
+		const auto copy = entry;
+		lock.unlock();
+
+		Perform(copy);
+
+		lock.relock();
+		_queue.pop_front();
+	}
+	_running = false;
+	_finished.wakeAll();
+}
+
+void FileWriter::Perform(const Entry &entry) {
+	const auto started = std::chrono::steady_clock::now();
+	if (entry.remove) {
+		QFile::remove(entry.path + '0');
+		if (entry.safe) {
+			QFile::remove(entry.path + '1');
+		}
+		return;
+	}
+
+	// Overwrite the older of the two versions and remove the other one.
+	QString toTry[2];
+	QString toDelete;
+	toTry[0] = entry.path + '0';
+	if (entry.safe) {
+		toTry[1] = entry.path + '1';
+		QFileInfo toTry0(toTry[0]);
+		QFileInfo toTry1(toTry[1]);
+		if (toTry0.exists()) {
+			if (toTry1.exists()) {
+				QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
+				if (mod0 > mod1) {
+					qSwap(toTry[0], toTry[1]);
+				}
+			} else {
+				qSwap(toTry[0], toTry[1]);
+			}
+			toDelete = toTry[1];
+		} else if (toTry1.exists()) {
+			toDelete = toTry[1];
+		}
+	}
+
+	QFile file(toTry[0]);
+	if (!file.open(QIODevice::WriteOnly)
+		|| file.write(entry.content) != entry.content.size()) {
+		LOG(("App Error: could not write '%1'").arg(toTry[0]));
+		return;
+	}
+	file.close();
+	if (!toDelete.isEmpty()) {
+		QFile::remove(toDelete);
+	}
+	DEBUG_LOG(("App Info: '%1' written in %2 us"
+		).arg(toTry[0]
+		).arg(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - started).count()));
+}
+
+// Logs the time the main thread spends in a Local:: write method.
+class WriteStallTimer {
+public:
+	explicit WriteStallTimer(const char *name)
+	: _name(name)
+	, _started(std::chrono::steady_clock::now()) {
+	}
+	~WriteStallTimer() {
+		DEBUG_LOG(("App Info: %1 took %2 us on the main thread"
+			).arg(_name
+			).arg(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - _started).count()));
+	}
+
+private:
+	const char *_name = nullptr;
+	std::chrono::steady_clock::time_point _started;
+
+};
+
 bool keyAlreadyUsed(QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+	if (_writer.pending(name)) return true;
 	name += '0';
 	if (QFileInfo(name).exists()) return true;
 	if (options & (FileOption::Safe)) {
@@ -142,14 +376,8 @@ void clearKey(const FileKey &key, FileOptions options = FileOption::User | FileO
 		if (!_working()) return;
 	}
 
-	QString base = (options & FileOption::User) ? _userBasePath : _basePath, name;
-	name.reserve(base.size() + 0x11);
-	name.append(base).append(toFilePart(key)).append('0');
-	QFile::remove(name);
-	if (options & FileOption::Safe) {
-		name[name.size() - 1] = '1';
-		QFile::remove(name);
-	}
+	const auto base = (options & FileOption::User) ? _userBasePath : _basePath;
+	_writer.remove(base + toFilePart(key), (options & FileOption::Safe));
 }
 
 bool _checkStreamStatus(QDataStream &stream) {
@@ -242,40 +470,22 @@ struct FileWriteDescriptor {
 			if (!_working()) return;
 		}
 
-		// detect order of read attempts and file version
-		QString toTry[2];
-		toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
-		if (options & FileOption::Safe) {
-			toTry[1] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '1';
-			QFileInfo toTry0(toTry[0]);
-			QFileInfo toTry1(toTry[1]);
-			if (toTry0.exists()) {
-				if (toTry1.exists()) {
-					QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
-					if (mod0 > mod1) {
-						qSwap(toTry[0], toTry[1]);
-					}
-				} else {
-					qSwap(toTry[0], toTry[1]);
-				}
-				toDelete = toTry[1];
-			} else if (toTry1.exists()) {
-				toDelete = toTry[1];
-			}
-		}
+		// The content is prepared in memory and written by _writer.
+		path = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+		safe = (options & FileOption::Safe);
 
-		file.setFileName(toTry[0]);
-		if (file.open(QIODevice::WriteOnly)) {
-			file.write(tdfMagic, tdfMagicLen);
+		buffer.setBuffer(&content);
+		if (buffer.open(QIODevice::WriteOnly)) {
+			buffer.write(tdfMagic, tdfMagicLen);
 			qint32 version = AppVersion;
-			file.write((const char*)&version, sizeof(version));
+			buffer.write((const char*)&version, sizeof(version));
 
-			stream.setDevice(&file);
+			stream.setDevice(&buffer);
 			stream.setVersion(QDataStream::Qt_5_1);
 		}
 	}
 	bool writeData(const QByteArray &data) {
-		if (!file.isOpen()) return false;
+		if (!buffer.isOpen()) return false;
 
 		stream << data;
 		quint32 len = data.isNull() ? 0xffffffff : data.size();
@@ -310,7 +520,7 @@ struct FileWriteDescriptor {
 		return writeData(prepareEncrypted(data, key));
 	}
 	void finish() {
-		if (!file.isOpen()) return;
+		if (!buffer.isOpen()) return;
 
 		stream.setDevice(nullptr);
 
@@ -318,18 +528,18 @@ struct FileWriteDescriptor {
 		qint32 version = AppVersion;
 		md5.feed(&version, sizeof(version));
 		md5.feed(tdfMagic, tdfMagicLen);
-		file.write((const char*)md5.result(), 0x10);
-		file.close();
+		buffer.write((const char*)md5.result(), 0x10);
+		buffer.close();
+		buffer.setBuffer(nullptr);
 
-		if (!toDelete.isEmpty()) {
-			QFile::remove(toDelete);
-		}
+		_writer.write(path, safe, base::take(content));
 	}
-	QFile file;
+	QString path;
+	bool safe = false;
+	QByteArray content;
+	QBuffer buffer;
 	QDataStream stream;
 
-	QString toDelete;
-
 	HashMd5 md5;
 	int32 dataSize = 0;
 
@@ -338,6 +548,69 @@ struct FileWriteDescriptor {
 	}
 };
 
+bool readFileContent(FileReadDescriptor &result, QByteArray &&bytes, const QString &name) {
+	// check magic
+	if (bytes.size() < tdfMagicLen) {
+		DEBUG_LOG(("App Info: failed to read magic from '%1'").arg(name));
+		return false;
+	}
+	const auto magic = bytes.constData();
+	if (memcmp(magic, tdfMagic, tdfMagicLen)) {
+		DEBUG_LOG(("App Info: bad magic %1 in '%2'").arg(Logs::mb(magic, tdfMagicLen).str()).arg(name));
+		return false;
+	}
+
+	// read app version
+	qint32 version;
+	if (bytes.size() < tdfMagicLen + int(sizeof(version))) {
+		DEBUG_LOG(("App Info: failed to read version from '%1'").arg(name));
+		return false;
+	}
+	memcpy(&version, bytes.constData() + tdfMagicLen, sizeof(version));
+	if (version > AppVersion) {
+		DEBUG_LOG(("App Info: version too big %1 for '%2', my version %3").arg(version).arg(name).arg(AppVersion));
+		return false;
+	}
+
+	// read data
+	const auto data = bytes.constData() + tdfMagicLen + sizeof(version);
+	int32 dataSize = bytes.size() - tdfMagicLen - sizeof(version) - 16;
+	if (dataSize < 0) {
+		DEBUG_LOG(("App Info: bad file '%1', could not read sign part").arg(name));
+		return false;
+	}
+
+	// check signature
+	HashMd5 md5;
+	md5.feed(data, dataSize);
+	md5.feed(&dataSize, sizeof(dataSize));
+	md5.feed(&version, sizeof(version));
+	md5.feed(tdfMagic, tdfMagicLen);
+	if (memcmp(md5.result(), data + dataSize, 16)) {
+		DEBUG_LOG(("App Info: bad file '%1', signature did not match").arg(name));
+		return false;
+	}
+
+	result.data = bytes.mid(tdfMagicLen + sizeof(version), dataSize);
+	bytes = QByteArray();
+
+	result.version = version;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
+}
+
+// The outdated copy of a safe file is removed, or its path is returned
+// in the outdated argument if it is provided.
+bool readFileFromDisk(
+	FileReadDescriptor &result,
+	const QString &path,
+	const QString &name,
+	bool safe,
+	QString *outdated = nullptr);
+
 bool readFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
 	if (options & FileOption::User) {
 		if (!_userWorking()) return false;
@@ -345,13 +618,32 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 		if (!_working()) return false;
 	}
 
+	// the latest content may be still waiting in the write queue
+	const auto base = (options & FileOption::User) ? _userBasePath : _basePath;
+	if (auto pending = _writer.pending(base + name)) {
+		return !pending->isNull()
+			&& readFileContent(result, std::move(*pending), name);
+	}
+	return readFileFromDisk(
+		result,
+		base + name,
+		name,
+		(options & FileOption::Safe));
+}
+
+bool readFileFromDisk(
+		FileReadDescriptor &result,
+		const QString &path,
+		const QString &name,
+		bool safe,
+		QString *outdated) {
 	// detect order of read attempts
 	QString toTry[2];
-	toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
-	if (options & FileOption::Safe) {
+	toTry[0] = path + '0';
+	if (safe) {
 		QFileInfo toTry0(toTry[0]);
 		if (toTry0.exists()) {
-			toTry[1] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '1';
+			toTry[1] = path + '1';
 			QFileInfo toTry1(toTry[1]);
 			if (toTry1.exists()) {
 				QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
@@ -374,60 +666,16 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 			DEBUG_LOG(("App Info: failed to open '%1' for reading").arg(name));
 			continue;
 		}
-
-		// check magic
-		char magic[tdfMagicLen];
-		if (f.read(magic, tdfMagicLen) != tdfMagicLen) {
-			DEBUG_LOG(("App Info: failed to read magic from '%1'").arg(name));
-			continue;
-		}
-		if (memcmp(magic, tdfMagic, tdfMagicLen)) {
-			DEBUG_LOG(("App Info: bad magic %1 in '%2'").arg(Logs::mb(magic, tdfMagicLen).str()).arg(name));
-			continue;
-		}
-
-		// read app version
-		qint32 version;
-		if (f.read((char*)&version, sizeof(version)) != sizeof(version)) {
-			DEBUG_LOG(("App Info: failed to read version from '%1'").arg(name));
-			continue;
-		}
-		if (version > AppVersion) {
-			DEBUG_LOG(("App Info: version too big %1 for '%2', my version %3").arg(version).arg(name).arg(AppVersion));
-			continue;
-		}
-
-		// read data
-		QByteArray bytes = f.read(f.size());
-		int32 dataSize = bytes.size() - 16;
-		if (dataSize < 0) {
-			DEBUG_LOG(("App Info: bad file '%1', could not read sign part").arg(name));
+		if (!readFileContent(result, f.readAll(), name)) {
 			continue;
 		}
 
-		// check signature
-		HashMd5 md5;
-		md5.feed(bytes.constData(), dataSize);
-		md5.feed(&dataSize, sizeof(dataSize));
-		md5.feed(&version, sizeof(version));
-		md5.feed(magic, tdfMagicLen);
-		if (memcmp(md5.result(), bytes.constData() + dataSize, 16)) {
-			DEBUG_LOG(("App Info: bad file '%1', signature did not match").arg(name));
-			continue;
-		}
-
-		bytes.resize(dataSize);
-		result.data = bytes;
-		bytes = QByteArray();
-
-		result.version = version;
-		result.buffer.setBuffer(&result.data);
-		result.buffer.open(QIODevice::ReadOnly);
-		result.stream.setDevice(&result.buffer);
-		result.stream.setVersion(QDataStream::Qt_5_1);
-
 		if ((i == 0 && !toTry[1].isEmpty()) || i == 1) {
-			QFile::remove(toTry[1 - i]);
+			if (outdated) {
+				*outdated = toTry[1 - i];
+			} else {
+				QFile::remove(toTry[1 - i]);
+			}
 		}
 
 		return true;
@@ -471,10 +719,7 @@ bool decryptLocal(EncryptedDescriptor &result, const QByteArray &encrypted, cons
 	return true;
 }
 
-bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
-	if (!readFile(result, name, options)) {
-		return false;
-	}
+bool decryptFile(FileReadDescriptor &result, const MTP::AuthKeyPtr &key) {
 	QByteArray encrypted;
 	result.stream >> encrypted;
 
@@ -501,6 +746,111 @@ bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOpti
 	return true;
 }
 
+void FilePrefetcher::start(
+		const char *stage,
+		const QString &path,
+		bool safe,
+		const MTP::AuthKeyPtr &key) {
+	if (_writer.pending(path)) {
+		return;
+	}
+
+	QMutexLocker lock(&_mutex);
+	const auto id = ++_lastId;
+	auto &entry = _entries[path];
+	entry = Entry();
+	entry.id = id;
+	entry.key = key;
+	lock.unlock();
+
+	crl::async([=] {
+		const auto traced = Core::StartupStage(stage);
+		auto result = Read(path, safe, key);
+
+		QMutexLocker lock(&_mutex);
+		const auto i = _entries.find(path);
+		if (i == end(_entries) || i->second.id != id) {
+			return;
+		}
+		i->second.result = std::move(result);
+		i->second.ready = true;
+		_ready.wakeAll();
+	});
+}
+
+auto FilePrefetcher::take(const QString &path, const MTP::AuthKeyPtr &key)
+-> std::optional<Prefetched> {
+	QMutexLocker lock(&_mutex);
+	auto i = _entries.find(path);
+	while (i != end(_entries) && !i->second.ready) {
+		_ready.wait(&_mutex);
+		i = _entries.find(path);
+	}
+	if (i == end(_entries)) {
+		return std::nullopt;
+	}
+	auto entry = std::move(i->second);
+	_entries.erase(i);
+	return (entry.key == key) ? std::move(entry.result) : std::nullopt;
+}
+
+void FilePrefetcher::forget(const QString &path) {
+	QMutexLocker lock(&_mutex);
+	if (_entries.remove(path)) {
+		_ready.wakeAll();
+	}
+}
+
+void FilePrefetcher::clear() {
+	QMutexLocker lock(&_mutex);
+	_entries.clear();
+	_ready.wakeAll();
+}
+
+auto FilePrefetcher::Read(
+		const QString &path,
+		bool safe,
+		const MTP::AuthKeyPtr &key)
+-> std::optional<Prefetched> {
+	// The outdated copy is removed by readEncryptedFile() when the
+	// content is taken, the background read doesn't touch the files.
+	FileReadDescriptor file;
+	auto outdated = QString();
+	if (!readFileFromDisk(file, path, path, safe, &outdated)
+		|| !decryptFile(file, key)) {
+		return std::nullopt;
+	}
+	auto result = Prefetched();
+	result.version = file.version;
+	result.data = base::take(file.data);
+	result.outdated = outdated;
+	return result;
+}
+
+bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
+	if (options & FileOption::User) {
+		if (!_userWorking()) return false;
+	} else {
+		if (!_working()) return false;
+	}
+
+	const auto base = (options & FileOption::User) ? _userBasePath : _basePath;
+	if (auto prefetched = _prefetcher.take(base + name, key)) {
+		if (!prefetched->outdated.isEmpty()) {
+			QFile::remove(prefetched->outdated);
+		}
+		result.version = prefetched->version;
+		result.data = std::move(prefetched->data);
+		result.buffer.setBuffer(&result.data);
+		result.buffer.open(QIODevice::ReadOnly);
+		result.buffer.seek(sizeof(uint32)); // skip len
+		result.stream.setDevice(&result.buffer);
+		result.stream.setVersion(QDataStream::Qt_5_1);
+		return true;
+	}
+	return readFile(result, name, options) && decryptFile(result, key);
+}
+
 bool readEncryptedFile(FileReadDescriptor &result, const FileKey &fkey, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
 	return readEncryptedFile(result, toFilePart(fkey), options, key);
 }
@@ -656,6 +1006,22 @@ bool _trustedBotsRead = false;
 
 FileKey _recentStickersKeyOld = 0;
 FileKey _installedStickersKey = 0, _featuredStickersKey = 0, _recentStickersKey = 0, _favedStickersKey = 0, _archivedStickersKey = 0;
+
+// Contents of the ordinary sticker sets (stickers, dates and emoji) are
+// kept in the cache database one entry per set, the stickers files have
+// only the set info and the signature of the stored contents. So a change
+// in one set doesn't rewrite all of them and the contents are read only
+// when the set is needed.
+//
+// Set id -> signature of the contents stored in the cache database.
+base::flat_map<uint64, uint64> _storedStickerSets;
+
+// Stickers file key -> sets with the stored contents it references.
+base::flat_map<const FileKey*, base::flat_set<uint64>> _stickerSetsInFiles;
+base::flat_set<uint64> _stickerSetsLoading;
+bool _stickerSetsLoaded = false;
+int64 _stickerSetsBytesWritten = 0;
+
 FileKey _savedGifsKey = 0;
 
 FileKey _backgroundKeyDay = 0;
@@ -2433,21 +2799,63 @@ ReadMapState _readMap(const QByteArray &pass) {
 		_mapChanged = false;
 	}
 
+	// The files don't depend on each other, read and decrypt them all
+	// in the background and parse in order when they are needed. The
+	// stickers and saved gifs are parsed only after the main widget is
+	// created, they should be ready by that time.
+	const auto prefetch = [](
+			const char *stage,
+			FileKey key,
+			FileOptions options = FileOption::User | FileOption::Safe) {
+		if (key) {
+			const auto base = (options & FileOption::User)
+				? _userBasePath
+				: _basePath;
+			_prefetcher.start(
+				stage,
+				base + toFilePart(key),
+				(options & FileOption::Safe),
+				LocalKey);
+		}
+	};
+	prefetch("prefetch mtp data", _dataNameKey, FileOption::Safe);
+	prefetch("prefetch user settings", _userSettingsKey);
+	prefetch("prefetch locations", _locationsKey);
+	prefetch("prefetch report spam statuses", _reportSpamStatusesKey);
+	prefetch("prefetch saved peers", _savedPeersKey);
+	prefetch("prefetch installed stickers", _installedStickersKey);
+	prefetch("prefetch featured stickers", _featuredStickersKey);
+	prefetch("prefetch recent stickers", _recentStickersKey);
+	prefetch("prefetch faved stickers", _favedStickersKey);
+	prefetch("prefetch saved gifs", _savedGifsKey);
+	prefetch("prefetch export settings", _exportSettingsKey);
+
 	if (_locationsKey) {
+		const auto stage = Core::StartupStage("read locations");
 		_readLocations();
 	}
 	if (_reportSpamStatusesKey) {
+		const auto stage = Core::StartupStage("read report spam statuses");
 		_readReportSpamStatuses();
 	}
 
-	_readUserSettings();
-	_readMtpData();
+	{
+		const auto stage = Core::StartupStage("read user settings");
+		_readUserSettings();
+	}
+	{
+		const auto stage = Core::StartupStage("read mtp data");
+		_readMtpData();
+	}
 
 	DEBUG_LOG(("selfSerialized set: %1").arg(selfSerialized.size()));
-	Core::App().setAuthSessionFromStorage(
-		std::move(StoredAuthSessionCache),
-		std::move(selfSerialized),
-		_oldMapVersion);
+	{
+		const auto stage = Core::StartupStage("restore auth session");
+		Core::App().setAuthSessionFromStorage(
+			std::move(StoredAuthSessionCache),
+			std::move(selfSerialized),
+			_oldMapVersion);
+	}
 
 	LOG(("Map read time: %1").arg(crl::now() - ms));
 	if (_oldSettingsVersion < AppVersion) {
@@ -2599,7 +3007,9 @@ void finish() {
 		_manager->deleteLater();
 		_manager = 0;
 		delete base::take(_localLoader);
+		delete base::take(_waveformLoader);
 	}
+	_writer.finish();
 }
 
 void loadTheme();
@@ -2610,6 +3020,7 @@ void start() {
 
 	_manager = new internal::Manager();
 	_localLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
+	_waveformLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
 
 	_basePath = cWorkingDir() + qsl("tdata/");
 	if (!QDir().exists(_basePath)) QDir().mkpath(_basePath);
@@ -2837,6 +3248,9 @@ void reset() {
 	if (_localLoader) {
 		_localLoader->stop();
 	}
+	if (_waveformLoader) {
+		_waveformLoader->stop();
+	}
 
 	_passKeySalt.clear(); // reset passcode, local key
 	_draftsMap.clear();
@@ -2845,6 +3259,11 @@ void reset() {
 	_fileLocationPairs.clear();
 	_fileLocationAliases.clear();
 	_draftsNotReadMap.clear();
+	_prefetcher.clear();
+	_storedStickerSets.clear();
+	_stickerSetsInFiles.clear();
+	_stickerSetsLoading.clear();
+	_stickerSetsLoaded = false;
 	_locationsKey = _reportSpamStatusesKey = _trustedBotsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = _featuredStickersKey = _recentStickersKey = _favedStickersKey = _archivedStickersKey = 0;
@@ -2862,6 +3281,7 @@ void reset() {
 	_writeMap(WriteMapWhen::Now);
 
 	_writeMtpData();
+	_writer.finish();
 }
 
 bool checkPasscode(const QByteArray &passcode) {
@@ -2943,6 +3363,10 @@ ReadMapState readMap(const QByteArray &pass) {
 	return result;
 }
 
+void dropPrefetchedFiles() {
+	_prefetcher.clear();
+}
+
 int32 oldMapVersion() {
 	return _oldMapVersion;
 }
@@ -2954,6 +3378,8 @@ int32 oldSettingsVersion() {
 void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const MessageDraft &editDraft) {
 	if (!_working()) return;
 
+	const auto stall = WriteStallTimer("writeDrafts");
+
 	if (localDraft.msgId <= 0 && localDraft.textWithTags.text.isEmpty() && editDraft.msgId <= 0) {
 		auto i = _draftsMap.find(peer);
 		if (i != _draftsMap.cend()) {
@@ -3242,6 +3668,7 @@ Storage::Cache::Database::Settings cacheSettings() {
 	result.totalSizeLimit = _cacheTotalSizeLimit;
 	result.totalTimeLimit = _cacheTotalTimeLimit;
 	result.maxDataSize = Storage::kMaxFileInMemory;
+	result.persistentTags = { Data::kStickerSetContentsCacheTag };
 	return result;
 }
 
@@ -3305,6 +3732,11 @@ public:
 			if (!_waveform.isEmpty()) {
 				voice->waveform = _waveform;
 				voice->wavemax = _wavemax;
+				_doc->owner().cache().put(
+					_doc->waveformCacheKey(),
+					Storage::Cache::Database::TaggedValue(
+						documentWaveformEncode5bit(_waveform),
+						Data::kVoiceMessageCacheTag));
 			}
 			if (voice->waveform.isEmpty()) {
 				voice->waveform.resize(1);
@@ -3332,22 +3764,181 @@ protected:
 
 };
 
+void setWaveformCounting(not_null<VoiceData*> voice, TaskId taskId) {
+	voice->waveform.resize(1 + sizeof(TaskId));
+	voice->waveform[0] = -1; // counting
+	memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
+}
+
 void countVoiceWaveform(DocumentData *document) {
-	if (const auto voice = document->voice()) {
-		if (_localLoader) {
-			voice->waveform.resize(1 + sizeof(TaskId));
-			voice->waveform[0] = -1; // counting
-			TaskId taskId = _localLoader->addTask(
-				std::make_unique<CountWaveformTask>(document));
-			memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
-		}
+	const auto voice = document->voice();
+	if (!voice || !_waveformLoader) {
+		return;
 	}
+
+	// Look for a waveform counted before, no task is started until then.
+	setWaveformCounting(voice, TaskId());
+	auto done = [=](QByteArray &&value) {
+		crl::on_main(&document->session(), [=, value = std::move(value)] {
+			const auto voice = document->voice();
+			if (!voice
+				|| voice->waveform.isEmpty()
+				|| voice->waveform[0] != -1) {
+				return;
+			}
+			auto waveform = documentWaveformDecode(value);
+			if (!waveform.isEmpty()) {
+				voice->wavemax = *ranges::max_element(waveform);
+				voice->waveform = std::move(waveform);
+				document->owner().requestDocumentViewRepaint(document);
+			} else if (_waveformLoader) {
+				setWaveformCounting(
+					voice,
+					_waveformLoader->addTask(
+						std::make_unique<CountWaveformTask>(document)));
+			}
+		});
+	};
+	document->owner().cache().get(
+		document->waveformCacheKey(),
+		std::move(done));
 }
 
 void cancelTask(TaskId id) {
 	if (_localLoader) {
 		_localLoader->cancelTask(id);
 	}
+	if (_waveformLoader) {
+		_waveformLoader->cancelTask(id);
+	}
+}
+
+int32 countDocumentVectorHash(const QVector<DocumentData*> vector);
+
+uint64 _stickerSetSignature(const Stickers::Set &set) {
+	const auto result = (uint64(uint32(set.hash)) << 32)
+		| uint64(uint32(countDocumentVectorHash(set.stickers)));
+	return result ? result : 1;
+}
+
+bool _stickerSetHasContents(const Stickers::Set &set) {
+	return !set.stickers.isEmpty()
+		|| (_storedStickerSets.find(set.id) != end(_storedStickerSets));
+}
+
+bool _stickerSetStoredSeparately(const Stickers::Set &set) {
+	return !(set.flags & MTPDstickerSet_ClientFlag::f_special)
+		&& _stickerSetHasContents(set);
+}
+
+quint32 _stickerSetContentsSize(const Stickers::Set &set) {
+	auto result = quint32(0);
+	for (const auto sticker : set.stickers) {
+		sticker->refreshStickerThumbFileReference();
+		result += Serialize::Document::sizeInStream(sticker);
+	}
+
+	result += sizeof(qint32); // datesCount
+	if (!set.dates.empty()) {
+		Assert(set.stickers.size() == set.dates.size());
+		result += set.dates.size() * sizeof(qint32);
+	}
+
+	result += sizeof(qint32); // emojiCount
+	for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
+		result += Serialize::stringSize(j.key()->id()) + sizeof(qint32) + (j->size() * sizeof(quint64));
+	}
+	return result;
+}
+
+void _writeStickerSetContents(QDataStream &stream, const Stickers::Set &set) {
+	for (const auto &sticker : set.stickers) {
+		Serialize::Document::writeToStream(stream, sticker);
+	}
+	stream << qint32(set.dates.size());
+	if (!set.dates.empty()) {
+		Assert(set.dates.size() == set.stickers.size());
+		for (const auto date : set.dates) {
+			stream << qint32(date);
+		}
+	}
+	stream << qint32(set.emoji.size());
+	for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
+		stream << j.key()->id() << qint32(j->size());
+		for (const auto sticker : *j) {
+			stream << quint64(sticker->id);
+		}
+	}
+}
+
+// Puts the set contents to the cache database if they were changed,
+// returns the signature of the stored contents.
+uint64 _storeStickerSetContents(const Stickers::Set &set) {
+	const auto i = _storedStickerSets.find(set.id);
+	if (set.stickers.isEmpty()) {
+		// Not read from the cache database yet.
+		Assert(i != end(_storedStickerSets));
+		return i->second;
+	}
+	const auto signature = _stickerSetSignature(set);
+	if (i != end(_storedStickerSets) && i->second == signature) {
+		return signature;
+	}
+
+	auto contents = QByteArray();
+	contents.reserve(sizeof(qint32) * 2
+		+ sizeof(quint64)
+		+ _stickerSetContentsSize(set));
+	{
+		QDataStream stream(&contents, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< qint32(kStickerSetContentsVersion)
+			<< qint32(AppVersion)
+			<< quint64(signature);
+		_writeStickerSetContents(stream, set);
+	}
+	_stickerSetsBytesWritten += contents.size();
+	Auth().data().cache().put(
+		Data::StickerSetCacheKey(set.id),
+		Storage::Cache::Database::TaggedValue(
+			std::move(contents),
+			Data::kStickerSetContentsCacheTag));
+	_storedStickerSets[set.id] = signature;
+	return signature;
+}
+
+// The contents tag is persistent in the cache database, so the entry
+// should be removed explicitly when the contents are not used anymore.
+void _forgetStickerSetContents(uint64 setId) {
+	_storedStickerSets.remove(setId);
+	Auth().data().cache().remove(Data::StickerSetCacheKey(setId));
+}
+
+bool _stickerSetContentsReferenced(uint64 setId) {
+	for (const auto &[key, sets] : _stickerSetsInFiles) {
+		if (sets.contains(setId)) {
+			return true;
+		}
+	}
+
+	// Archived stickers file is read only when it is needed.
+	const auto &sets = Auth().data().stickerSets();
+	const auto i = sets.constFind(setId);
+	return (i != sets.cend())
+		&& (i->flags & MTPDstickerSet::Flag::f_archived);
+}
+
+void _setStickerSetsInFile(
+		const FileKey &stickersKey,
+		base::flat_set<uint64> &&setIds) {
+	auto was = base::take(_stickerSetsInFiles[&stickersKey]);
+	_stickerSetsInFiles[&stickersKey] = std::move(setIds);
+	for (const auto setId : was) {
+		if (!_stickerSetContentsReferenced(setId)) {
+			_forgetStickerSetContents(setId);
+		}
+	}
 }
 
 void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
@@ -3368,28 +3959,15 @@ void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
 	if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) {
 		writeInfo(-set.count);
 		return;
-	} else if (set.stickers.isEmpty()) {
+	} else if (_stickerSetStoredSeparately(set)) {
+		writeInfo(set.stickers.isEmpty() ? set.count : set.stickers.size());
+		stream << quint64(_storeStickerSetContents(set));
 		return;
 	}
 
 	writeInfo(set.stickers.size());
-	for (const auto &sticker : set.stickers) {
-		Serialize::Document::writeToStream(stream, sticker);
-	}
-	stream << qint32(set.dates.size());
-	if (!set.dates.empty()) {
-		Assert(set.dates.size() == set.stickers.size());
-		for (const auto date : set.dates) {
-			stream << qint32(date);
-		}
-	}
-	stream << qint32(set.emoji.size());
-	for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
-		stream << j.key()->id() << qint32(j->size());
-		for (const auto sticker : *j) {
-			stream << quint64(sticker->id);
-		}
-	}
+	stream << quint64(0);
+	_writeStickerSetContents(stream, set);
 }
 
 // In generic method _writeStickerSets() we look through all the sets and call a
@@ -3405,6 +3983,8 @@ template <typename CheckSet>
 void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::Order &order) {
 	if (!_working()) return;
 
+	const auto stall = WriteStallTimer("_writeStickerSets");
+
 	const auto &sets = Auth().data().stickerSets();
 	if (sets.isEmpty()) {
 		if (stickersKey) {
@@ -3412,6 +3992,7 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 			stickersKey = 0;
 			_mapChanged = true;
 		}
+		_setStickerSetsInFile(stickersKey, {});
 		_writeMap();
 		return;
 	}
@@ -3440,20 +4021,9 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 			continue;
 		}
 
-		for (const auto sticker : set.stickers) {
-			sticker->refreshStickerThumbFileReference();
-			size += Serialize::Document::sizeInStream(sticker);
-		}
-
-		size += sizeof(qint32); // datesCount
-		if (!set.dates.empty()) {
-			Assert(set.stickers.size() == set.dates.size());
-			size += set.dates.size() * sizeof(qint32);
-		}
-
-		size += sizeof(qint32); // emojiCount
-		for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
-			size += Serialize::stringSize(j.key()->id()) + sizeof(qint32) + (j->size() * sizeof(quint64));
+		size += sizeof(quint64); // contents signature
+		if (!_stickerSetStoredSeparately(set)) {
+			size += _stickerSetContentsSize(set);
 		}
 
 		++setsCount;
@@ -3464,6 +4034,7 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 			stickersKey = 0;
 			_mapChanged = true;
 		}
+		_setStickerSetsInFile(stickersKey, {});
 		_writeMap();
 		return;
 	}
@@ -3474,11 +4045,13 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 		_mapChanged = true;
 		_writeMap(WriteMapWhen::Fast);
 	}
+	const auto contentsWrittenBefore = _stickerSetsBytesWritten;
 	EncryptedDescriptor data(size);
 	data.stream
 		<< quint32(kStickersVersionTag)
 		<< qint32(kStickersSerializeVersion)
 		<< qint32(setsCount);
+	auto storedSets = base::flat_set<uint64>();
 	for (const auto &set : sets) {
 		auto result = checkSet(set);
 		if (result == StickerSetCheckResult::Abort) {
@@ -3487,14 +4060,107 @@ void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::
 			continue;
 		}
 		_writeStickerSet(data.stream, set);
+		if (_storedStickerSets.contains(set.id)) {
+			storedSets.emplace(set.id);
+		}
 	}
 	data.stream << order;
 
 	FileWriteDescriptor file(stickersKey);
 	file.writeEncrypted(data);
+	_setStickerSetsInFile(stickersKey, std::move(storedSets));
+
+	DEBUG_LOG(("App Info: sticker sets written, "
+		"%1 bytes of info, %2 bytes of changed contents"
+		).arg(data.data.size()
+		).arg(_stickerSetsBytesWritten - contentsWrittenBefore));
+}
+
+// Reads the contents written by _writeStickerSetContents(),
+// the set is filled only if it didn't have stickers before.
+bool _readStickerSetContents(QDataStream &stream, int32 streamVersion, Stickers::Set &set, int32 scnt) {
+	const auto fillStickers = set.stickers.isEmpty();
+	if (fillStickers) {
+		set.stickers.reserve(scnt);
+		set.count = 0;
+	}
+
+	auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
+	Serialize::Document::StickerSetInfo info(set.id, set.access, set.shortName);
+	base::flat_set<DocumentId> read;
+	for (int32 j = 0; j < scnt; ++j) {
+		auto document = Serialize::Document::readStickerFromStream(streamVersion, stream, info);
+		if (!_checkStreamStatus(stream)) {
+			return false;
+		} else if (!document
+			|| !document->sticker()
+			|| read.contains(document->id)) {
+			continue;
+		}
+		read.emplace(document->id);
+		if (fillStickers) {
+			set.stickers.push_back(document);
+			if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
+				if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
+					document->sticker()->set = inputSet;
+				}
+			}
+			++set.count;
+		}
+	}
+
+	qint32 datesCount = 0;
+	stream >> datesCount;
+	if (datesCount > 0) {
+		if (datesCount != scnt) {
+			return false;
+		}
+		const auto fillDates = (set.id == Stickers::CloudRecentSetId)
+			&& (set.stickers.size() == datesCount);
+		if (fillDates) {
+			set.dates.clear();
+			set.dates.reserve(datesCount);
+		}
+		for (auto i = 0; i != datesCount; ++i) {
+			qint32 date = 0;
+			stream >> date;
+			if (fillDates) {
+				set.dates.push_back(TimeId(date));
+			}
+		}
+	}
+
+	qint32 emojiCount = 0;
+	stream >> emojiCount;
+	if (!_checkStreamStatus(stream) || emojiCount < 0) {
+		return false;
+	}
+	for (int32 j = 0; j < emojiCount; ++j) {
+		QString emojiString;
+		qint32 stickersCount;
+		stream >> emojiString >> stickersCount;
+		Stickers::Pack pack;
+		pack.reserve(stickersCount);
+		for (int32 k = 0; k < stickersCount; ++k) {
+			quint64 id;
+			stream >> id;
+			const auto doc = Auth().data().document(id);
+			if (!doc->sticker()) continue;
+
+			pack.push_back(doc);
+		}
+		if (fillStickers) {
+			if (auto emoji = Ui::Emoji::Find(emojiString)) {
+				emoji = emoji->original();
+				set.emoji.insert(emoji, pack);
+			}
+		}
+	}
+	return true;
 }
 
 void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr, MTPDstickerSet::Flags readingFlags = 0) {
+	const auto started = crl::now();
 	FileReadDescriptor stickers;
 	if (!readEncryptedFile(stickers, stickersKey)) {
 		clearKey(stickersKey);
@@ -3586,7 +4252,6 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 				setThumbnail.isNull() ? ImagePtr() : Images::Create(setThumbnail)));
 		}
 		auto &set = it.value();
-		auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
 		const auto fillStickers = set.stickers.isEmpty();
 
 		if (scnt < 0) { // disabled not loaded set
@@ -3596,80 +4261,19 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			continue;
 		}
 
-		if (fillStickers) {
-			set.stickers.reserve(scnt);
-			set.count = 0;
-		}
-
-		Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
-		base::flat_set<DocumentId> read;
-		for (int32 j = 0; j < scnt; ++j) {
-			auto document = Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
-			if (!_checkStreamStatus(stickers.stream)) {
-				return failed();
-			} else if (!document
-				|| !document->sticker()
-				|| read.contains(document->id)) {
-				continue;
-			}
-			read.emplace(document->id);
-			if (fillStickers) {
-				set.stickers.push_back(document);
-				if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
-					if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
-						document->sticker()->set = inputSet;
-					}
-				}
-				++set.count;
-			}
+		quint64 signature = 0;
+		if (version > 1) {
+			stickers.stream >> signature;
 		}
-
-		qint32 datesCount = 0;
-		stickers.stream >> datesCount;
-		if (datesCount > 0) {
-			if (datesCount != scnt) {
-				return failed();
-			}
-			const auto fillDates = (set.id == Stickers::CloudRecentSetId)
-				&& (set.stickers.size() == datesCount);
-			if (fillDates) {
-				set.dates.clear();
-				set.dates.reserve(datesCount);
-			}
-			for (auto i = 0; i != datesCount; ++i) {
-				qint32 date = 0;
-				stickers.stream >> date;
-				if (fillDates) {
-					set.dates.push_back(TimeId(date));
-				}
-			}
-		}
-
-		qint32 emojiCount = 0;
-		stickers.stream >> emojiCount;
-		if (!_checkStreamStatus(stickers.stream) || emojiCount < 0) {
-			return failed();
-		}
-		for (int32 j = 0; j < emojiCount; ++j) {
-			QString emojiString;
-			qint32 stickersCount;
-			stickers.stream >> emojiString >> stickersCount;
-			Stickers::Pack pack;
-			pack.reserve(stickersCount);
-			for (int32 k = 0; k < stickersCount; ++k) {
-				quint64 id;
-				stickers.stream >> id;
-				const auto doc = Auth().data().document(id);
-				if (!doc->sticker()) continue;
-
-				pack.push_back(doc);
-			}
+		if (signature) {
 			if (fillStickers) {
-				if (auto emoji = Ui::Emoji::Find(emojiString)) {
-					emoji = emoji->original();
-					set.emoji.insert(emoji, pack);
-				}
+				set.count = scnt;
+				_storedStickerSets[set.id] = signature;
 			}
+			_stickerSetsInFiles[&stickersKey].emplace(set.id);
+			continue;
+		} else if (!_readStickerSetContents(stickers.stream, stickers.version, set, scnt)) {
+			return failed();
 		}
 	}
 
@@ -3694,6 +4298,10 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 			}
 		}
 	}
+	DEBUG_LOG(("App Info: %1 sticker sets read in %2 ms, %3 bytes"
+		).arg(count
+		).arg(crl::now() - started
+		).arg(stickers.data.size()));
 }
 
 void writeInstalledStickers() {
@@ -3710,7 +4318,7 @@ void writeInstalledStickers() {
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) { // waiting to receive
 			return StickerSetCheckResult::Abort;
-		} else if (set.stickers.isEmpty()) {
+		} else if (!_stickerSetHasContents(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3729,7 +4337,7 @@ void writeFeaturedStickers() {
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) { // waiting to receive
 			return StickerSetCheckResult::Abort;
-		} else if (set.stickers.isEmpty()) {
+		} else if (!_stickerSetHasContents(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3762,7 +4370,7 @@ void writeArchivedStickers() {
 	if (!Global::started()) return;
 
 	_writeStickerSets(_archivedStickersKey, [](const Stickers::Set &set) {
-		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || set.stickers.isEmpty()) {
+		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || !_stickerSetHasContents(set)) {
 			return StickerSetCheckResult::Skip;
 		}
 		return StickerSetCheckResult::Write;
@@ -3887,6 +4495,11 @@ void readInstalledStickers() {
 		_installedStickersKey,
 		&Auth().data().stickerSetsOrderRef(),
 		MTPDstickerSet::Flag::f_installed_date);
+
+	// Emoji suggestions need the contents of all installed sets.
+	for (const auto setId : Auth().data().stickerSetsOrder()) {
+		loadStickerSet(setId);
+	}
 }
 
 void readFeaturedStickers() {
@@ -3922,6 +4535,90 @@ void readArchivedStickers() {
 	}
 }
 
+bool _applyStickerSetContents(
+		uint64 setId,
+		uint64 signature,
+		const QByteArray &value) {
+	const auto i = _storedStickerSets.find(setId);
+	if (i == end(_storedStickerSets) || i->second != signature) {
+		return false;
+	}
+	auto &sets = Auth().data().stickerSetsRef();
+	const auto it = sets.find(setId);
+	if (it == sets.end() || !it->stickers.isEmpty()) {
+		return false;
+	}
+	auto &set = it.value();
+
+	QDataStream stream(value);
+	stream.setVersion(QDataStream::Qt_5_1);
+	qint32 contentsVersion = 0, streamVersion = 0;
+	quint64 storedSignature = 0;
+	stream >> contentsVersion >> streamVersion >> storedSignature;
+	const auto count = set.count;
+	const auto loaded = _checkStreamStatus(stream)
+		&& (contentsVersion == kStickerSetContentsVersion)
+		&& (storedSignature == signature)
+		&& _readStickerSetContents(stream, streamVersion, set, count)
+		&& !set.stickers.isEmpty();
+	if (!loaded) {
+		LOG(("App Error: could not read sticker set %1 contents."
+			).arg(setId));
+		_forgetStickerSetContents(setId);
+		set.stickers.clear();
+		set.dates.clear();
+		set.emoji.clear();
+		set.count = count;
+		Auth().api().scheduleStickerSetRequest(set.id, set.access);
+		Auth().api().requestStickerSets();
+		return false;
+	}
+	set.flags &= ~MTPDstickerSet_ClientFlag::f_not_loaded;
+	return true;
+}
+
+bool loadStickerSet(uint64 setId) {
+	const auto i = _storedStickerSets.find(setId);
+	if (i == end(_storedStickerSets)) {
+		return false;
+	} else if (_stickerSetsLoading.contains(setId)) {
+		return true;
+	}
+	const auto &sets = Auth().data().stickerSets();
+	const auto it = sets.constFind(setId);
+	if (it == sets.cend() || uint32(it->hash) != uint32(i->second >> 32)) {
+		// The stored contents are outdated.
+		_forgetStickerSetContents(setId);
+		return false;
+	} else if (!it->stickers.isEmpty()) {
+		return false;
+	}
+	const auto signature = i->second;
+	const auto started = crl::now();
+	_stickerSetsLoading.emplace(setId);
+
+	auto done = [=](QByteArray &&value) {
+		crl::on_main(&Auth(), [=, value = std::move(value)] {
+			_stickerSetsLoading.remove(setId);
+			if (_applyStickerSetContents(setId, signature, value)) {
+				DEBUG_LOG(("App Info: sticker set %1 contents read in %2 ms"
+					).arg(setId
+					).arg(crl::now() - started));
+				_stickerSetsLoaded = true;
+			}
+
+			// Sets are usually requested together, refresh them once.
+			if (_stickerSetsLoading.empty() && base::take(_stickerSetsLoaded)) {
+				Auth().data().notifyStickersUpdated();
+			}
+		});
+	};
+	Auth().data().cache().get(
+		Data::StickerSetCacheKey(setId),
+		std::move(done));
+	return true;
+}
+
 int32 countDocumentVectorHash(const QVector<DocumentData*> vector) {
 	uint32 acc = 0;
 	for_const (auto doc, vector) {
@@ -4706,6 +5403,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		&& settings.media.sizeLimit == check.media.sizeLimit
 		&& settings.path == check.path
 		&& settings.format == check.format
+		&& settings.archive == check.archive
 		&& settings.availableAt == check.availableAt
 		&& !settings.onlySinglePeer()) {
 		if (_exportSettingsKey) {
@@ -4722,7 +5420,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		}
 		quint32 size = sizeof(quint32) * 6
 			+ Serialize::stringSize(settings.path)
-			+ sizeof(qint32) * 2 + sizeof(quint64);
+			+ sizeof(qint32) * 3 + sizeof(quint64);
 		EncryptedDescriptor data(size);
 		data.stream
 			<< quint32(settings.types)
@@ -4751,6 +5449,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		});
 		data.stream << qint32(settings.singlePeerFrom);
 		data.stream << qint32(settings.singlePeerTill);
+		data.stream << qint32(settings.archive ? 1 : 0);
 
 		FileWriteDescriptor file(_exportSettingsKey);
 		file.writeEncrypted(data);
@@ -4773,6 +5472,7 @@ Export::Settings ReadExportSettings() {
 	qint32 singlePeerType = 0, singlePeerBareId = 0;
 	quint64 singlePeerAccessHash = 0;
 	qint32 singlePeerFrom = 0, singlePeerTill = 0;
+	qint32 archive = 0;
 	file.stream
 		>> types
 		>> fullChats
@@ -4797,12 +5497,16 @@ Export::Settings ReadExportSettings() {
 	if (!file.stream.atEnd()) {
 		file.stream >> singlePeerFrom >> singlePeerTill;
 	}
+	if (!file.stream.atEnd()) {
+		file.stream >> archive;
+	}
 	auto result = Export::Settings();
 	result.types = Export::Settings::Types::from_raw(types);
 	result.fullChats = Export::Settings::Types::from_raw(fullChats);
 	result.media.types = Export::MediaSettings::Types::from_raw(mediaTypes);
 	result.media.sizeLimit = mediaSizeLimit;
 	result.format = Export::Output::Format(format);
+	result.archive = (archive == 1);
 	result.path = path;
 	result.availableAt = availableAt;
 	result.singlePeer = [&] {
@@ -5112,6 +5816,8 @@ bool ClearManager::hasTask(ClearManagerTask task) {
 }
 
 void ClearManager::start() {
+	_writer.finish();
+
 	moveToThread(data->thread);
 	connect(data->thread, SIGNAL(started()), this, SLOT(onStart()));
 	connect(data->thread, SIGNAL(finished()), data->thread, SLOT(deleteLater()));
@@ -88,6 +88,10 @@ enum ReadMapState {
 	ReadMapPassNeeded = 2,
 };
 ReadMapState readMap(const QByteArray &pass);
+
+// Drops the files read in background by readMap() that were not used.
+void dropPrefetchedFiles();
+
 int32 oldMapVersion();
 
 int32 oldSettingsVersion();
@@ -136,6 +140,11 @@ void readFeaturedStickers();
 void readRecentStickers();
 void readFavedStickers();
 void readArchivedStickers();
+
+// Starts reading the set contents stored in the cache database and
+// returns true, returns false if there are no up to date contents.
+bool loadStickerSet(uint64 setId);
+
 int32 countStickersHash(bool checkOutdatedInfo = false);
 int32 countRecentStickersHash();
 int32 countFavedStickersHash();
@@ -21,6 +21,12 @@ namespace {
 // After 128 MB of unpacked images we try to clear some memory.
 constexpr auto kMemoryForCache = 128 * 1024 * 1024;
 
+// After 64 MB of prepared pixmaps we drop the least recently used ones.
+constexpr auto kMemoryForPixmaps = 64 * 1024 * 1024;
+
+// Pixmaps painted during the last second are considered visible.
+constexpr auto kVisiblePixmapTimeout = crl::time(1000);
+
 QMap<QString, Image*> LocalFileImages;
 QMap<QString, Image*> WebUrlImages;
 QMap<StorageKey, Image*> StorageImages;
@@ -56,6 +62,245 @@ uint64 SinglePixKey(Options options) {
 	return PixKey(0, 0, options);
 }
 
+Options RoundOptions(ImageRoundRadius radius, RectParts corners) {
+	const auto cornerOptions = [&] {
+		return (corners & RectPart::TopLeft ? Option::RoundedTopLeft : Option::None)
+			| (corners & RectPart::TopRight ? Option::RoundedTopRight : Option::None)
+			| (corners & RectPart::BottomLeft ? Option::RoundedBottomLeft : Option::None)
+			| (corners & RectPart::BottomRight ? Option::RoundedBottomRight : Option::None);
+	};
+	if (radius == ImageRoundRadius::Large) {
+		return Option::RoundedLarge | cornerOptions();
+	} else if (radius == ImageRoundRadius::Small) {
+		return Option::RoundedSmall | cornerOptions();
+	} else if (radius == ImageRoundRadius::Ellipse) {
+		return Option::Circled | cornerOptions();
+	}
+	return Option::None;
+}
+
+class PixmapCache {
+public:
+	explicit PixmapCache(int64 limit);
+
+	const QPixmap *find(
+		not_null<const Image*> image,
+		uint64 key,
+		QSize size = QSize());
+	const QPixmap &insert(
+		not_null<const Image*> image,
+		uint64 key,
+		QPixmap &&pixmap);
+	void remove(not_null<const Image*> image);
+	void clear();
+
+	// Runs the preparation on a background thread, the result is put
+	// to the cache unless the image was unloaded or a different size
+	// was requested for the same key in the meantime.
+	void prepare(
+		not_null<const Image*> image,
+		uint64 key,
+		QSize size,
+		Fn<QImage()> method);
+
+	PixmapCacheStats stats() const;
+
+private:
+	struct Key {
+		const Image *image = nullptr;
+		uint64 key = 0;
+
+		inline bool operator<(const Key &other) const {
+			return (image < other.image)
+				|| (image == other.image && key < other.key);
+		}
+	};
+	struct Entry {
+		Key key;
+		QPixmap pixmap;
+		int64 usage = 0;
+		crl::time lastUsed = 0;
+	};
+	struct Preparing {
+		uint64 id = 0;
+		QSize size;
+	};
+	using Queue = std::list<Entry>;
+
+	void erase(std::map<Key, Queue::iterator>::iterator i);
+	void prepared(Key key, uint64 id, QImage &&image);
+	void check();
+
+	Queue _queue;
+	std::map<Key, Queue::iterator> _map;
+	std::map<Key, Preparing> _preparing;
+	uint64 _preparingId = 0;
+	SingleQueuedInvokation _delayed;
+	int64 _usage = 0;
+	int64 _limit = 0;
+	int64 _hits = 0;
+	int64 _misses = 0;
+	int64 _evicted = 0;
+	int64 _evictedUsage = 0;
+	int64 _preparedAsync = 0;
+
+};
+
+PixmapCache::PixmapCache(int64 limit)
+: _delayed([=] { check(); })
+, _limit(limit) {
+}
+
+const QPixmap *PixmapCache::find(
+		not_null<const Image*> image,
+		uint64 key,
+		QSize size) {
+	const auto i = _map.find({ image, key });
+	if (i == end(_map)
+		|| (size.isValid() && i->second->pixmap.size() != size)) {
+		return nullptr;
+	}
+	++_hits;
+	const auto entry = i->second;
+	entry->lastUsed = crl::now();
+	_queue.splice(end(_queue), _queue, entry);
+	return &entry->pixmap;
+}
+
+const QPixmap &PixmapCache::insert(
+		not_null<const Image*> image,
+		uint64 key,
+		QPixmap &&pixmap) {
+	++_misses;
+	auto i = _map.find({ image, key });
+	if (i == end(_map)) {
+		const auto entry = _queue.insert(end(_queue), Entry{ { image, key } });
+		i = _map.emplace(entry->key, entry).first;
+	} else {
+		// The caller of find() may still hold a reference to the previous
+		// pixmap, so the entry is updated in place instead of replacing.
+		_usage -= i->second->usage;
+		ActiveCache().decrement(i->second->usage);
+		_queue.splice(end(_queue), _queue, i->second);
+	}
+	const auto entry = i->second;
+	const auto usage = ComputeUsage(pixmap);
+	entry->pixmap = std::move(pixmap);
+	entry->usage = usage;
+	entry->lastUsed = crl::now();
+	_usage += usage;
+	ActiveCache().increment(usage);
+	if (_usage > _limit) {
+		// The caller holds a reference to the result until it paints,
+		// so we never evict synchronously.
+		_delayed.call();
+	}
+	return entry->pixmap;
+}
+
+void PixmapCache::remove(not_null<const Image*> image) {
+	auto i = _map.lower_bound({ image, 0 });
+	while (i != end(_map) && i->first.image == image.get()) {
+		erase(i++);
+	}
+	auto j = _preparing.lower_bound({ image, 0 });
+	while (j != end(_preparing) && j->first.image == image.get()) {
+		j = _preparing.erase(j);
+	}
+}
+
+void PixmapCache::clear() {
+	ActiveCache().decrement(base::take(_usage));
+	_queue.clear();
+	_map.clear();
+	_preparing.clear();
+}
+
+void PixmapCache::prepare(
+		not_null<const Image*> image,
+		uint64 key,
+		QSize size,
+		Fn<QImage()> method) {
+	const auto full = Key{ image, key };
+	const auto i = _preparing.find(full);
+	if (i != end(_preparing) && i->second.size == size) {
+		return;
+	}
+	const auto id = ++_preparingId;
+	_preparing[full] = Preparing{ id, size };
+	crl::async([=, method = std::move(method)] {
+		auto result = method();
+		crl::on_main([=, result = std::move(result)]() mutable {
+			prepared(full, id, std::move(result));
+		});
+	});
+}
+
+void PixmapCache::prepared(Key key, uint64 id, QImage &&image) {
+	const auto i = _preparing.find(key);
+	if (i == end(_preparing) || i->second.id != id) {
+		return;
+	}
+	_preparing.erase(i);
+	++_preparedAsync;
+
+	auto pixmap = App::pixmapFromImageInPlace(std::move(image));
+	pixmap.setDevicePixelRatio(cRetinaFactor());
+	insert(key.image, key.key, std::move(pixmap));
+	if (AuthSession::Exists()) {
+		Auth().downloaderTaskFinished().notify();
+	}
+}
+
+void PixmapCache::erase(std::map<Key, Queue::iterator>::iterator i) {
+	const auto usage = i->second->usage;
+	_usage -= usage;
+	ActiveCache().decrement(usage);
+	_queue.erase(i->second);
+	_map.erase(i);
+}
+
+void PixmapCache::check() {
+	const auto visible = crl::now() - kVisiblePixmapTimeout;
+	const auto wasEvicted = _evicted;
+	const auto wasUsage = _usage;
+	while (_usage > _limit && !_queue.empty()) {
+		const auto &entry = _queue.front();
+		if (entry.lastUsed > visible) {
+			// All the rest were painted even later.
+			break;
+		}
+		++_evicted;
+		_evictedUsage += entry.usage;
+		erase(_map.find(entry.key));
+	}
+	if (_evicted != wasEvicted) {
+		DEBUG_LOG(("Images Info: evicted %1 pixmaps, %2 -> %3 bytes."
+			).arg(_evicted - wasEvicted
+			).arg(wasUsage
+			).arg(_usage));
+	}
+}
+
+PixmapCacheStats PixmapCache::stats() const {
+	auto result = PixmapCacheStats();
+	result.usage = _usage;
+	result.limit = _limit;
+	result.count = int(_queue.size());
+	result.hits = _hits;
+	result.misses = _misses;
+	result.evicted = _evicted;
+	result.evictedUsage = _evictedUsage;
+	result.preparing = int(_preparing.size());
+	result.preparedAsync = _preparedAsync;
+	return result;
+}
+
+[[nodiscard]] PixmapCache &Pixmaps() {
+	static auto Instance = PixmapCache(kMemoryForPixmaps);
+	return Instance;
+}
+
 } // namespace
 
 void ClearRemote() {
@@ -73,7 +318,13 @@ void ClearRemote() {
 	}
 }
 
+PixmapCacheStats GetPixmapCacheStats() {
+	return Pixmaps().stats();
+}
+
 void ClearAll() {
+	// The pixmaps must be destroyed while QApplication is still alive.
+	Pixmaps().clear();
 	ActiveCache().clear();
 	for (auto image : base::take(LocalFileImages)) {
 		delete image;
@@ -386,15 +637,13 @@ const QPixmap &Image::pix(
         h *= cIntRetinaFactor();
     }
 	auto options = Option::Smooth | Option::None;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-        p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixRounded(
@@ -412,28 +661,14 @@ const QPixmap &Image::pixRounded(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::None;
-	auto cornerOptions = [](RectParts corners) {
-		return (corners & RectPart::TopLeft ? Option::RoundedTopLeft : Option::None)
-			| (corners & RectPart::TopRight ? Option::RoundedTopRight : Option::None)
-			| (corners & RectPart::BottomLeft ? Option::RoundedBottomLeft : Option::None)
-			| (corners & RectPart::BottomRight ? Option::RoundedBottomRight : Option::None);
-	};
-	if (radius == ImageRoundRadius::Large) {
-		options |= Option::RoundedLarge | cornerOptions(corners);
-	} else if (radius == ImageRoundRadius::Small) {
-		options |= Option::RoundedSmall | cornerOptions(corners);
-	} else if (radius == ImageRoundRadius::Ellipse) {
-		options |= Option::Circled | cornerOptions(corners);
-	}
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	options |= RoundOptions(radius, corners);
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixCircled(
@@ -449,15 +684,13 @@ const QPixmap &Image::pixCircled(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Circled;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredCircled(
@@ -473,15 +706,13 @@ const QPixmap &Image::pixBlurredCircled(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Circled | Option::Blurred;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurred(
@@ -497,15 +728,13 @@ const QPixmap &Image::pixBlurred(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Blurred;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixColored(
@@ -522,15 +751,13 @@ const QPixmap &Image::pixColored(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Colored;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixColoredNoCache(origin, add, w, h, true);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixColoredNoCache(origin, add, w, h, true);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredColored(
@@ -547,15 +774,13 @@ const QPixmap &Image::pixBlurredColored(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Blurred | Option::Smooth | Option::Colored;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixBlurredColoredNoCache(origin, add, w, h);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = Pixmaps().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixBlurredColoredNoCache(origin, add, w, h);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixSingle(
@@ -577,38 +802,58 @@ const QPixmap &Image::pixSingle(
 	}
 
 	auto options = Option::Smooth | Option::None;
-	auto cornerOptions = [](RectParts corners) {
-		return (corners & RectPart::TopLeft ? Option::RoundedTopLeft : Option::None)
-			| (corners & RectPart::TopRight ? Option::RoundedTopRight : Option::None)
-			| (corners & RectPart::BottomLeft ? Option::RoundedBottomLeft : Option::None)
-			| (corners & RectPart::BottomRight ? Option::RoundedBottomRight : Option::None);
-	};
-	if (radius == ImageRoundRadius::Large) {
-		options |= Option::RoundedLarge | cornerOptions(corners);
-	} else if (radius == ImageRoundRadius::Small) {
-		options |= Option::RoundedSmall | cornerOptions(corners);
-	} else if (radius == ImageRoundRadius::Ellipse) {
-		options |= Option::Circled | cornerOptions(corners);
-	}
+	options |= RoundOptions(radius, corners);
 	if (colored) {
 		options |= Option::Colored;
 	}
+	return pixSingleCached(origin, w, h, options, outerw, outerh, colored);
+}
 
-	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+const QPixmap &Image::pixBlurredSingle(
+		Data::FileOrigin origin,
+		int32 w,
+		int32 h,
+		int32 outerw,
+		int32 outerh,
+		ImageRoundRadius radius,
+		RectParts corners) const {
+	checkSource();
+
+	if (w <= 0 || !width() || !height()) {
+		w = width() * cIntRetinaFactor();
+	} else {
+		w *= cIntRetinaFactor();
+		h *= cIntRetinaFactor();
 	}
-	return i.value();
+
+	auto options = Option::Smooth | Option::Blurred;
+	options |= RoundOptions(radius, corners);
+	return pixSingleCached(origin, w, h, options, outerw, outerh);
 }
 
-const QPixmap &Image::pixBlurredSingle(
+QPixmap Image::pixSingleAsync(
+		Data::FileOrigin origin,
+		int32 w,
+		int32 h,
+		int32 outerw,
+		int32 outerh,
+		ImageRoundRadius radius,
+		RectParts corners) const {
+	checkSource();
+
+	if (w <= 0 || !width() || !height()) {
+		w = width() * cIntRetinaFactor();
+	} else {
+		w *= cIntRetinaFactor();
+		h *= cIntRetinaFactor();
+	}
+
+	auto options = Option::Smooth | Option::None;
+	options |= RoundOptions(radius, corners);
+	return pixSingleAsync(origin, w, h, options, outerw, outerh);
+}
+
+QPixmap Image::pixBlurredSingleAsync(
 		Data::FileOrigin origin,
 		int32 w,
 		int32 h,
@@ -626,32 +871,56 @@ const QPixmap &Image::pixBlurredSingle(
 	}
 
 	auto options = Option::Smooth | Option::Blurred;
-	auto cornerOptions = [](RectParts corners) {
-		return (corners & RectPart::TopLeft ? Option::RoundedTopLeft : Option::None)
-			| (corners & RectPart::TopRight ? Option::RoundedTopRight : Option::None)
-			| (corners & RectPart::BottomLeft ? Option::RoundedBottomLeft : Option::None)
-			| (corners & RectPart::BottomRight ? Option::RoundedBottomRight : Option::None);
-	};
-	if (radius == ImageRoundRadius::Large) {
-		options |= Option::RoundedLarge | cornerOptions(corners);
-	} else if (radius == ImageRoundRadius::Small) {
-		options |= Option::RoundedSmall | cornerOptions(corners);
-	} else if (radius == ImageRoundRadius::Ellipse) {
-		options |= Option::Circled | cornerOptions(corners);
+	options |= RoundOptions(radius, corners);
+	return pixSingleAsync(origin, w, h, options, outerw, outerh);
+}
+
+const QPixmap &Image::pixSingleCached(
+		Data::FileOrigin origin,
+		int w,
+		int h,
+		Options options,
+		int outerw,
+		int outerh,
+		const style::color *colored) const {
+	const auto k = SinglePixKey(options);
+	const auto size = QSize(outerw, outerh) * cIntRetinaFactor();
+	if (const auto cached = Pixmaps().find(this, k, size)) {
+		return *cached;
 	}
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return Pixmaps().insert(this, k, std::move(p));
+}
 
-	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+QPixmap Image::pixSingleAsync(
+		Data::FileOrigin origin,
+		int w,
+		int h,
+		Options options,
+		int outerw,
+		int outerh) const {
+	const auto k = SinglePixKey(options);
+	const auto size = QSize(outerw, outerh) * cIntRetinaFactor();
+	if (const auto cached = Pixmaps().find(this, k, size)) {
+		return *cached;
 	}
-	return i.value();
+	if (!loading()) {
+		const_cast<Image*>(this)->load(origin);
+	}
+	checkSource();
+
+	// Circle masks are cached as pixmaps, so they are prepared here.
+	if (_data.isNull() || isNull() || (options & Option::Circled)) {
+		return pixSingleCached(origin, w, h, options, outerw, outerh);
+	}
+	Pixmaps().prepare(this, k, size, [=, data = _data] {
+		return prepare(data, w, h, options, outerw, outerh, nullptr);
+	});
+	if (const auto previous = Pixmaps().find(this, k)) {
+		return *previous;
+	}
+	return QPixmap();
 }
 
 QPixmap Image::pixNoCache(
@@ -836,11 +1105,7 @@ void Image::setImageBytes(const QByteArray &bytes) {
 }
 
 void Image::invalidateSizeCache() const {
-	auto &cache = ActiveCache();
-	for (const auto &image : std::as_const(_sizesCache)) {
-		cache.decrement(ComputeUsage(image));
-	}
-	_sizesCache.clear();
+	Pixmaps().remove(this);
 }
 
 Image::~Image() {
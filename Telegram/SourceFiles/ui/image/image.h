@@ -15,6 +15,22 @@ namespace Images {
 void ClearRemote();
 void ClearAll();
 
+struct PixmapCacheStats {
+	int64 usage = 0;
+	int64 limit = 0;
+	int count = 0;
+	int64 hits = 0;
+	int64 misses = 0;
+	int64 evicted = 0;
+	int64 evictedUsage = 0;
+	int preparing = 0;
+	int64 preparedAsync = 0;
+};
+
+// Prepared pixmaps of all images share one memory budget, the least
+// recently used ones are dropped unless they were painted just now.
+[[nodiscard]] PixmapCacheStats GetPixmapCacheStats();
+
 ImagePtr Create(const QString &file, QByteArray format);
 ImagePtr Create(const QString &url, QSize box);
 ImagePtr Create(const QString &url, int width, int height);
@@ -145,6 +161,27 @@ public:
 		int32 outerh,
 		ImageRoundRadius radius,
 		RectParts corners = RectPart::AllCorners) const;
+
+	// Same as pixSingle(), but the pixmap is prepared on a background
+	// thread. Until it is ready the pixmap of the previous size is returned
+	// or a null one, then Auth().downloaderTaskFinished() is notified.
+	QPixmap pixSingleAsync(
+		Data::FileOrigin origin,
+		int32 w,
+		int32 h,
+		int32 outerw,
+		int32 outerh,
+		ImageRoundRadius radius,
+		RectParts corners = RectPart::AllCorners) const;
+	QPixmap pixBlurredSingleAsync(
+		Data::FileOrigin origin,
+		int32 w,
+		int32 h,
+		int32 outerw,
+		int32 outerh,
+		ImageRoundRadius radius,
+		RectParts corners = RectPart::AllCorners) const;
+
 	const QPixmap &pixCircled(
 		Data::FileOrigin origin,
 		int32 w = 0,
@@ -242,9 +279,23 @@ public:
 private:
 	void checkSource() const;
 	void invalidateSizeCache() const;
+	const QPixmap &pixSingleCached(
+		Data::FileOrigin origin,
+		int w,
+		int h,
+		Images::Options options,
+		int outerw,
+		int outerh,
+		const style::color *colored = nullptr) const;
+	QPixmap pixSingleAsync(
+		Data::FileOrigin origin,
+		int w,
+		int h,
+		Images::Options options,
+		int outerw,
+		int outerh) const;
 
 	std::unique_ptr<Images::Source> _source;
-	mutable QMap<uint64, QPixmap> _sizesCache;
 	mutable QImage _data;
 
 };
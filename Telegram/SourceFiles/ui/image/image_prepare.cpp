@@ -6,13 +6,11 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 */
 #include "ui/image/image_prepare.h"
 
+#include "ui/image/image_prepare_kernels.h"
+
 namespace Images {
 namespace {
 
-TG_FORCE_INLINE uint64 blurGetColors(const uchar *p) {
-	return (uint64)p[0] + ((uint64)p[1] << 16) + ((uint64)p[2] << 32) + ((uint64)p[3] << 48);
-}
-
 const QPixmap &circleMask(int width, int height) {
 	Assert(Global::started());
 
@@ -62,7 +60,6 @@ QImage prepareBlur(QImage img) {
 	if (pix) {
 		int w = img.width(), h = img.height(), wold = w, hold = h;
 		const int radius = 3;
-		const int r1 = radius + 1;
 		const int div = radius * 2 + 1;
 		const int stride = w * 4;
 		if (radius < 16 && div < w && div < h && stride <= w * 4) {
@@ -86,83 +83,7 @@ QImage prepareBlur(QImage img) {
 				pix = img.bits();
 				if (!pix) return was;
 			}
-			uint64 *rgb = new uint64[w * h];
-
-			int x, y, i;
-
-			int yw = 0;
-			const int we = w - r1;
-			for (y = 0; y < h; y++) {
-				uint64 cur = blurGetColors(&pix[yw]);
-				uint64 rgballsum = -radius * cur;
-				uint64 rgbsum = cur * ((r1 * (r1 + 1)) >> 1);
-
-				for (i = 1; i <= radius; i++) {
-					uint64 cur = blurGetColors(&pix[yw + i * 4]);
-					rgbsum += cur * (r1 - i);
-					rgballsum += cur;
-				}
-
-				x = 0;
-
-#define update(start, middle, end) \
-rgb[y * w + x] = (rgbsum >> 4) & 0x00FF00FF00FF00FFLL; \
-rgballsum += blurGetColors(&pix[yw + (start) * 4]) - 2 * blurGetColors(&pix[yw + (middle) * 4]) + blurGetColors(&pix[yw + (end) * 4]); \
-rgbsum += rgballsum; \
-x++;
-
-				while (x < r1) {
-					update(0, x, x + r1);
-				}
-				while (x < we) {
-					update(x - r1, x, x + r1);
-				}
-				while (x < w) {
-					update(x - r1, x, w - 1);
-				}
-
-#undef update
-
-				yw += stride;
-			}
-
-			const int he = h - r1;
-			for (x = 0; x < w; x++) {
-				uint64 rgballsum = -radius * rgb[x];
-				uint64 rgbsum = rgb[x] * ((r1 * (r1 + 1)) >> 1);
-				for (i = 1; i <= radius; i++) {
-					rgbsum += rgb[i * w + x] * (r1 - i);
-					rgballsum += rgb[i * w + x];
-				}
-
-				y = 0;
-				int yi = x * 4;
-
-#define update(start, middle, end) \
-uint64 res = rgbsum >> 4; \
-pix[yi] = res & 0xFF; \
-pix[yi + 1] = (res >> 16) & 0xFF; \
-pix[yi + 2] = (res >> 32) & 0xFF; \
-pix[yi + 3] = (res >> 48) & 0xFF; \
-rgballsum += rgb[x + (start) * w] - 2 * rgb[x + (middle) * w] + rgb[x + (end) * w]; \
-rgbsum += rgballsum; \
-y++; \
-yi += stride;
-
-				while (y < r1) {
-					update(0, y, y + r1);
-				}
-				while (y < he) {
-					update(y - r1, y, y + r1);
-				}
-				while (y < h) {
-					update(y - r1, y, h - 1);
-				}
-
-#undef update
-			}
-
-			delete[] rgb;
+			details::BlurSmall(pix, w, h);
 		}
 	}
 	return img;
@@ -419,31 +340,26 @@ void prepareRound(
 	Assert(image.bytesPerLine() == (imageIntsPerLine << 2));
 
 	auto ints = reinterpret_cast<uint32*>(image.bits());
-	auto intsTopLeft = ints + target.x() + target.y() * imageWidth;
-	auto intsTopRight = ints + target.x() + target.width() - cornerWidth + target.y() * imageWidth;
-	auto intsBottomLeft = ints + target.x() + (target.y() + target.height() - cornerHeight) * imageWidth;
-	auto intsBottomRight = ints + target.x() + target.width() - cornerWidth + (target.y() + target.height() - cornerHeight) * imageWidth;
+	auto intsTopLeft = ints + target.x() + target.y() * imageIntsPerLine;
+	auto intsTopRight = ints + target.x() + target.width() - cornerWidth + target.y() * imageIntsPerLine;
+	auto intsBottomLeft = ints + target.x() + (target.y() + target.height() - cornerHeight) * imageIntsPerLine;
+	auto intsBottomRight = ints + target.x() + target.width() - cornerWidth + (target.y() + target.height() - cornerHeight) * imageIntsPerLine;
 	auto maskCorner = [&](uint32 *imageInts, const QImage &mask) {
 		auto maskWidth = mask.width();
 		auto maskHeight = mask.height();
 		auto maskBytesPerPixel = (mask.depth() >> 3);
 		auto maskBytesPerLine = mask.bytesPerLine();
-		auto maskBytesAdded = maskBytesPerLine - maskWidth * maskBytesPerPixel;
-		auto maskBytes = mask.constBits();
-		Assert(maskBytesAdded >= 0);
+		Assert(maskBytesPerLine >= maskWidth * maskBytesPerPixel);
 		Assert(mask.depth() == (maskBytesPerPixel << 3));
-		auto imageIntsAdded = imageIntsPerLine - maskWidth * imageIntsPerPixel;
-		Assert(imageIntsAdded >= 0);
-		for (auto y = 0; y != maskHeight; ++y) {
-			for (auto x = 0; x != maskWidth; ++x) {
-				auto opacity = static_cast<anim::ShiftedMultiplier>(*maskBytes) + 1;
-				*imageInts = anim::unshifted(anim::shifted(*imageInts) * opacity);
-				maskBytes += maskBytesPerPixel;
-				imageInts += imageIntsPerPixel;
-			}
-			maskBytes += maskBytesAdded;
-			imageInts += imageIntsAdded;
-		}
+		Assert(imageIntsPerLine >= maskWidth * imageIntsPerPixel);
+		details::ApplyMask(
+			imageInts,
+			imageIntsPerLine,
+			mask.constBits(),
+			maskBytesPerPixel,
+			maskBytesPerLine,
+			maskWidth,
+			maskHeight);
 	};
 	if (corners & RectPart::TopLeft) maskCorner(intsTopLeft, cornerMasks[0]);
 	if (corners & RectPart::TopRight) maskCorner(intsTopRight, cornerMasks[1]);
@@ -481,14 +397,7 @@ QImage prepareColored(style::color add, QImage image) {
 
 	if (auto pix = image.bits()) {
 		int ca = int(add->c.alphaF() * 0xFF), cr = int(add->c.redF() * 0xFF), cg = int(add->c.greenF() * 0xFF), cb = int(add->c.blueF() * 0xFF);
-		const int w = image.width(), h = image.height(), size = w * h * 4;
-		for (auto i = index_type(); i < size; i += 4) {
-			int b = pix[i], g = pix[i + 1], r = pix[i + 2], a = pix[i + 3], aca = a * ca;
-			pix[i + 0] = uchar(b + ((aca * (cb - b)) >> 16));
-			pix[i + 1] = uchar(g + ((aca * (cg - g)) >> 16));
-			pix[i + 2] = uchar(r + ((aca * (cr - r)) >> 16));
-			pix[i + 3] = uchar(a + ((aca * (0xFF - a)) >> 16));
-		}
+		details::Colorize(pix, image.width() * image.height(), cr, cg, cb, ca);
 	}
 	return image;
 }
@@ -496,18 +405,12 @@ QImage prepareColored(style::color add, QImage image) {
 QImage prepareOpaque(QImage image) {
 	if (image.hasAlphaChannel()) {
 		image = std::move(image).convertToFormat(QImage::Format_ARGB32_Premultiplied);
-		auto ints = reinterpret_cast<uint32*>(image.bits());
-		auto bg = anim::shifted(st::imageBgTransparent->c);
-		auto width = image.width();
-		auto height = image.height();
-		auto addPerLine = (image.bytesPerLine() / sizeof(uint32)) - width;
-		for (auto y = 0; y != height; ++y) {
-			for (auto x = 0; x != width; ++x) {
-				auto components = anim::shifted(*ints);
-				*ints++ = anim::unshifted(components * 256 + bg * (256 - anim::getAlpha(components)));
-			}
-			ints += addPerLine;
-		}
+		details::PutOverBackground(
+			reinterpret_cast<uint32*>(image.bits()),
+			image.bytesPerLine() / sizeof(uint32),
+			image.width(),
+			image.height(),
+			anim::getPremultiplied(st::imageBgTransparent->c));
 	}
 	return image;
 }
@@ -0,0 +1,567 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "ui/image/image_prepare_kernels.h"
+
+#include <vector>
+
+#ifdef IMAGE_PREPARE_SSE2
+#include <emmintrin.h>
+
+// SSE2 is a part of x86_64 and of our 32 bit MSVC builds (/arch:SSE2),
+// other 32 bit builds compile only the SSE2 kernels for it and check
+// the processor support in runtime.
+#if defined ARCH_CPU_X86_64 || defined __SSE2__ || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define IMAGE_PREPARE_SSE2_ALWAYS
+#endif // ARCH_CPU_X86_64 || __SSE2__ || _M_IX86_FP >= 2
+
+#endif // IMAGE_PREPARE_SSE2
+
+namespace Images {
+namespace details {
+namespace {
+
+constexpr auto kBlurRadius = 3;
+constexpr auto kBlurRadius1 = kBlurRadius + 1;
+
+// Sum of the weights is kBlurRadius1 * kBlurRadius1 = 16 = (1 << 4).
+constexpr auto kBlurEdgeWeight = (kBlurRadius1 * (kBlurRadius1 + 1)) >> 1;
+constexpr auto kBlurShift = 4;
+
+TG_FORCE_INLINE uint64 BlurGetColors(const uchar *p) {
+	return (uint64)p[0] + ((uint64)p[1] << 16) + ((uint64)p[2] << 32) + ((uint64)p[3] << 48);
+}
+
+// Each color component takes 16 bits in the uint64 sums, the sums of
+// the weighted components never exceed 255 * 16 so they don't overflow.
+void BlurRowScalar(const uchar *pix, uint64 *rgb, int w) {
+	uint64 cur = BlurGetColors(pix);
+	uint64 rgballsum = -kBlurRadius * cur;
+	uint64 rgbsum = cur * kBlurEdgeWeight;
+
+	for (auto i = 1; i <= kBlurRadius; i++) {
+		uint64 cur = BlurGetColors(&pix[i * 4]);
+		rgbsum += cur * (kBlurRadius1 - i);
+		rgballsum += cur;
+	}
+
+	auto x = 0;
+	const auto update = [&](int start, int middle, int end) {
+		rgb[x] = (rgbsum >> kBlurShift) & 0x00FF00FF00FF00FFLL;
+		rgballsum += BlurGetColors(&pix[start * 4])
+			- 2 * BlurGetColors(&pix[middle * 4])
+			+ BlurGetColors(&pix[end * 4]);
+		rgbsum += rgballsum;
+		x++;
+	};
+	const auto we = w - kBlurRadius1;
+	while (x < kBlurRadius1) {
+		update(0, x, x + kBlurRadius1);
+	}
+	while (x < we) {
+		update(x - kBlurRadius1, x, x + kBlurRadius1);
+	}
+	while (x < w) {
+		update(x - kBlurRadius1, x, w - 1);
+	}
+}
+
+void BlurColumnScalar(uchar *pix, const uint64 *rgb, int w, int h) {
+	uint64 rgballsum = -kBlurRadius * rgb[0];
+	uint64 rgbsum = rgb[0] * kBlurEdgeWeight;
+	for (auto i = 1; i <= kBlurRadius; i++) {
+		rgbsum += rgb[i * w] * (kBlurRadius1 - i);
+		rgballsum += rgb[i * w];
+	}
+
+	auto y = 0;
+	auto yi = 0;
+	const auto stride = w * 4;
+	const auto update = [&](int start, int middle, int end) {
+		uint64 res = rgbsum >> kBlurShift;
+		pix[yi] = res & 0xFF;
+		pix[yi + 1] = (res >> 16) & 0xFF;
+		pix[yi + 2] = (res >> 32) & 0xFF;
+		pix[yi + 3] = (res >> 48) & 0xFF;
+		rgballsum += rgb[start * w] - 2 * rgb[middle * w] + rgb[end * w];
+		rgbsum += rgballsum;
+		y++;
+		yi += stride;
+	};
+	const auto he = h - kBlurRadius1;
+	while (y < kBlurRadius1) {
+		update(0, y, y + kBlurRadius1);
+	}
+	while (y < he) {
+		update(y - kBlurRadius1, y, y + kBlurRadius1);
+	}
+	while (y < h) {
+		update(y - kBlurRadius1, y, h - 1);
+	}
+}
+
+TG_FORCE_INLINE uint32 MaskPixel(uint32 pixel, uint32 opacity) {
+	return (((pixel & 0x000000FFU) * opacity >> 8) & 0x000000FFU)
+		| ((((pixel >> 8) & 0xFFU) * opacity) & 0x0000FF00U)
+		| (((((pixel >> 16) & 0xFFU) * opacity) << 8) & 0x00FF0000U)
+		| (((((pixel >> 24) & 0xFFU) * opacity) << 16) & 0xFF000000U);
+}
+
+TG_FORCE_INLINE uint32 PixelOverBackground(uint32 pixel, uint32 background) {
+	const auto opacity = 256 - (pixel >> 24);
+	auto result = uint32(0);
+	for (auto shift = 0; shift != 32; shift += 8) {
+		const auto component = (pixel >> shift) & 0xFFU;
+		const auto under = (background >> shift) & 0xFFU;
+		result |= (((component * 256 + under * opacity) >> 8) & 0xFFU) << shift;
+	}
+	return result;
+}
+
+} // namespace
+
+void BlurSmall(uchar *pixels, int width, int height) {
+#ifdef IMAGE_PREPARE_SSE2
+	if (SupportsSSE2()) {
+		return BlurSmallSSE2(pixels, width, height);
+	}
+#endif // IMAGE_PREPARE_SSE2
+	BlurSmallScalar(pixels, width, height);
+}
+
+void Colorize(
+		uchar *pixels,
+		int count,
+		int red,
+		int green,
+		int blue,
+		int alpha) {
+#ifdef IMAGE_PREPARE_SSE2
+	if (SupportsSSE2()) {
+		return ColorizeSSE2(pixels, count, red, green, blue, alpha);
+	}
+#endif // IMAGE_PREPARE_SSE2
+	ColorizeScalar(pixels, count, red, green, blue, alpha);
+}
+
+void ApplyMask(
+		uint32 *pixels,
+		int intsPerLine,
+		const uchar *mask,
+		int maskBytesPerPixel,
+		int maskBytesPerLine,
+		int width,
+		int height) {
+#ifdef IMAGE_PREPARE_SSE2
+	if (SupportsSSE2()) {
+		return ApplyMaskSSE2(
+			pixels,
+			intsPerLine,
+			mask,
+			maskBytesPerPixel,
+			maskBytesPerLine,
+			width,
+			height);
+	}
+#endif // IMAGE_PREPARE_SSE2
+	ApplyMaskScalar(
+		pixels,
+		intsPerLine,
+		mask,
+		maskBytesPerPixel,
+		maskBytesPerLine,
+		width,
+		height);
+}
+
+void PutOverBackground(
+		uint32 *pixels,
+		int intsPerLine,
+		int width,
+		int height,
+		uint32 background) {
+#ifdef IMAGE_PREPARE_SSE2
+	if (SupportsSSE2()) {
+		return PutOverBackgroundSSE2(
+			pixels,
+			intsPerLine,
+			width,
+			height,
+			background);
+	}
+#endif // IMAGE_PREPARE_SSE2
+	PutOverBackgroundScalar(pixels, intsPerLine, width, height, background);
+}
+
+void BlurSmallScalar(uchar *pixels, int width, int height) {
+	Expects(width > 2 * kBlurRadius + 1);
+	Expects(height > 2 * kBlurRadius + 1);
+
+	auto rgb = std::vector<uint64>(width * height);
+	for (auto y = 0; y != height; ++y) {
+		BlurRowScalar(pixels + y * width * 4, rgb.data() + y * width, width);
+	}
+	for (auto x = 0; x != width; ++x) {
+		BlurColumnScalar(pixels + x * 4, rgb.data() + x, width, height);
+	}
+}
+
+void ColorizeScalar(
+		uchar *pixels,
+		int count,
+		int red,
+		int green,
+		int blue,
+		int alpha) {
+	const auto size = count * 4;
+	for (auto i = index_type(); i < size; i += 4) {
+		int b = pixels[i], g = pixels[i + 1], r = pixels[i + 2], a = pixels[i + 3], aca = a * alpha;
+		pixels[i + 0] = uchar(b + ((aca * (blue - b)) >> 16));
+		pixels[i + 1] = uchar(g + ((aca * (green - g)) >> 16));
+		pixels[i + 2] = uchar(r + ((aca * (red - r)) >> 16));
+		pixels[i + 3] = uchar(a + ((aca * (0xFF - a)) >> 16));
+	}
+}
+
+void ApplyMaskScalar(
+		uint32 *pixels,
+		int intsPerLine,
+		const uchar *mask,
+		int maskBytesPerPixel,
+		int maskBytesPerLine,
+		int width,
+		int height) {
+	for (auto y = 0; y != height; ++y) {
+		const auto line = pixels + y * intsPerLine;
+		const auto maskLine = mask + y * maskBytesPerLine;
+		for (auto x = 0; x != width; ++x) {
+			const auto opacity = uint32(maskLine[x * maskBytesPerPixel]) + 1;
+			line[x] = MaskPixel(line[x], opacity);
+		}
+	}
+}
+
+void PutOverBackgroundScalar(
+		uint32 *pixels,
+		int intsPerLine,
+		int width,
+		int height,
+		uint32 background) {
+	for (auto y = 0; y != height; ++y) {
+		const auto line = pixels + y * intsPerLine;
+		for (auto x = 0; x != width; ++x) {
+			line[x] = PixelOverBackground(line[x], background);
+		}
+	}
+}
+
+#ifdef IMAGE_PREPARE_SSE2
+
+bool SupportsSSE2() {
+#ifdef IMAGE_PREPARE_SSE2_ALWAYS
+	return true;
+#else // IMAGE_PREPARE_SSE2_ALWAYS
+	static const auto result = (__builtin_cpu_supports("sse2") != 0);
+	return result;
+#endif // IMAGE_PREPARE_SSE2_ALWAYS
+}
+
+#ifndef IMAGE_PREPARE_SSE2_ALWAYS
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif // !IMAGE_PREPARE_SSE2_ALWAYS
+
+namespace {
+
+// Two pixels with 16 bit components, the first one in the lower half.
+TG_FORCE_INLINE __m128i BlurGetColorsSSE2(
+		const uchar *first,
+		const uchar *second) {
+	const auto both = _mm_unpacklo_epi32(
+		_mm_cvtsi32_si128(*reinterpret_cast<const int*>(first)),
+		_mm_cvtsi32_si128(*reinterpret_cast<const int*>(second)));
+	return _mm_unpacklo_epi8(both, _mm_setzero_si128());
+}
+
+// Two rows at once, the components wrap in 16 bits exactly the way
+// they do in the uint64 sums of the scalar version.
+void BlurTwoRowsSSE2(
+		const uchar *pix,
+		uint64 *rgb,
+		int w) {
+	const auto next = pix + w * 4;
+	const auto get = [&](int x) {
+		return BlurGetColorsSSE2(pix + x * 4, next + x * 4);
+	};
+	const auto radius = _mm_set1_epi16(kBlurRadius);
+	const auto mask = _mm_set1_epi16(0xFF);
+
+	auto cur = get(0);
+	auto rgballsum = _mm_sub_epi16(
+		_mm_setzero_si128(),
+		_mm_mullo_epi16(cur, radius));
+	auto rgbsum = _mm_mullo_epi16(cur, _mm_set1_epi16(kBlurEdgeWeight));
+	for (auto i = 1; i <= kBlurRadius; i++) {
+		const auto cur = get(i);
+		rgbsum = _mm_add_epi16(
+			rgbsum,
+			_mm_mullo_epi16(cur, _mm_set1_epi16(kBlurRadius1 - i)));
+		rgballsum = _mm_add_epi16(rgballsum, cur);
+	}
+
+	auto x = 0;
+	const auto update = [&](int start, int middle, int end) {
+		const auto result = _mm_and_si128(
+			_mm_srli_epi16(rgbsum, kBlurShift),
+			mask);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(rgb + x), result);
+		_mm_storel_epi64(
+			reinterpret_cast<__m128i*>(rgb + w + x),
+			_mm_unpackhi_epi64(result, result));
+		rgballsum = _mm_add_epi16(
+			rgballsum,
+			_mm_sub_epi16(
+				_mm_add_epi16(get(start), get(end)),
+				_mm_slli_epi16(get(middle), 1)));
+		rgbsum = _mm_add_epi16(rgbsum, rgballsum);
+		x++;
+	};
+	const auto we = w - kBlurRadius1;
+	while (x < kBlurRadius1) {
+		update(0, x, x + kBlurRadius1);
+	}
+	while (x < we) {
+		update(x - kBlurRadius1, x, x + kBlurRadius1);
+	}
+	while (x < w) {
+		update(x - kBlurRadius1, x, w - 1);
+	}
+}
+
+// Two columns at once, they are adjacent in the rgb buffer.
+void BlurTwoColumnsSSE2(
+		uchar *pix,
+		const uint64 *rgb,
+		int w,
+		int h) {
+	const auto get = [&](int y) {
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgb + y * w));
+	};
+
+	auto cur = get(0);
+	auto rgballsum = _mm_sub_epi16(
+		_mm_setzero_si128(),
+		_mm_mullo_epi16(cur, _mm_set1_epi16(kBlurRadius)));
+	auto rgbsum = _mm_mullo_epi16(cur, _mm_set1_epi16(kBlurEdgeWeight));
+	for (auto i = 1; i <= kBlurRadius; i++) {
+		const auto cur = get(i);
+		rgbsum = _mm_add_epi16(
+			rgbsum,
+			_mm_mullo_epi16(cur, _mm_set1_epi16(kBlurRadius1 - i)));
+		rgballsum = _mm_add_epi16(rgballsum, cur);
+	}
+
+	auto y = 0;
+	auto yi = 0;
+	const auto stride = w * 4;
+	const auto update = [&](int start, int middle, int end) {
+		const auto result = _mm_srli_epi16(rgbsum, kBlurShift);
+		_mm_storel_epi64(
+			reinterpret_cast<__m128i*>(pix + yi),
+			_mm_packus_epi16(result, result));
+		rgballsum = _mm_add_epi16(
+			rgballsum,
+			_mm_sub_epi16(
+				_mm_add_epi16(get(start), get(end)),
+				_mm_slli_epi16(get(middle), 1)));
+		rgbsum = _mm_add_epi16(rgbsum, rgballsum);
+		y++;
+		yi += stride;
+	};
+	const auto he = h - kBlurRadius1;
+	while (y < kBlurRadius1) {
+		update(0, y, y + kBlurRadius1);
+	}
+	while (y < he) {
+		update(y - kBlurRadius1, y, y + kBlurRadius1);
+	}
+	while (y < h) {
+		update(y - kBlurRadius1, y, h - 1);
+	}
+}
+
+// One pixel with 32 bit components.
+TG_FORCE_INLINE __m128i ColorizePixelSSE2(
+		__m128i pixel,
+		__m128i color,
+		__m128i alpha) {
+	// aca = a * ca, the high 16 bits of both are zero.
+	const auto aca = _mm_madd_epi16(
+		_mm_shuffle_epi32(pixel, _MM_SHUFFLE(3, 3, 3, 3)),
+		alpha);
+
+	// aca * (c - x) doesn't fit in 16 bit multiplications, so it is
+	// computed from the two halves of aca, both less than 256.
+	const auto delta = _mm_sub_epi32(color, pixel);
+	const auto high = _mm_madd_epi16(_mm_srli_epi32(aca, 8), delta);
+	const auto low = _mm_madd_epi16(
+		_mm_and_si128(aca, _mm_set1_epi32(0xFF)),
+		delta);
+	const auto product = _mm_add_epi32(_mm_slli_epi32(high, 8), low);
+	return _mm_add_epi32(pixel, _mm_srai_epi32(product, 16));
+}
+
+} // namespace
+
+void BlurSmallSSE2(
+		uchar *pixels,
+		int width,
+		int height) {
+	Expects(width > 2 * kBlurRadius + 1);
+	Expects(height > 2 * kBlurRadius + 1);
+
+	auto rgb = std::vector<uint64>(width * height);
+	auto y = 0;
+	for (; y + 1 < height; y += 2) {
+		BlurTwoRowsSSE2(pixels + y * width * 4, rgb.data() + y * width, width);
+	}
+	if (y < height) {
+		BlurRowScalar(pixels + y * width * 4, rgb.data() + y * width, width);
+	}
+	auto x = 0;
+	for (; x + 1 < width; x += 2) {
+		BlurTwoColumnsSSE2(pixels + x * 4, rgb.data() + x, width, height);
+	}
+	if (x < width) {
+		BlurColumnScalar(pixels + x * 4, rgb.data() + x, width, height);
+	}
+}
+
+void ColorizeSSE2(
+		uchar *pixels,
+		int count,
+		int red,
+		int green,
+		int blue,
+		int alpha) {
+	const auto zero = _mm_setzero_si128();
+	const auto color = _mm_set_epi32(0xFF, red, green, blue);
+	const auto multiplier = _mm_set1_epi32(alpha);
+	const auto blocks = count / 4;
+	for (auto i = 0; i != blocks; ++i) {
+		const auto address = reinterpret_cast<__m128i*>(pixels + i * 16);
+		const auto four = _mm_loadu_si128(address);
+		const auto first = _mm_unpacklo_epi8(four, zero);
+		const auto second = _mm_unpackhi_epi8(four, zero);
+		const auto colorize = [&](__m128i pixel) {
+			return ColorizePixelSSE2(pixel, color, multiplier);
+		};
+		const auto result = _mm_packus_epi16(
+			_mm_packs_epi32(
+				colorize(_mm_unpacklo_epi16(first, zero)),
+				colorize(_mm_unpackhi_epi16(first, zero))),
+			_mm_packs_epi32(
+				colorize(_mm_unpacklo_epi16(second, zero)),
+				colorize(_mm_unpackhi_epi16(second, zero))));
+		_mm_storeu_si128(address, result);
+	}
+	ColorizeScalar(
+		pixels + blocks * 16,
+		count - blocks * 4,
+		red,
+		green,
+		blue,
+		alpha);
+}
+
+void ApplyMaskSSE2(
+		uint32 *pixels,
+		int intsPerLine,
+		const uchar *mask,
+		int maskBytesPerPixel,
+		int maskBytesPerLine,
+		int width,
+		int height) {
+	const auto zero = _mm_setzero_si128();
+	const auto opacity = [&](const uchar *maskLine, int x) {
+		return short(maskLine[x * maskBytesPerPixel] + 1);
+	};
+	const auto multiply = [&](__m128i pixels, short first, short second) {
+		const auto opacities = _mm_set_epi16(
+			second, second, second, second,
+			first, first, first, first);
+		return _mm_srli_epi16(_mm_mullo_epi16(pixels, opacities), 8);
+	};
+	for (auto y = 0; y != height; ++y) {
+		const auto line = pixels + y * intsPerLine;
+		const auto maskLine = mask + y * maskBytesPerLine;
+		auto x = 0;
+		for (; x + 4 <= width; x += 4) {
+			const auto address = reinterpret_cast<__m128i*>(line + x);
+			const auto four = _mm_loadu_si128(address);
+			const auto result = _mm_packus_epi16(
+				multiply(
+					_mm_unpacklo_epi8(four, zero),
+					opacity(maskLine, x),
+					opacity(maskLine, x + 1)),
+				multiply(
+					_mm_unpackhi_epi8(four, zero),
+					opacity(maskLine, x + 2),
+					opacity(maskLine, x + 3)));
+			_mm_storeu_si128(address, result);
+		}
+		for (; x != width; ++x) {
+			line[x] = MaskPixel(line[x], opacity(maskLine, x));
+		}
+	}
+}
+
+void PutOverBackgroundSSE2(
+		uint32 *pixels,
+		int intsPerLine,
+		int width,
+		int height,
+		uint32 background) {
+	const auto zero = _mm_setzero_si128();
+	const auto under = _mm_unpacklo_epi8(
+		_mm_set1_epi32(int(background)),
+		zero);
+	const auto full = _mm_set1_epi16(256);
+	const auto put = [&](__m128i two) {
+		// Broadcast the alpha of each pixel to its four components.
+		const auto alpha = _mm_shufflehi_epi16(
+			_mm_shufflelo_epi16(two, _MM_SHUFFLE(3, 3, 3, 3)),
+			_MM_SHUFFLE(3, 3, 3, 3));
+		const auto sum = _mm_add_epi16(
+			_mm_slli_epi16(two, 8),
+			_mm_mullo_epi16(under, _mm_sub_epi16(full, alpha)));
+		return _mm_srli_epi16(sum, 8);
+	};
+	for (auto y = 0; y != height; ++y) {
+		const auto line = pixels + y * intsPerLine;
+		auto x = 0;
+		for (; x + 4 <= width; x += 4) {
+			const auto address = reinterpret_cast<__m128i*>(line + x);
+			const auto four = _mm_loadu_si128(address);
+			const auto result = _mm_packus_epi16(
+				put(_mm_unpacklo_epi8(four, zero)),
+				put(_mm_unpackhi_epi8(four, zero)));
+			_mm_storeu_si128(address, result);
+		}
+		for (; x != width; ++x) {
+			line[x] = PixelOverBackground(line[x], background);
+		}
+	}
+}
+
+#ifndef IMAGE_PREPARE_SSE2_ALWAYS
+#pragma GCC pop_options
+#endif // !IMAGE_PREPARE_SSE2_ALWAYS
+
+#endif // IMAGE_PREPARE_SSE2
+
+} // namespace details
+} // namespace Images
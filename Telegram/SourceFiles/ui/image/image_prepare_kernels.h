@@ -0,0 +1,111 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#if defined ARCH_CPU_X86_FAMILY
+#define IMAGE_PREPARE_SSE2
+#endif // ARCH_CPU_X86_FAMILY
+
+namespace Images {
+namespace details {
+
+// Pixel loops of image_prepare.cpp. They work on 32 bit premultiplied
+// pixels with B, G, R, A bytes order in memory and rows packed without
+// any padding unless the ints per line are passed.
+//
+// Each kernel has a scalar reference version and the SIMD versions that
+// give exactly the same result, the entry point without a suffix uses
+// the best one the processor supports.
+
+// Blur with radius 3, expects width > 7 and height > 7.
+void BlurSmall(uchar *pixels, int width, int height);
+
+// Moves each color component to the given one proportionally to
+// the pixel alpha and the color alpha, like prepareColored() does.
+void Colorize(
+	uchar *pixels,
+	int count,
+	int red,
+	int green,
+	int blue,
+	int alpha);
+
+// Multiplies the pixels by (mask byte + 1) / 256, the first byte of
+// each mask pixel is used.
+void ApplyMask(
+	uint32 *pixels,
+	int intsPerLine,
+	const uchar *mask,
+	int maskBytesPerPixel,
+	int maskBytesPerLine,
+	int width,
+	int height);
+
+// Draws the pixels over the opaque premultiplied background.
+void PutOverBackground(
+	uint32 *pixels,
+	int intsPerLine,
+	int width,
+	int height,
+	uint32 background);
+
+void BlurSmallScalar(uchar *pixels, int width, int height);
+void ColorizeScalar(
+	uchar *pixels,
+	int count,
+	int red,
+	int green,
+	int blue,
+	int alpha);
+void ApplyMaskScalar(
+	uint32 *pixels,
+	int intsPerLine,
+	const uchar *mask,
+	int maskBytesPerPixel,
+	int maskBytesPerLine,
+	int width,
+	int height);
+void PutOverBackgroundScalar(
+	uint32 *pixels,
+	int intsPerLine,
+	int width,
+	int height,
+	uint32 background);
+
+#ifdef IMAGE_PREPARE_SSE2
+
+[[nodiscard]] bool SupportsSSE2();
+
+void BlurSmallSSE2(uchar *pixels, int width, int height);
+void ColorizeSSE2(
+	uchar *pixels,
+	int count,
+	int red,
+	int green,
+	int blue,
+	int alpha);
+void ApplyMaskSSE2(
+	uint32 *pixels,
+	int intsPerLine,
+	const uchar *mask,
+	int maskBytesPerPixel,
+	int maskBytesPerLine,
+	int width,
+	int height);
+void PutOverBackgroundSSE2(
+	uint32 *pixels,
+	int intsPerLine,
+	int width,
+	int height,
+	uint32 background);
+
+#endif // IMAGE_PREPARE_SSE2
+
+} // namespace details
+} // namespace Images
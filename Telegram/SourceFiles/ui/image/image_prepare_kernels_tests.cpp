@@ -0,0 +1,252 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "ui/image/image_prepare_kernels.h"
+#include "base/tests_benchmark.h"
+
+#include <random>
+#include <vector>
+
+using namespace Images::details;
+using base::test::Measure;
+
+namespace {
+
+constexpr auto kRepeat = 20;
+
+struct Size {
+	int width = 0;
+	int height = 0;
+};
+
+// Placeholder thumbnails, small photos, chat backgrounds.
+const auto kSizes = {
+	Size{ 8, 8 },
+	Size{ 9, 13 },
+	Size{ 40, 40 },
+	Size{ 90, 67 },
+	Size{ 320, 240 },
+	Size{ 1280, 720 },
+};
+
+// Raw std::mt19937 output is the same with any standard library.
+std::vector<uint32> Pixels(int count, uint32 seed) {
+	auto generator = std::mt19937(seed);
+	auto result = std::vector<uint32>(count);
+	for (auto &pixel : result) {
+		const auto random = uint32(generator());
+		const auto alpha = (random >> 24);
+		const auto component = [&](int shift) {
+			return (((random >> shift) & 0xFFU) * alpha / 255) << shift;
+		};
+		pixel = (alpha << 24) | component(16) | component(8) | component(0);
+	}
+	return result;
+}
+
+std::vector<uchar> Mask(int count, uint32 seed) {
+	auto generator = std::mt19937(seed);
+	auto result = std::vector<uchar>(count);
+	for (auto &value : result) {
+		value = uchar(generator() & 0xFFU);
+	}
+	return result;
+}
+
+uchar *Bytes(std::vector<uint32> &pixels) {
+	return reinterpret_cast<uchar*>(pixels.data());
+}
+
+uint32 Hash(const std::vector<uint32> &pixels) {
+	auto result = uint32(2166136261U);
+	for (const auto pixel : pixels) {
+		for (auto shift = 0; shift != 32; shift += 8) {
+			result = (result ^ ((pixel >> shift) & 0xFFU)) * 16777619U;
+		}
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("image prepare scalar kernels", "[image_prepare]") {
+	SECTION("blur keeps uniform image") {
+		auto pixels = std::vector<uint32>(16 * 9, 0x80402010U);
+		BlurSmallScalar(Bytes(pixels), 16, 9);
+		for (const auto pixel : pixels) {
+			REQUIRE(pixel == 0x80402010U);
+		}
+	}
+	SECTION("blur spreads one pixel with triangle weights") {
+		auto pixels = std::vector<uint32>(15 * 15, 0U);
+		pixels[7 * 15 + 7] = 0xFFFFFFFFU;
+		BlurSmallScalar(Bytes(pixels), 15, 15);
+
+		// Horizontal pass gives 255 * [1 2 3 4 3 2 1] / 16 rounded down.
+		REQUIRE(pixels[7 * 15 + 7] == 0x0F0F0F0FU); // 63 * 4 / 16
+		REQUIRE(pixels[7 * 15 + 6] == 0x0B0B0B0BU); // 47 * 4 / 16
+		REQUIRE(pixels[6 * 15 + 6] == 0x08080808U); // 63 * 3 / 16 ...
+		REQUIRE(pixels[7 * 15 + 3] == 0U);
+		REQUIRE(pixels[3 * 15 + 7] == 0U);
+	}
+	SECTION("blur result is the same as before") {
+		auto pixels = Pixels(90 * 67, 1);
+		BlurSmallScalar(Bytes(pixels), 90, 67);
+		REQUIRE(Hash(pixels) == 0xF38058B0U);
+	}
+	SECTION("colorize moves components to the color") {
+		auto pixels = std::vector<uint32>{
+			0xFF000000U,
+			0x00000000U,
+			0x80808080U,
+		};
+		ColorizeScalar(Bytes(pixels), 3, 255, 0, 0, 255);
+		REQUIRE(pixels[0] == 0xFFFD0000U);
+		REQUIRE(pixels[1] == 0x00000000U);
+		REQUIRE(pixels[2] == 0xBFBF4040U);
+	}
+	SECTION("mask multiplies by the mask byte") {
+		auto pixels = std::vector<uint32>{ 0xFF804020U, 0xFF804020U };
+		const auto mask = std::vector<uchar>{ 0x7F, 0xFF };
+		ApplyMaskScalar(pixels.data(), 2, mask.data(), 1, 2, 2, 1);
+		REQUIRE(pixels[0] == 0x7F402010U);
+		REQUIRE(pixels[1] == 0xFF804020U);
+	}
+	SECTION("background is put under the pixels") {
+		auto pixels = std::vector<uint32>{
+			0x00000000U,
+			0xFF102030U,
+			0x80402010U,
+		};
+		PutOverBackgroundScalar(pixels.data(), 3, 3, 1, 0xFFFFFFFFU);
+		REQUIRE(pixels[0] == 0xFFFFFFFFU);
+		REQUIRE(pixels[1] == 0xFF102030U);
+		REQUIRE(pixels[2] == 0xFFBF9F8FU);
+	}
+}
+
+#ifdef IMAGE_PREPARE_SSE2
+
+TEST_CASE("image prepare sse2 kernels match scalar ones", "[image_prepare]") {
+	if (!SupportsSSE2()) {
+		return;
+	}
+	auto seed = uint32(0);
+	SECTION("blur") {
+		for (const auto size : kSizes) {
+			auto scalar = Pixels(size.width * size.height, ++seed);
+			auto simd = scalar;
+			BlurSmallScalar(Bytes(scalar), size.width, size.height);
+			BlurSmallSSE2(Bytes(simd), size.width, size.height);
+			REQUIRE(scalar == simd);
+		}
+	}
+	SECTION("colorize") {
+		for (const auto size : kSizes) {
+			const auto count = size.width * size.height;
+			for (const auto alpha : { 0, 1, 128, 255 }) {
+				auto scalar = Pixels(count, ++seed);
+				auto simd = scalar;
+				ColorizeScalar(Bytes(scalar), count, 12, 200, 255, alpha);
+				ColorizeSSE2(Bytes(simd), count, 12, 200, 255, alpha);
+				REQUIRE(scalar == simd);
+			}
+		}
+	}
+	SECTION("mask") {
+		// Corner masks are ARGB32 images, check one byte masks too.
+		for (const auto size : kSizes) {
+			for (const auto bytesPerPixel : { 1, 4 }) {
+				const auto intsPerLine = size.width + 3;
+				const auto maskBytesPerLine = size.width * bytesPerPixel + 5;
+				const auto mask = Mask(maskBytesPerLine * size.height, ++seed);
+				auto scalar = Pixels(intsPerLine * size.height, ++seed);
+				auto simd = scalar;
+				ApplyMaskScalar(
+					scalar.data(),
+					intsPerLine,
+					mask.data(),
+					bytesPerPixel,
+					maskBytesPerLine,
+					size.width,
+					size.height);
+				ApplyMaskSSE2(
+					simd.data(),
+					intsPerLine,
+					mask.data(),
+					bytesPerPixel,
+					maskBytesPerLine,
+					size.width,
+					size.height);
+				REQUIRE(scalar == simd);
+			}
+		}
+	}
+	SECTION("background") {
+		for (const auto size : kSizes) {
+			const auto intsPerLine = size.width + 1;
+			auto scalar = Pixels(intsPerLine * size.height, ++seed);
+			auto simd = scalar;
+			PutOverBackgroundScalar(
+				scalar.data(),
+				intsPerLine,
+				size.width,
+				size.height,
+				0xFFF0E8DCU);
+			PutOverBackgroundSSE2(
+				simd.data(),
+				intsPerLine,
+				size.width,
+				size.height,
+				0xFFF0E8DCU);
+			REQUIRE(scalar == simd);
+		}
+	}
+}
+
+TEST_CASE("image prepare kernels benchmark", "[.][benchmark]") {
+	if (!SupportsSSE2()) {
+		return;
+	}
+	for (const auto size : kSizes) {
+		const auto count = size.width * size.height;
+		const auto pixels = Pixels(count, 0);
+		const auto mask = Mask(count, 0);
+		const auto run = [&](const char *name, auto &&scalar, auto &&simd) {
+			auto copy = pixels;
+			const auto scalarTime = Measure([&] { scalar(copy); }, kRepeat);
+			const auto simdTime = Measure([&] { simd(copy); }, kRepeat);
+			WARN(name
+				<< " " << size.width << "x" << size.height
+				<< ": scalar " << scalarTime << " us"
+				<< ", sse2 " << simdTime << " us");
+		};
+		run("blur", [&](std::vector<uint32> &copy) {
+			BlurSmallScalar(Bytes(copy), size.width, size.height);
+		}, [&](std::vector<uint32> &copy) {
+			BlurSmallSSE2(Bytes(copy), size.width, size.height);
+		});
+		run("colorize", [&](std::vector<uint32> &copy) {
+			ColorizeScalar(Bytes(copy), count, 12, 200, 255, 255);
+		}, [&](std::vector<uint32> &copy) {
+			ColorizeSSE2(Bytes(copy), count, 12, 200, 255, 255);
+		});
+		run("mask", [&](std::vector<uint32> &copy) {
+			ApplyMaskScalar(copy.data(), size.width, mask.data(), 1, size.width, size.width, size.height);
+		}, [&](std::vector<uint32> &copy) {
+			ApplyMaskSSE2(copy.data(), size.width, mask.data(), 1, size.width, size.width, size.height);
+		});
+		run("background", [&](std::vector<uint32> &copy) {
+			PutOverBackgroundScalar(copy.data(), size.width, size.width, size.height, 0xFFF0E8DCU);
+		}, [&](std::vector<uint32> &copy) {
+			PutOverBackgroundSSE2(copy.data(), size.width, size.width, size.height, 0xFFF0E8DCU);
+		});
+	}
+}
+
+#endif // IMAGE_PREPARE_SSE2
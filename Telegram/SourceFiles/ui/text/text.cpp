@@ -2514,6 +2514,7 @@ Text &Text::operator=(const Text &other) {
 	_blocks = TextBlocks(other._blocks.size());
 	_links = other._links;
 	_startDir = other._startDir;
+	_linesLayout = LinesLayout();
 	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
 		_blocks[i] = other._blocks.at(i)->clone();
 	}
@@ -2529,6 +2530,7 @@ Text &Text::operator=(Text &&other) {
 	_blocks = std::move(other._blocks);
 	_links = other._links;
 	_startDir = other._startDir;
+	_linesLayout = LinesLayout();
 	other.clearFields();
 	return *this;
 }
@@ -2545,6 +2547,8 @@ void Text::setText(const style::TextStyle &st, const QString &text, const TextPa
 void Text::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
 	NewlineBlock *lastNewline = 0;
 
+	_linesLayout = LinesLayout();
+
 	_maxWidth = _minHeight = 0;
 	int32 lineHeight = 0;
 	int32 result = 0, lastNewlineStart = 0;
@@ -2776,31 +2780,42 @@ int Text::countWidth(int width) const {
 	if (QFixed(width) >= _maxWidth) {
 		return _maxWidth.ceil().toInt();
 	}
-
-	QFixed maxLineWidth = 0;
-	enumerateLines(width, [&maxLineWidth](QFixed lineWidth, int lineHeight) {
-		if (lineWidth > maxLineWidth) {
-			maxLineWidth = lineWidth;
-		}
-	});
-	return maxLineWidth.ceil().toInt();
+	return countLinesLayout(width, false).maxLineWidth;
 }
 
 int Text::countHeight(int width) const {
 	if (QFixed(width) >= _maxWidth) {
 		return _minHeight;
 	}
-	int result = 0;
-	enumerateLines(width, [&result](QFixed lineWidth, int lineHeight) {
-		result += lineHeight;
-	});
-	return result;
+	return countLinesLayout(width, false).height;
 }
 
 void Text::countLineWidths(int width, QVector<int> *lineWidths) const {
-	enumerateLines(width, [lineWidths](QFixed lineWidth, int lineHeight) {
-		lineWidths->push_back(lineWidth.ceil().toInt());
+	*lineWidths += countLinesLayout(width, true).lineWidths;
+}
+
+const Text::LinesLayout &Text::countLinesLayout(
+		int width,
+		bool withLineWidths) const {
+	auto &result = _linesLayout;
+	if (result.width == width && (result.hasLineWidths || !withLineWidths)) {
+		return result;
+	}
+	result.width = width;
+	result.height = 0;
+	result.hasLineWidths = withLineWidths;
+	result.lineWidths.clear();
+
+	auto maxLineWidth = QFixed(0);
+	enumerateLines(width, [&](QFixed lineWidth, int lineHeight) {
+		accumulate_max(maxLineWidth, lineWidth);
+		result.height += lineHeight;
+		if (withLineWidths) {
+			result.lineWidths.push_back(lineWidth.ceil().toInt());
+		}
 	});
+	result.maxLineWidth = maxLineWidth.ceil().toInt();
+	return result;
 }
 
 template <typename Callback>
@@ -3130,6 +3145,7 @@ void Text::clearFields() {
 	_links.clear();
 	_maxWidth = _minHeight = 0;
 	_startDir = Qt::LayoutDirectionAuto;
+	_linesLayout = LinesLayout();
 }
 
 Text::~Text() = default;
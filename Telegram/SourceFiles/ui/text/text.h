@@ -197,6 +197,16 @@ private:
 	using TextBlocks = std::vector<std::unique_ptr<ITextBlock>>;
 	using TextLinks = QVector<ClickHandlerPtr>;
 
+	// Lines layout for the last width that didn't fit the natural size,
+	// so that repaints and repeated resizes don't break the lines again.
+	struct LinesLayout {
+		int width = -1;
+		int height = 0;
+		int maxLineWidth = 0;
+		bool hasLineWidths = false;
+		QVector<int> lineWidths;
+	};
+
 	uint16 countBlockEnd(const TextBlocks::const_iterator &i, const TextBlocks::const_iterator &e) const;
 	uint16 countBlockLength(const Text::TextBlocks::const_iterator &i, const Text::TextBlocks::const_iterator &e) const;
 
@@ -209,6 +219,7 @@ private:
 	// QFixed lineWidth, int lineHeight
 	template <typename Callback>
 	void enumerateLines(int w, Callback callback) const;
+	const LinesLayout &countLinesLayout(int width, bool withLineWidths) const;
 
 	void recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir = Qt::LayoutDirectionAuto);
 
@@ -228,6 +239,8 @@ private:
 
 	Qt::LayoutDirection _startDir = Qt::LayoutDirectionAuto;
 
+	mutable LinesLayout _linesLayout;
+
 	friend class TextParser;
 	friend class TextPainter;
 
@@ -6,6 +6,7 @@ https://github.com/bettergram/bettergram/blob/master/LEGAL
 */
 #include "ui/text/text_entity.h"
 
+#include "ui/text/text_entity_scanner.h"
 #include "auth_session.h"
 #include "lang/lang_tag.h"
 #include "base/qthelp_url.h"
@@ -23,18 +24,8 @@ QString ExpressionMailNameAtEnd() {
 	return qsl("[a-zA-Z\\-_\\.0-9]{1,256}$");
 }
 
-QString Quotes() {
-	// UTF8 quotes and ellipsis
-	return QString::fromUtf8("\xC2\xAB\xC2\xBB\xE2\x80\x9C\xE2\x80\x9D\xE2\x80\x98\xE2\x80\x99\xE2\x80\xA6");
-}
-
-QString ExpressionSeparators(const QString &additional) {
-	static const auto quotes = Quotes();
-	return qsl("\\s\\.,:;<>|'\"\\[\\]\\{\\}\\~\\!\\?\\%\\^\\(\\)\\-\\+=\\x10") + quotes + additional;
-}
-
 QString Separators(const QString &additional) {
-	static const auto quotes = Quotes();
+	static const auto quotes = details::Quotes();
 	return qsl(" \x10\n\r\t.,:;<>|'\"[]{}~!?%^()-+=")
 		+ QChar(0xfdd0) // QTextBeginningOfFrame
 		+ QChar(0xfdd1) // QTextEndOfFrame
@@ -56,22 +47,10 @@ QString SeparatorsMono() {
 	return Separators(qsl("*/"));
 }
 
-QString ExpressionHashtag() {
-	return qsl("(^|[") + ExpressionSeparators(qsl("`\\*/")) + qsl("])#[\\w]{2,64}([\\W]|$)");
-}
-
 QString ExpressionHashtagExclude() {
 	return qsl("^#?\\d+$");
 }
 
-QString ExpressionMention() {
-	return qsl("(^|[") + ExpressionSeparators(qsl("`\\*/")) + qsl("])@[A-Za-z_0-9]{1,32}([\\W]|$)");
-}
-
-QString ExpressionBotCommand() {
-	return qsl("(^|[") + ExpressionSeparators(qsl("`\\*")) + qsl("])/[A-Za-z_0-9]{1,64}(@[A-Za-z_0-9]{5,32})?([\\W]|$)");
-}
-
 QRegularExpression CreateRegExp(const QString &expression) {
 	auto result = QRegularExpression(
 		expression,
@@ -1129,6 +1108,58 @@ const QRegularExpression &RegExpWordSplit() {
 	return result;
 }
 
+details::TagMatch TagMatchFromRegExp(
+		const QRegularExpressionMatch &match,
+		int suffixGroup) {
+	auto result = details::TagMatch();
+	if (match.hasMatch()) {
+		result.start = match.capturedStart();
+		result.end = match.capturedEnd();
+		result.prefix = !match.capturedRef(1).isEmpty();
+		result.suffix = !match.capturedRef(suffixGroup).isEmpty();
+	}
+	return result;
+}
+
+bool HasMatch(const details::TagMatch &match) {
+	return match.found();
+}
+
+bool HasMatch(const QRegularExpressionMatch &match) {
+	return match.hasMatch();
+}
+
+int MatchStart(const details::TagMatch &match) {
+	return match.start;
+}
+
+int MatchStart(const QRegularExpressionMatch &match) {
+	return match.capturedStart();
+}
+
+// ParseEntities() looks for every kind of entity after each one found.
+// The first match after some offset is the same for all offsets up to
+// its start, so it is searched again only when the offset passes it.
+template <typename Match>
+class LastMatch {
+public:
+	template <typename Find>
+	const Match &find(int offset, Find &&method) {
+		if (_offset < 0
+			|| offset < _offset
+			|| (HasMatch(_match) && MatchStart(_match) < offset)) {
+			_match = method(offset);
+			_offset = offset;
+		}
+		return _match;
+	}
+
+private:
+	Match _match;
+	int _offset = -1;
+
+};
+
 } // namespace
 
 const QRegularExpression &RegExpMailNameAtEnd() {
@@ -1137,7 +1168,7 @@ const QRegularExpression &RegExpMailNameAtEnd() {
 }
 
 const QRegularExpression &RegExpHashtag() {
-	static const auto result = CreateRegExp(ExpressionHashtag());
+	static const auto result = CreateRegExp(details::ExpressionHashtag());
 	return result;
 }
 
@@ -1147,12 +1178,12 @@ const QRegularExpression &RegExpHashtagExclude() {
 }
 
 const QRegularExpression &RegExpMention() {
-	static const auto result = CreateRegExp(ExpressionMention());
+	static const auto result = CreateRegExp(details::ExpressionMention());
 	return result;
 }
 
 const QRegularExpression &RegExpBotCommand() {
-	static const auto result = CreateRegExp(ExpressionBotCommand());
+	static const auto result = CreateRegExp(details::ExpressionBotCommand());
 	return result;
 }
 
@@ -1577,6 +1608,42 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 	int32 len = result.text.size(), commandOffset = rich ? 0 : len;
 	bool inLink = false, commandIsLink = false;
 	const QChar *start = result.text.constData(), *end = start + result.text.size();
+
+	// Tags are found without regular expressions in valid UTF-16 texts.
+	// Domains can't be found without a '.' or a protocol in the text.
+	const auto scan = details::IsValidUtf16(result.text);
+	const auto withDomains = result.text.contains('.');
+	const auto withExplicitDomains = result.text.contains(qstr("://"));
+	auto lastDomain = LastMatch<QRegularExpressionMatch>();
+	auto lastExplicitDomain = LastMatch<QRegularExpressionMatch>();
+	auto lastHashtag = LastMatch<details::TagMatch>();
+	auto lastMention = LastMatch<details::TagMatch>();
+	auto lastBotCommand = LastMatch<details::TagMatch>();
+	const auto findDomain = [&](int offset) {
+		return withDomains
+			? qthelp::RegExpDomain().match(result.text, offset)
+			: QRegularExpressionMatch();
+	};
+	const auto findExplicitDomain = [&](int offset) {
+		return withExplicitDomains
+			? qthelp::RegExpDomainExplicit().match(result.text, offset)
+			: QRegularExpressionMatch();
+	};
+	const auto findHashtag = [&](int offset) {
+		return scan
+			? details::FindHashtag(result.text, offset)
+			: TagMatchFromRegExp(RegExpHashtag().match(result.text, offset), 2);
+	};
+	const auto findMention = [&](int offset) {
+		return scan
+			? details::FindMention(result.text, offset)
+			: TagMatchFromRegExp(RegExpMention().match(result.text, offset), 2);
+	};
+	const auto findBotCommand = [&](int offset) {
+		return scan
+			? details::FindBotCommand(result.text, offset)
+			: TagMatchFromRegExp(RegExpBotCommand().match(result.text, offset), 3);
+	};
 	for (int32 offset = 0, matchOffset = offset, mentionSkip = 0; offset < len;) {
 		if (commandOffset <= offset) {
 			for (commandOffset = offset; commandOffset < len; ++commandOffset) {
@@ -1587,11 +1654,11 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				}
 			}
 		}
-		auto mDomain = qthelp::RegExpDomain().match(result.text, matchOffset);
-		auto mExplicitDomain = qthelp::RegExpDomainExplicit().match(result.text, matchOffset);
-		auto mHashtag = withHashtags ? RegExpHashtag().match(result.text, matchOffset) : QRegularExpressionMatch();
-		auto mMention = withMentions ? RegExpMention().match(result.text, qMax(mentionSkip, matchOffset)) : QRegularExpressionMatch();
-		auto mBotCommand = withBotCommands ? RegExpBotCommand().match(result.text, matchOffset) : QRegularExpressionMatch();
+		auto mDomain = lastDomain.find(matchOffset, findDomain);
+		const auto &mExplicitDomain = lastExplicitDomain.find(matchOffset, findExplicitDomain);
+		const auto mHashtag = withHashtags ? lastHashtag.find(matchOffset, findHashtag) : details::TagMatch();
+		auto mMention = withMentions ? lastMention.find(qMax(mentionSkip, matchOffset), findMention) : details::TagMatch();
+		const auto mBotCommand = withBotCommands ? lastBotCommand.find(matchOffset, findBotCommand) : details::TagMatch();
 
 		EntityInTextType lnkType = EntityInTextUrl;
 		int32 lnkStart = 0, lnkLength = 0;
@@ -1599,20 +1666,20 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 			domainEnd = mDomain.hasMatch() ? mDomain.capturedEnd() : kNotFound,
 			explicitDomainStart = mExplicitDomain.hasMatch() ? mExplicitDomain.capturedStart() : kNotFound,
 			explicitDomainEnd = mExplicitDomain.hasMatch() ? mExplicitDomain.capturedEnd() : kNotFound,
-			hashtagStart = mHashtag.hasMatch() ? mHashtag.capturedStart() : kNotFound,
-			hashtagEnd = mHashtag.hasMatch() ? mHashtag.capturedEnd() : kNotFound,
-			mentionStart = mMention.hasMatch() ? mMention.capturedStart() : kNotFound,
-			mentionEnd = mMention.hasMatch() ? mMention.capturedEnd() : kNotFound,
-			botCommandStart = mBotCommand.hasMatch() ? mBotCommand.capturedStart() : kNotFound,
-			botCommandEnd = mBotCommand.hasMatch() ? mBotCommand.capturedEnd() : kNotFound;
+			hashtagStart = mHashtag.found() ? mHashtag.start : kNotFound,
+			hashtagEnd = mHashtag.found() ? mHashtag.end : kNotFound,
+			mentionStart = mMention.found() ? mMention.start : kNotFound,
+			mentionEnd = mMention.found() ? mMention.end : kNotFound,
+			botCommandStart = mBotCommand.found() ? mBotCommand.start : kNotFound,
+			botCommandEnd = mBotCommand.found() ? mBotCommand.end : kNotFound;
 		auto hashtagIgnore = false;
 		auto mentionIgnore = false;
 
-		if (mHashtag.hasMatch()) {
-			if (!mHashtag.capturedRef(1).isEmpty()) {
+		if (mHashtag.found()) {
+			if (mHashtag.prefix) {
 				++hashtagStart;
 			}
-			if (!mHashtag.capturedRef(2).isEmpty()) {
+			if (mHashtag.suffix) {
 				--hashtagEnd;
 			}
 			if (RegExpHashtagExclude().match(
@@ -1622,19 +1689,19 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				hashtagIgnore = true;
 			}
 		}
-		while (mMention.hasMatch()) {
-			if (!mMention.capturedRef(1).isEmpty()) {
+		while (mMention.found()) {
+			if (mMention.prefix) {
 				++mentionStart;
 			}
-			if (!mMention.capturedRef(2).isEmpty()) {
+			if (mMention.suffix) {
 				--mentionEnd;
 			}
 			if (!(start + mentionStart + 1)->isLetter() || !(start + mentionEnd - 1)->isLetterOrNumber()) {
 				mentionSkip = mentionEnd;
-				mMention = RegExpMention().match(result.text, qMax(mentionSkip, matchOffset));
-				if (mMention.hasMatch()) {
-					mentionStart = mMention.capturedStart();
-					mentionEnd = mMention.capturedEnd();
+				mMention = lastMention.find(qMax(mentionSkip, matchOffset), findMention);
+				if (mMention.found()) {
+					mentionStart = mMention.start;
+					mentionEnd = mMention.end;
 				} else {
 					mentionIgnore = true;
 				}
@@ -1642,19 +1709,19 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				break;
 			}
 		}
-		if (mBotCommand.hasMatch()) {
-			if (!mBotCommand.capturedRef(1).isEmpty()) {
+		if (mBotCommand.found()) {
+			if (mBotCommand.prefix) {
 				++botCommandStart;
 			}
-			if (!mBotCommand.capturedRef(3).isEmpty()) {
+			if (mBotCommand.suffix) {
 				--botCommandEnd;
 			}
 		}
 		if (!mDomain.hasMatch()
 			&& !mExplicitDomain.hasMatch()
-			&& !mHashtag.hasMatch()
-			&& !mMention.hasMatch()
-			&& !mBotCommand.hasMatch()) {
+			&& !mHashtag.found()
+			&& !mMention.found()
+			&& !mBotCommand.found()) {
 			break;
 		}
 
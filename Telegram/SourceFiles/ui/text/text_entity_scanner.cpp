@@ -0,0 +1,245 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "ui/text/text_entity_scanner.h"
+
+#include <algorithm>
+
+namespace TextUtilities {
+namespace details {
+namespace {
+
+constexpr auto kHashtagMinLength = 2;
+constexpr auto kHashtagMaxLength = 64;
+constexpr auto kMentionMaxLength = 32;
+constexpr auto kBotCommandMaxLength = 64;
+constexpr auto kBotUsernameMinLength = 5;
+constexpr auto kBotUsernameMaxLength = 32;
+
+// PCRE \s with Unicode properties: \p{Z}, \h and \v.
+bool IsSpace(ushort code) {
+	return (code >= 0x09 && code <= 0x0D)
+		|| (code == 0x20)
+		|| (code == 0x85)
+		|| (code == 0xA0)
+		|| (code == 0x1680)
+		|| (code == 0x180E)
+		|| (code >= 0x2000 && code <= 0x200A)
+		|| (code == 0x2028)
+		|| (code == 0x2029)
+		|| (code == 0x202F)
+		|| (code == 0x205F)
+		|| (code == 0x3000);
+}
+
+// ExpressionSeparators() with "`*" added and optionally "/".
+bool IsSeparator(ushort code, bool slash) {
+	switch (code) {
+	case '.': case ',': case ':': case ';': case '<': case '>':
+	case '|': case '\'': case '"': case '[': case ']': case '{':
+	case '}': case '~': case '!': case '?': case '%': case '^':
+	case '(': case ')': case '-': case '+': case '=': case 0x10:
+	case '`': case '*':
+	case 0xAB: case 0xBB: // Angle quotes.
+	case 0x201C: case 0x201D: case 0x2018: case 0x2019: // Curly quotes.
+	case 0x2026: // Ellipsis.
+		return true;
+	case '/':
+		return slash;
+	}
+	return IsSpace(code);
+}
+
+bool IsUsernameCharacter(ushort code) {
+	return (code >= 'a' && code <= 'z')
+		|| (code >= 'A' && code <= 'Z')
+		|| (code >= '0' && code <= '9')
+		|| (code == '_');
+}
+
+// PCRE \w with Unicode properties: \p{L}, \p{N} and underscore.
+bool IsWordCharacter(uint code) {
+	return (code == '_') || QChar::isLetterOrNumber(code);
+}
+
+int CodeLength(const QChar *ch, const QChar *end) {
+	return (ch->isHighSurrogate() && ch + 1 != end) ? 2 : 1;
+}
+
+uint Code(const QChar *ch, const QChar *end) {
+	return (CodeLength(ch, end) == 2)
+		? QChar::surrogateToUcs4(*ch, *(ch + 1))
+		: ch->unicode();
+}
+
+// The match of the (^|[separators]) group before the tag symbol.
+bool HasTagStart(const QChar *start, const QChar *ch, int offset, bool slash) {
+	const auto index = int(ch - start);
+	if (index == 0) {
+		return (offset == 0);
+	}
+	return (index > offset) && IsSeparator((ch - 1)->unicode(), slash);
+}
+
+// The ([\W]|$) group, fills match end and suffix if it matches.
+bool FinishTag(
+		const QChar *start,
+		const QChar *ch,
+		const QChar *end,
+		TagMatch &match) {
+	if (ch == end) {
+		match.end = int(ch - start);
+		match.suffix = false;
+		return true;
+	} else if (IsWordCharacter(Code(ch, end))) {
+		return false;
+	}
+	match.end = int(ch - start) + CodeLength(ch, end);
+	match.suffix = true;
+	return true;
+}
+
+const QChar *SkipUsername(const QChar *ch, const QChar *end) {
+	while (ch != end && IsUsernameCharacter(ch->unicode())) {
+		++ch;
+	}
+	return ch;
+}
+
+// Finds the leftmost symbol with a tag start before it, for which
+// the body(start, after, end, match) accepts the rest of the tag.
+template <typename Body>
+TagMatch FindTag(
+		const QString &text,
+		int offset,
+		QChar symbol,
+		bool slash,
+		Body &&body) {
+	const auto start = text.constData();
+	const auto end = start + text.size();
+	const auto from = start + std::max(offset, 0);
+	if (from > start
+		&& from < end
+		&& from->isLowSurrogate()
+		&& (from - 1)->isHighSurrogate()) {
+		// QRegularExpression fails to match from inside a surrogate pair.
+		return TagMatch();
+	}
+	for (auto ch = from; ch < end; ++ch) {
+		if (*ch != symbol || !HasTagStart(start, ch, offset, slash)) {
+			continue;
+		}
+		auto result = TagMatch();
+		result.prefix = (ch != start);
+		result.start = int(ch - start) - (result.prefix ? 1 : 0);
+		if (body(start, ch + 1, end, result)) {
+			return result;
+		}
+	}
+	return TagMatch();
+}
+
+} // namespace
+
+QString Quotes() {
+	return QString::fromUtf8("\xC2\xAB\xC2\xBB\xE2\x80\x9C\xE2\x80\x9D\xE2\x80\x98\xE2\x80\x99\xE2\x80\xA6");
+}
+
+QString ExpressionSeparators(const QString &additional) {
+	static const auto quotes = Quotes();
+	return QStringLiteral("\\s\\.,:;<>|'\"\\[\\]\\{\\}\\~\\!\\?\\%\\^\\(\\)\\-\\+=\\x10") + quotes + additional;
+}
+
+QString ExpressionHashtag() {
+	return QStringLiteral("(^|[") + ExpressionSeparators(QStringLiteral("`\\*/")) + QStringLiteral("])#[\\w]{2,64}([\\W]|$)");
+}
+
+QString ExpressionMention() {
+	return QStringLiteral("(^|[") + ExpressionSeparators(QStringLiteral("`\\*/")) + QStringLiteral("])@[A-Za-z_0-9]{1,32}([\\W]|$)");
+}
+
+QString ExpressionBotCommand() {
+	return QStringLiteral("(^|[") + ExpressionSeparators(QStringLiteral("`\\*")) + QStringLiteral("])/[A-Za-z_0-9]{1,64}(@[A-Za-z_0-9]{5,32})?([\\W]|$)");
+}
+
+bool IsValidUtf16(const QString &text) {
+	const auto start = text.constData();
+	const auto end = start + text.size();
+	for (auto ch = start; ch != end; ++ch) {
+		if (ch->isHighSurrogate()) {
+			if (ch + 1 == end || !(ch + 1)->isLowSurrogate()) {
+				return false;
+			}
+			++ch;
+		} else if (ch->isLowSurrogate()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TagMatch FindHashtag(const QString &text, int offset) {
+	const auto body = [](
+			const QChar *start,
+			const QChar *ch,
+			const QChar *end,
+			TagMatch &match) {
+		auto length = 0;
+		while (ch != end && IsWordCharacter(Code(ch, end))) {
+			ch += CodeLength(ch, end);
+			++length;
+		}
+		return (length >= kHashtagMinLength)
+			&& (length <= kHashtagMaxLength)
+			&& FinishTag(start, ch, end, match);
+	};
+	return FindTag(text, offset, '#', true, body);
+}
+
+TagMatch FindMention(const QString &text, int offset) {
+	const auto body = [](
+			const QChar *start,
+			const QChar *ch,
+			const QChar *end,
+			TagMatch &match) {
+		const auto till = SkipUsername(ch, end);
+		const auto length = int(till - ch);
+		return (length > 0)
+			&& (length <= kMentionMaxLength)
+			&& FinishTag(start, till, end, match);
+	};
+	return FindTag(text, offset, '@', true, body);
+}
+
+TagMatch FindBotCommand(const QString &text, int offset) {
+	const auto body = [](
+			const QChar *start,
+			const QChar *ch,
+			const QChar *end,
+			TagMatch &match) {
+		const auto till = SkipUsername(ch, end);
+		const auto length = int(till - ch);
+		if (length < 1 || length > kBotCommandMaxLength) {
+			return false;
+		} else if (till != end && *till == '@') {
+			// The optional username group is used only if the whole
+			// expression matches with it, otherwise '@' is the suffix.
+			const auto username = till + 1;
+			const auto usernameTill = SkipUsername(username, end);
+			const auto usernameLength = int(usernameTill - username);
+			if (usernameLength >= kBotUsernameMinLength
+				&& usernameLength <= kBotUsernameMaxLength
+				&& FinishTag(start, usernameTill, end, match)) {
+				return true;
+			}
+		}
+		return FinishTag(start, till, end, match);
+	};
+	return FindTag(text, offset, '/', false, body);
+}
+
+} // namespace details
+} // namespace TextUtilities
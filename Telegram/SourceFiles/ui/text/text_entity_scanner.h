@@ -0,0 +1,50 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#pragma once
+
+#include <QtCore/QString>
+
+namespace TextUtilities {
+namespace details {
+
+// UTF8 quotes and ellipsis.
+[[nodiscard]] QString Quotes();
+
+// The hashtag, mention and bot command regular expressions used in
+// ParseEntities(), matched with UseUnicodePropertiesOption.
+[[nodiscard]] QString ExpressionSeparators(const QString &additional);
+[[nodiscard]] QString ExpressionHashtag();
+[[nodiscard]] QString ExpressionMention();
+[[nodiscard]] QString ExpressionBotCommand();
+
+// Hand-written versions of the expressions above. Each one returns
+// exactly the first match that QRegularExpression::match(text, offset)
+// would give for the corresponding expression.
+//
+// The text must be valid UTF-16, QRegularExpression doesn't match
+// anything in a broken text, so check it with IsValidUtf16() first.
+// An offset inside a surrogate pair gives no match, like it does there.
+
+struct TagMatch {
+	int start = -1;
+	int end = -1;
+	bool prefix = false; // The match starts with the separator.
+	bool suffix = false; // The match ends with the non-word character.
+
+	bool found() const {
+		return (start >= 0);
+	}
+};
+
+[[nodiscard]] bool IsValidUtf16(const QString &text);
+
+[[nodiscard]] TagMatch FindHashtag(const QString &text, int offset);
+[[nodiscard]] TagMatch FindMention(const QString &text, int offset);
+[[nodiscard]] TagMatch FindBotCommand(const QString &text, int offset);
+
+} // namespace details
+} // namespace TextUtilities
@@ -0,0 +1,246 @@
+/*
+This file is part of Bettergram.
+
+For license and copyright information please follow this link:
+https://github.com/bettergram/bettergram/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "ui/text/text_entity_scanner.h"
+#include "base/tests_benchmark.h"
+
+#include <QtCore/QRegularExpression>
+#include <random>
+#include <vector>
+
+namespace TextUtilities {
+namespace details {
+
+// Found by argument dependent lookup from the Catch assertions.
+bool operator==(const TagMatch &a, const TagMatch &b) {
+	return (a.start == b.start)
+		&& (a.end == b.end)
+		&& (a.prefix == b.prefix)
+		&& (a.suffix == b.suffix);
+}
+
+} // namespace details
+} // namespace TextUtilities
+
+using namespace TextUtilities::details;
+
+namespace {
+
+QRegularExpression CreateRegExp(const QString &expression) {
+	return QRegularExpression(
+		expression,
+		QRegularExpression::UseUnicodePropertiesOption);
+}
+
+const QRegularExpression &RegExpHashtag() {
+	static const auto result = CreateRegExp(ExpressionHashtag());
+	return result;
+}
+
+const QRegularExpression &RegExpMention() {
+	static const auto result = CreateRegExp(ExpressionMention());
+	return result;
+}
+
+const QRegularExpression &RegExpBotCommand() {
+	static const auto result = CreateRegExp(ExpressionBotCommand());
+	return result;
+}
+
+TagMatch FromRegExp(const QRegularExpressionMatch &match, int suffixGroup) {
+	auto result = TagMatch();
+	if (match.hasMatch()) {
+		result.start = match.capturedStart();
+		result.end = match.capturedEnd();
+		result.prefix = !match.capturedRef(1).isEmpty();
+		result.suffix = !match.capturedRef(suffixGroup).isEmpty();
+	}
+	return result;
+}
+
+struct Expression {
+	const char *name = nullptr;
+	const QRegularExpression &(*regexp)() = nullptr;
+	TagMatch (*scan)(const QString &text, int offset) = nullptr;
+	int suffixGroup = 0;
+};
+
+const auto kExpressions = {
+	Expression{ "hashtag", RegExpHashtag, FindHashtag, 2 },
+	Expression{ "mention", RegExpMention, FindMention, 2 },
+	Expression{ "bot command", RegExpBotCommand, FindBotCommand, 3 },
+};
+
+void CheckAllOffsets(const QString &text) {
+	for (const auto &expression : kExpressions) {
+		for (auto offset = 0; offset <= text.size(); ++offset) {
+			const auto expected = FromRegExp(
+				expression.regexp().match(text, offset),
+				expression.suffixGroup);
+			const auto scanned = expression.scan(text, offset);
+			INFO(expression.name
+				<< " in \"" << text.toStdString()
+				<< "\" from " << offset);
+			REQUIRE(scanned == expected);
+		}
+	}
+}
+
+// Tag symbols, separators, spaces, word and non-word characters
+// from different planes, combining marks and surrogate pairs.
+const auto kAlphabet = {
+	QString("#"), QString("@"), QString("/"), QString("_"),
+	QString("a"), QString("Z"), QString("0"), QString("9"),
+	QString(" "), QString("\n"), QString("\t"), QString("."),
+	QString(","), QString("`"), QString("*"), QString("$"),
+	QString("&"), QString("\\"), QString("-"), QString(QChar(0x10)),
+	QString(QChar(0xA0)), QString(QChar(0x2028)), QString(QChar(0x3000)),
+	QString(QChar(0xAB)), QString(QChar(0x201C)), QString(QChar(0x2026)),
+	QString(QChar(0x0436)), // Cyrillic letter.
+	QString(QChar(0x4E2D)), // CJK ideograph.
+	QString(QChar(0x0663)), // Arabic-indic digit.
+	QString(QChar(0x0301)), // Combining acute accent.
+	QString(QChar(0x00B7)), // Middle dot.
+	QString::fromUtf8("\xF0\x9D\x90\x80"), // Mathematical bold A.
+	QString::fromUtf8("\xF0\x9F\x98\x80"), // Grinning face emoji.
+};
+
+QString RandomText(std::mt19937 &generator, int length) {
+	const auto alphabet = std::vector<QString>(kAlphabet);
+	auto result = QString();
+	for (auto i = 0; i != length; ++i) {
+		result.append(alphabet[generator() % alphabet.size()]);
+	}
+	return result;
+}
+
+// Words of ordinary chat messages, mostly without any tags.
+const auto kCorpusWords = {
+	"hello", "the", "and", "meeting", "is", "at", "5pm,", "see", "you",
+	"there.", "ok", "thanks!", "what", "about", "tomorrow?", "lol", ":)",
+	"(maybe)", "e-mail", "me", "at", "user@example.com", "or", "visit",
+	"https://example.com/path/to/page", "#news", "#2018", "@username",
+	"/start", "/help@SomeBot", "1/2", "and/or",
+	"\xD0\xBF\xD1\x80\xD0\xB8\xD0\xB2\xD0\xB5\xD1\x82", // Cyrillic words.
+	"\xD0\xBA\xD0\xB0\xD0\xBA",
+	"\xD0\xB4\xD0\xB5\xD0\xBB\xD0\xB0?",
+	"\xF0\x9F\x98\x80", // Grinning face emoji.
+	"\xE2\x80\x9C" "quoted" "\xE2\x80\x9D",
+};
+
+// Messages of 1 to 30 words, some of them multiline.
+QString CorpusText(std::mt19937 &generator, int size) {
+	const auto words = std::vector<const char*>(kCorpusWords);
+	auto result = QString();
+	while (result.size() < size) {
+		const auto count = 1 + int(generator() % 30);
+		for (auto i = 0; i != count; ++i) {
+			if (i > 0) {
+				result.append((generator() % 10) ? ' ' : '\n');
+			}
+			result.append(QString::fromUtf8(
+				words[generator() % words.size()]));
+		}
+		result.append('\n');
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("entity scanner finds tags", "[text_entity]") {
+	SECTION("hashtags") {
+		REQUIRE(FindHashtag("#tag", 0) == TagMatch{ 0, 4, false, false });
+		REQUIRE(FindHashtag(" #tag ", 0) == TagMatch{ 0, 6, true, true });
+		REQUIRE(!FindHashtag("#t", 1).found());
+		REQUIRE(!FindHashtag("a#tag", 0).found());
+		REQUIRE(FindHashtag("#t #tag", 0) == TagMatch{ 2, 7, true, false });
+		REQUIRE(FindHashtag(QString::fromUtf8("#\xD1\x82\xD1\x8D\xD0\xB3"), 0).end == 4);
+		REQUIRE(!FindHashtag("#" + QString(65, 'a'), 0).found());
+		REQUIRE(FindHashtag("#" + QString(64, 'a'), 0).found());
+	}
+	SECTION("mentions") {
+		REQUIRE(FindMention("@user", 0) == TagMatch{ 0, 5, false, false });
+		REQUIRE(FindMention("(@user)", 0) == TagMatch{ 0, 7, true, true });
+		REQUIRE(!FindMention(QString::fromUtf8("@user\xD1\x8F"), 0).found());
+		REQUIRE(!FindMention("@" + QString(33, 'a'), 0).found());
+		REQUIRE(!FindMention("mail@user", 0).found());
+	}
+	SECTION("bot commands") {
+		REQUIRE(FindBotCommand("/start", 0) == TagMatch{ 0, 6, false, false });
+		REQUIRE(FindBotCommand("/start@SomeBot", 0) == TagMatch{ 0, 14, false, false });
+		REQUIRE(FindBotCommand("/start@Bot", 0) == TagMatch{ 0, 7, false, true });
+		REQUIRE(!FindBotCommand("a/start", 0).found());
+		REQUIRE(!FindBotCommand("//start", 0).found());
+	}
+	SECTION("broken utf-16") {
+		REQUIRE(IsValidUtf16(QString::fromUtf8("#\xF0\x9F\x98\x80")));
+		REQUIRE(!IsValidUtf16(QString(QChar(0xD83D))));
+		REQUIRE(!IsValidUtf16(QString(QChar(0xDE00)) + "a"));
+	}
+}
+
+TEST_CASE("entity scanner matches regular expressions", "[text_entity]") {
+	SECTION("samples") {
+		const auto samples = {
+			"#tag @user /command@SomeBot",
+			"text.#tag,@user;/command",
+			"#1 #12 ##tag #_ #a_b_c",
+			"@a @_ @user@user /cmd@Bot /cmd@LongBotName1/x",
+			"/cmd@user_bot_name_that_is_long_enough_to_fail",
+			"`#code` *@bold* /path/to/file",
+		};
+		for (const auto sample : samples) {
+			CheckAllOffsets(QString(sample));
+		}
+		CheckAllOffsets(QString::fromUtf8("#\xD1\x82\xD0\xB5\xD0\xB3 \xC2\xAB@user\xC2\xBB"));
+		CheckAllOffsets(QString::fromUtf8("#a\xF0\x9D\x90\x80 #\xF0\x9F\x98\x80\xF0\x9F\x98\x80"));
+		CheckAllOffsets("#" + QString(64, 'a') + " #" + QString(65, 'b'));
+		CheckAllOffsets("/" + QString(64, 'a') + " /" + QString(65, 'b'));
+	}
+	SECTION("random texts") {
+		auto generator = std::mt19937(1);
+		for (auto i = 0; i != 2000; ++i) {
+			CheckAllOffsets(RandomText(generator, 1 + int(generator() % 24)));
+		}
+	}
+}
+
+TEST_CASE("entity scanner benchmark", "[.][benchmark]") {
+	const auto run = [](const char *name, const QString &text) {
+		for (const auto &expression : kExpressions) {
+			const auto measure = [&](auto &&find) {
+				return base::test::Measure([&] {
+					for (auto offset = 0; offset < text.size();) {
+						const auto match = find(offset);
+						offset = match.found() ? match.end : text.size();
+					}
+				});
+			};
+			const auto regexpTime = measure([&](int offset) {
+				return FromRegExp(
+					expression.regexp().match(text, offset),
+					expression.suffixGroup);
+			});
+			const auto scanTime = measure([&](int offset) {
+				return expression.scan(text, offset);
+			});
+			WARN(name << ", " << expression.name
+				<< ": regexp " << regexpTime << " us"
+				<< ", scanner " << scanTime << " us");
+		}
+	};
+
+	auto generator = std::mt19937(0);
+	auto random = QString();
+	while (random.size() < 64 * 1024) {
+		random.append(RandomText(generator, 16)).append(' ');
+	}
+	run("random", random);
+	run("corpus", CorpusText(generator, 64 * 1024));
+}
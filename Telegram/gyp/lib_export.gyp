@@ -56,6 +56,8 @@
       '<(src_loc)',
       '<(SHARED_INTERMEDIATE_DIR)',
       '<(libs_loc)/range-v3/include',
+      '<(libs_loc)/zlib',
+      '<(submodules_loc)/minizip',
       '<(submodules_loc)/GSL/include',
       '<(submodules_loc)/variant/include',
       '<(submodules_loc)/crl/src',
@@ -71,10 +73,14 @@
       '<(src_loc)/export/data/export_data_types.h',
       '<(src_loc)/export/output/export_output_abstract.cpp',
       '<(src_loc)/export/output/export_output_abstract.h',
+      '<(src_loc)/export/output/export_output_archive.cpp',
+      '<(src_loc)/export/output/export_output_archive.h',
       '<(src_loc)/export/output/export_output_file.cpp',
       '<(src_loc)/export/output/export_output_file.h',
       '<(src_loc)/export/output/export_output_html.cpp',
       '<(src_loc)/export/output/export_output_html.h',
+      '<(src_loc)/export/output/export_output_journal.cpp',
+      '<(src_loc)/export/output/export_output_journal.h',
       '<(src_loc)/export/output/export_output_json.cpp',
       '<(src_loc)/export/output/export_output_json.h',
       '<(src_loc)/export/output/export_output_result.h',
@@ -14,6 +14,7 @@
   ],
   'variables': {
     'libs_loc': '../../../../Libraries',
+    'res_loc': '../../Resources',
     'src_loc': '../../SourceFiles',
     'submodules_loc': '../../ThirdParty',
     'mac_target': '10.10',
@@ -56,6 +57,35 @@
       '<(src_loc)/base/algorithm.h',
       '<(src_loc)/base/algorithm_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_export',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      '../lib_export.gyp:lib_export',
+    ],
+    'sources': [
+      '<(res_loc)/qrc/export_html.qrc',
+      '<(src_loc)/export/output/export_output_file_tests.cpp',
+      '<(src_loc)/export/output/export_output_journal_tests.cpp',
+    ],
+    'rules': [{
+      'rule_name': 'qt_rcc',
+      'extension': 'qrc',
+      'outputs': [
+        '<(SHARED_INTERMEDIATE_DIR)/<(_target_name)/qrc/qrc_<(RULE_INPUT_ROOT).cpp',
+      ],
+      'action': [
+        '<(qt_loc)/bin/rcc<(exe_ext)',
+        '-name', '<(RULE_INPUT_ROOT)',
+        '-no-compress',
+        '<(RULE_INPUT_PATH)',
+        '-o', '<(SHARED_INTERMEDIATE_DIR)/<(_target_name)/qrc/qrc_<(RULE_INPUT_ROOT).cpp',
+      ],
+      'message': 'Rcc-ing <(RULE_INPUT_ROOT).qrc..',
+      'process_outputs_as_sources': 1,
+    }],
   }, {
     'target_name': 'tests_flags',
     'includes': [
@@ -83,6 +113,38 @@
       '<(src_loc)/base/flat_set.h',
       '<(src_loc)/base/flat_set_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_gzip_packed',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'include_dirs': [
+      '<(libs_loc)/zlib',
+    ],
+    'sources': [
+      '<(src_loc)/mtproto/gzip_packed.cpp',
+      '<(src_loc)/mtproto/gzip_packed.h',
+      '<(src_loc)/mtproto/gzip_packed_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_image_prepare',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/ui/image/image_prepare_kernels.cpp',
+      '<(src_loc)/ui/image/image_prepare_kernels.h',
+      '<(src_loc)/ui/image/image_prepare_kernels_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_mpsc_queue',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/mpsc_queue.h',
+      '<(src_loc)/base/mpsc_queue_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_rpl',
     'includes': [
@@ -121,6 +183,16 @@
       '<(src_loc)/rpl/variable.h',
       '<(src_loc)/rpl/variable_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_text_entity',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/ui/text/text_entity_scanner.cpp',
+      '<(src_loc)/ui/text/text_entity_scanner.h',
+      '<(src_loc)/ui/text/text_entity_scanner_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_storage',
     'includes': [